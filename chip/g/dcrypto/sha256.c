@@ -41,7 +41,12 @@ static const struct HASH_VTAB SW_SHA256_VTAB = {
 static void sha256_init(SHA256_CTX *ctx)
 {
 	ctx->vtab = &SW_SHA256_VTAB;
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	/* SHA256_init() would try to claim the engine again */
+	SHA256_sw_init(&ctx->u.sw_sha256);
+#else
 	SHA256_init(&ctx->u.sw_sha256);
+#endif
 }
 
 static void sha256_update(SHA256_CTX *ctx, const uint8_t *data, uint32_t len)
@@ -213,3 +218,34 @@ const uint8_t *DCRYPTO_SHA256_hash(const uint8_t *data, uint32_t n,
 #endif
 	return digest;
 }
+
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+/* Hooks for SHA256_init() and friends in common/sha256.c */
+int SHA256_hw_init(void)
+{
+	if (!dcrypto_grab_sha_hw())
+		return 0;
+
+	dcrypto_sha_init(SHA256_MODE);
+	return 1;
+}
+
+void SHA256_hw_update(const uint8_t *data, uint32_t len)
+{
+	dcrypto_sha_update(NULL, data, len);
+}
+
+void SHA256_hw_final(uint8_t *digest)
+{
+	/* dcrypto_sha_wait() will release the hw. */
+	dcrypto_sha_wait(SHA256_MODE, (uint32_t *) digest);
+}
+
+void SHA256_hw_abort(void)
+{
+	uint32_t digest[SHA256_DIGEST_WORDS];
+
+	/* Let the engine finish, so it is idle for the next user */
+	dcrypto_sha_wait(SHA256_MODE, digest);
+}
+#endif
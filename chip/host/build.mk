@@ -11,4 +11,5 @@ CORE:=host
 chip-y=system.o gpio.o uart.o persistence.o flash.o lpc.o reboot.o i2c.o \
 	clock.o
 chip-$(HAS_TASK_KEYSCAN)+=keyboard_raw.o
+chip-$(CONFIG_SPI_MASTER)+=spi_master.o
 chip-$(CONFIG_USB_POWER_DELIVERY)+=usb_pd_phy.o
@@ -10,7 +10,7 @@
 
 /* Memory mapping */
 #define CONFIG_FLASH_SIZE 0x00020000
-extern char __host_flash[CONFIG_FLASH_SIZE];
+extern char *__host_flash;
 
 #define CONFIG_PROGRAM_MEMORY_BASE     ((uintptr_t)__host_flash)
 #define CONFIG_FLASH_BANK_SIZE         0x1000
@@ -33,7 +33,7 @@ extern char __host_flash[CONFIG_FLASH_SIZE];
 #include "config_std_internal_flash.h"
 
 /* Maximum number of deferrable functions */
-#define DEFERRABLE_MAX_COUNT 8
+#define DEFERRABLE_MAX_COUNT 16
 
 /* Interval between HOOK_TICK notifications */
 #define HOOK_TICK_INTERVAL_MS 250
@@ -12,7 +12,8 @@
 #include "persistence.h"
 #include "util.h"
 
-char __host_flash[CONFIG_FLASH_SIZE];
+/* Mapped from persistent storage by flash_pre_init() */
+char *__host_flash;
 uint8_t __host_flash_protect[PHYSICAL_BANKS];
 
 /* Override this function to make flash erase/write operation fail */
@@ -34,33 +35,23 @@ static int flash_check_protect(int offset, int size)
 	return 0;
 }
 
-static void flash_set_persistent(void)
-{
-	FILE *f = get_persistent_storage("flash", "wb");
-	int sz;
-
-	ASSERT(f != NULL);
-
-	sz = fwrite(__host_flash, sizeof(__host_flash), 1, f);
-	ASSERT(sz == 1);
-
-	release_persistent_storage(f);
-}
-
 static void flash_get_persistent(void)
 {
-	FILE *f = get_persistent_storage("flash", "rb");
+	int created;
 
-	if (f == NULL) {
+	/*
+	 * Flash is the storage itself, so writes and erases persist as they
+	 * happen with no copying.
+	 */
+	__host_flash = map_persistent_storage("flash", CONFIG_FLASH_SIZE,
+					      &created);
+	ASSERT(__host_flash != NULL);
+
+	if (created) {
 		fprintf(stderr,
 			"No flash storage found. Initializing to 0xff.\n");
-		memset(__host_flash, 0xff, sizeof(__host_flash));
-		return;
+		memset(__host_flash, 0xff, CONFIG_FLASH_SIZE);
 	}
-
-	fread(__host_flash, sizeof(__host_flash), 1, f);
-
-	release_persistent_storage(f);
 }
 
 int flash_physical_write(int offset, int size, const char *data)
@@ -74,7 +65,6 @@ int flash_physical_write(int offset, int size, const char *data)
 		return EC_ERROR_ACCESS_DENIED;
 
 	memcpy(__host_flash + offset, data, size);
-	flash_set_persistent();
 
 	return EC_SUCCESS;
 }
@@ -90,7 +80,6 @@ int flash_physical_erase(int offset, int size)
 		return EC_ERROR_ACCESS_DENIED;
 
 	memset(__host_flash + offset, 0xff, size);
-	flash_set_persistent();
 
 	return EC_SUCCESS;
 }
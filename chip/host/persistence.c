@@ -5,39 +5,116 @@
 
 /* Persistence module for emulator */
 
+#include <fcntl.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #define BUF_SIZE 1024
 
+/* Maximum number of storages mapped with map_persistent_storage() */
+#define MAX_MAPPINGS 4
+
+/*
+ * Storage files go next to the executable, or in $EMU_PERSIST_DIR if set, so
+ * that several runs of the same test can happen at once.
+ */
+#define PERSIST_DIR_ENV "EMU_PERSIST_DIR"
+
 static void get_storage_path(char *out)
 {
 	char buf[BUF_SIZE];
+	const char *dir = getenv(PERSIST_DIR_ENV);
+	const char *name;
 	int sz;
 
-	sz = readlink("/proc/self/exe", buf, BUF_SIZE);
+	sz = readlink("/proc/self/exe", buf, BUF_SIZE - 1);
+	if (sz < 0)
+		sz = 0;
 	buf[sz] = '\0';
-	if (snprintf(out, BUF_SIZE, "%s_persist", buf) >= BUF_SIZE)
+
+	if (dir && *dir) {
+		name = strrchr(buf, '/');
+		name = name ? name + 1 : buf;
+		sz = snprintf(out, BUF_SIZE, "%s/%s_persist", dir, name);
+	} else {
+		sz = snprintf(out, BUF_SIZE, "%s_persist", buf);
+	}
+	if (sz >= BUF_SIZE)
 		out[BUF_SIZE - 1] = '\0';
 }
 
-FILE *get_persistent_storage(const char *tag, const char *mode)
+static void get_tagged_storage_path(const char *tag, char *out)
 {
 	char buf[BUF_SIZE];
-	char path[BUF_SIZE];
 
 	/*
 	 * The persistent storage with tag 'foo' for test 'bar' would
 	 * be named 'bar_persist_foo'
 	 */
 	get_storage_path(buf);
-	if (snprintf(path, BUF_SIZE, "%s_%s", buf, tag) >= BUF_SIZE)
-		path[BUF_SIZE - 1] = '\0';
+	if (snprintf(out, BUF_SIZE, "%s_%s", buf, tag) >= BUF_SIZE)
+		out[BUF_SIZE - 1] = '\0';
+}
 
+FILE *get_persistent_storage(const char *tag, const char *mode)
+{
+	char path[BUF_SIZE];
+
+	get_tagged_storage_path(tag, path);
 	return fopen(path, mode);
 }
 
+static struct {
+	void *addr;
+	size_t size;
+} mappings[MAX_MAPPINGS];
+
+void *map_persistent_storage(const char *tag, size_t size, int *created)
+{
+	char path[BUF_SIZE];
+	struct stat st;
+	void *addr;
+	int fd, i;
+
+	for (i = 0; i < MAX_MAPPINGS && mappings[i].addr; i++)
+		;
+	if (i == MAX_MAPPINGS)
+		return NULL;
+
+	get_tagged_storage_path(tag, path);
+	fd = open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return NULL;
+
+	/* Storage that's new, or left from a build with another size */
+	*created = fstat(fd, &st) || st.st_size != (off_t)size;
+	if (*created && ftruncate(fd, size)) {
+		close(fd);
+		return NULL;
+	}
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	mappings[i].addr = addr;
+	mappings[i].size = size;
+	return addr;
+}
+
+void flush_persistent_storage(void)
+{
+	int i;
+
+	for (i = 0; i < MAX_MAPPINGS && mappings[i].addr; i++)
+		msync(mappings[i].addr, mappings[i].size, MS_SYNC);
+}
+
 void release_persistent_storage(FILE *ps)
 {
 	fclose(ps);
@@ -45,12 +122,8 @@ void release_persistent_storage(FILE *ps)
 
 void remove_persistent_storage(const char *tag)
 {
-	char buf[BUF_SIZE];
 	char path[BUF_SIZE];
 
-	get_storage_path(buf);
-	if (snprintf(path, BUF_SIZE, "%s_%s", buf, tag) >= BUF_SIZE)
-		path[BUF_SIZE - 1] = '\0';
-
+	get_tagged_storage_path(tag, path);
 	unlink(path);
 }
@@ -8,6 +8,7 @@
 #ifndef __CROS_EC_PERSISTENCE_H
 #define __CROS_EC_PERSISTENCE_H
 
+#include <stddef.h>
 #include <stdio.h>
 
 FILE *get_persistent_storage(const char *tag, const char *mode);
@@ -16,4 +17,27 @@ void release_persistent_storage(FILE *ps);
 
 void remove_persistent_storage(const char *tag);
 
+/**
+ * Map persistent storage into memory.
+ *
+ * Writes to the memory go straight to the storage, through the page cache,
+ * so nothing needs writing out before a reboot or exit.  The mapping lasts
+ * until the emulator exits or reboots.
+ *
+ * @param tag		Storage tag, as for get_persistent_storage()
+ * @param size		Size of the storage in bytes
+ * @param created	Set non-zero if the storage was created, or resized
+ *			because it was left from a build with another size;
+ *			its contents then need initializing.
+ *
+ * @return the mapped storage, or NULL on error.
+ */
+void *map_persistent_storage(const char *tag, size_t size, int *created);
+
+/*
+ * Write all mapped persistent storage out to disk.  Other processes see the
+ * writes without this; it only matters if the host itself goes down.
+ */
+void flush_persistent_storage(void);
+
 #endif /* __CROS_EC_PERSISTENCE_H */
@@ -9,6 +9,7 @@
 #include <unistd.h>
 
 #include "host_test.h"
+#include "persistence.h"
 #include "reboot.h"
 #include "test_util.h"
 
@@ -16,5 +17,6 @@ void emulator_reboot(void)
 {
 	char *argv[] = {strdup(__get_prog_name()), NULL};
 	emulator_flush();
+	flush_persistent_storage();
 	execv(__get_prog_name(), argv);
 }
@@ -0,0 +1,219 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Emulated SPI master for unit tests.  Every port has an emulated SPI NOR
+ * flash of CONFIG_FLASH_SIZE bytes on it, which takes time for transfers,
+ * page programs and erases.
+ */
+
+#include "common.h"
+#include "hooks.h"
+#include "spi.h"
+#include "spi_flash.h"
+#include "spi_flash_reg.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/*
+ * Bus clock, and the lower clock parts specify for Read Data (0x03).  Read
+ * Data transactions are charged at the lower clock.
+ */
+#define BUS_MHZ			48
+#define READ_DATA_MHZ		33
+
+/* Fixed cost of a transaction: chip select, controller and DMA setup */
+#define XFER_OVERHEAD_US	5
+
+/* Most bytes received in one transaction, as for a 16-bit DMA count */
+#define MAX_RX_SIZE		0xffff
+
+/*
+ * Busy times.  Erases are much quicker than on real parts, so tests which
+ * erase stay fast.
+ */
+#define PAGE_PROGRAM_US		400
+#define ERASE_4KB_US		1000
+#define ERASE_32KB_US		4000
+#define WRITE_SR_US		100
+
+static uint8_t storage[CONFIG_FLASH_SIZE];
+static uint8_t sr1, sr2;
+static timestamp_t busy_until;
+static struct spi_flash_emu_stats stats;
+
+/* Bus time owed but not yet spent, in ns */
+static unsigned bus_ns;
+
+static void spend_bus_time(int bytes, int mhz)
+{
+	bus_ns += bytes * 8 * 1000 / mhz;
+	udelay(XFER_OVERHEAD_US + bus_ns / 1000);
+	bus_ns %= 1000;
+}
+
+static int is_busy(void)
+{
+	return !timestamp_expired(busy_until, NULL);
+}
+
+static void start_busy(unsigned us)
+{
+	busy_until.val = get_time().val + us;
+	sr1 &= ~SPI_FLASH_SR1_WEL;
+}
+
+static unsigned get_address(const uint8_t *txdata)
+{
+	return (txdata[1] << 16) | (txdata[2] << 8) | txdata[3];
+}
+
+static void read_data(unsigned address, uint8_t *rxdata, int rxlen)
+{
+	int i;
+
+	/* Reads wrap around at the end of the part */
+	for (i = 0; i < rxlen; i++)
+		rxdata[i] = storage[(address + i) % CONFIG_FLASH_SIZE];
+}
+
+static void page_program(unsigned address, const uint8_t *data, int len)
+{
+	unsigned page = address & ~(SPI_FLASH_MAX_WRITE_SIZE - 1);
+	int i;
+
+	/* Writes wrap around within the page; programming only clears bits */
+	for (i = 0; i < len; i++)
+		storage[(page + ((address + i) & (SPI_FLASH_MAX_WRITE_SIZE - 1)))
+			% CONFIG_FLASH_SIZE] &= data[i];
+	stats.programs++;
+	start_busy(PAGE_PROGRAM_US);
+}
+
+static void erase(unsigned address, unsigned size, unsigned us)
+{
+	address &= ~(size - 1);
+	if (address + size <= CONFIG_FLASH_SIZE)
+		memset(storage + address, 0xff, size);
+	stats.erases++;
+	start_busy(us);
+}
+
+static void transaction(const uint8_t *txdata, int txlen, uint8_t *rxdata,
+			int rxlen)
+{
+	uint8_t status;
+	int wel = sr1 & SPI_FLASH_SR1_WEL;
+
+	memset(rxdata, 0xff, rxlen);
+
+	/* A busy part only answers status register 1 reads */
+	if (is_busy() && txdata[0] != SPI_FLASH_READ_SR1) {
+		stats.ignored++;
+		return;
+	}
+
+	switch (txdata[0]) {
+	case SPI_FLASH_READ_SR1:
+	case SPI_FLASH_READ_SR2:
+		/* The register is sent repeatedly for as long as is clocked */
+		if (txdata[0] == SPI_FLASH_READ_SR1)
+			status = sr1 | (is_busy() ? SPI_FLASH_SR1_BUSY : 0);
+		else
+			status = sr2;
+		memset(rxdata, status, rxlen);
+		break;
+	case SPI_FLASH_WRITE_ENABLE:
+		sr1 |= SPI_FLASH_SR1_WEL;
+		break;
+	case SPI_FLASH_WRITE_DISABLE:
+		sr1 &= ~SPI_FLASH_SR1_WEL;
+		break;
+	case SPI_FLASH_WRITE_SR:
+		if (!wel || txlen < 2)
+			break;
+		sr1 = txdata[1] & ~(SPI_FLASH_SR1_WEL | SPI_FLASH_SR1_BUSY);
+		if (txlen > 2)
+			sr2 = txdata[2];
+		start_busy(WRITE_SR_US);
+		break;
+	case SPI_FLASH_READ:
+		if (txlen < 4)
+			break;
+		read_data(get_address(txdata), rxdata, rxlen);
+		stats.reads++;
+		break;
+	case SPI_FLASH_FAST_READ:
+		/* Address, then a dummy byte */
+		if (txlen < 5)
+			break;
+		read_data(get_address(txdata), rxdata, rxlen);
+		stats.fast_reads++;
+		break;
+	case SPI_FLASH_PAGE_PRGRM:
+		if (wel && txlen > 4)
+			page_program(get_address(txdata), txdata + 4, txlen - 4);
+		break;
+	case SPI_FLASH_ERASE_4KB:
+		if (wel && txlen >= 4)
+			erase(get_address(txdata), 0x1000, ERASE_4KB_US);
+		break;
+	case SPI_FLASH_ERASE_32KB:
+		if (wel && txlen >= 4)
+			erase(get_address(txdata), 0x8000, ERASE_32KB_US);
+		break;
+	case SPI_FLASH_JEDEC_ID:
+		/* Winbond, W25X-style type, capacity as log2 of the size */
+		if (rxlen > 0)
+			rxdata[0] = 0xef;
+		if (rxlen > 1)
+			rxdata[1] = 0x30;
+		if (rxlen > 2)
+			rxdata[2] = __fls(CONFIG_FLASH_SIZE);
+		break;
+	case SPI_FLASH_UNIQUE_ID:
+		memset(rxdata, 0x5a, rxlen);
+		break;
+	}
+}
+
+int spi_transaction(const struct spi_device_t *spi_device,
+		    const uint8_t *txdata, int txlen,
+		    uint8_t *rxdata, int rxlen)
+{
+	if (txlen < 1 || rxlen < 0 || rxlen > MAX_RX_SIZE)
+		return EC_ERROR_INVAL;
+
+	transaction(txdata, txlen, rxdata, rxlen);
+	stats.transactions++;
+	stats.bytes += txlen + rxlen;
+	spend_bus_time(txlen + rxlen,
+		       txdata[0] == SPI_FLASH_READ ? READ_DATA_MHZ : BUS_MHZ);
+
+	return EC_SUCCESS;
+}
+
+int spi_enable(int port, int enable)
+{
+	return EC_SUCCESS;
+}
+
+void spi_flash_emu_reset(void)
+{
+	memset(storage, 0xff, sizeof(storage));
+	sr1 = sr2 = 0;
+	busy_until.val = 0;
+	spi_flash_emu_clear_stats();
+}
+DECLARE_HOOK(HOOK_INIT, spi_flash_emu_reset, HOOK_PRIO_FIRST);
+
+void spi_flash_emu_clear_stats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+const struct spi_flash_emu_stats *spi_flash_emu_get_stats(void)
+{
+	return &stats;
+}
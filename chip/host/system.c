@@ -22,41 +22,36 @@ uint8_t __shared_mem_buf[SHARED_MEM_SIZE];
 #define RAM_DATA_SIZE (sizeof(struct panic_data) + 512) /* bytes */
 static char __ram_data[RAM_DATA_SIZE];
 
+/*
+ * Mapped from persistent storage.  RAM data itself stays right after the
+ * shared memory buffer, where system_usable_ram_end() expects it.
+ */
+static char *__ram_data_storage;
+
 static enum system_image_copy_t __running_copy;
 
 static void ramdata_set_persistent(void)
 {
-	FILE *f = get_persistent_storage("ramdata", "wb");
-	int sz;
-
-	ASSERT(f != NULL);
-
-	sz = fwrite(__ram_data, sizeof(__ram_data), 1, f);
-	ASSERT(sz == 1);
-
-	release_persistent_storage(f);
+	memcpy(__ram_data_storage, __ram_data, RAM_DATA_SIZE);
 }
 
-static void ramdata_get_persistent(void)
+static void ramdata_get_persistent(int jumped)
 {
-	FILE *f = get_persistent_storage("ramdata", "rb");
+	int created;
+
+	__ram_data_storage = map_persistent_storage("ramdata", RAM_DATA_SIZE,
+						    &created);
+	ASSERT(__ram_data_storage != NULL);
 
-	if (f == NULL) {
+	/* Assumes RAM data doesn't preserve across reboot except for sysjump */
+	if (created || !jumped) {
 		fprintf(stderr,
 			"No RAM data found. Initializing to 0x00.\n");
-		memset(__ram_data, 0, sizeof(__ram_data));
+		memset(__ram_data, 0, RAM_DATA_SIZE);
 		return;
 	}
 
-	fread(__ram_data, sizeof(__ram_data), 1, f);
-
-	release_persistent_storage(f);
-
-	/*
-	 * Assumes RAM data doesn't preserve across reboot except for sysjump.
-	 * Clear persistent data once it's read.
-	 */
-	remove_persistent_storage("ramdata");
+	memcpy(__ram_data, __ram_data_storage, RAM_DATA_SIZE);
 }
 
 static void set_image_copy(uint32_t copy)
@@ -254,8 +249,8 @@ void system_pre_init(void)
 	if (load_time(&t))
 		force_time(t);
 
-	ramdata_get_persistent();
 	__running_copy = get_image_copy();
+	ramdata_get_persistent(__running_copy != SYSTEM_IMAGE_UNKNOWN);
 	if (__running_copy == SYSTEM_IMAGE_UNKNOWN) {
 		__running_copy = SYSTEM_IMAGE_RO;
 		system_set_reset_flags(load_reset_flags());
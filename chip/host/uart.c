@@ -166,6 +166,11 @@ void *uart_monitor_stdin(void *d)
 	while (1) {
 		tcsetattr(0, TCSANOW, &new_settings);
 		rv = read(0, buf, INPUT_BUFFER_SIZE);
+		if (rv <= 0) {
+			/* No more input; don't spin raising interrupts */
+			tcsetattr(0, TCSANOW, &org_settings);
+			break;
+		}
 		if (queue_space(&cached_char) >= rv) {
 			queue_add_units(&cached_char, buf, rv);
 			char_available = rv;
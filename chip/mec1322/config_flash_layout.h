@@ -19,6 +19,7 @@
 #undef  CONFIG_MAPPED_STORAGE
 #undef  CONFIG_FLASH_PSTATE
 #define CONFIG_SPI_FLASH
+#define CONFIG_SPI_FLASH_FAST_READ
 
 /* EC region of SPI resides at end of ROM, protected region follows writable */
 #define CONFIG_EC_PROTECTED_STORAGE_OFF  (CONFIG_FLASH_SIZE - 0x20000)
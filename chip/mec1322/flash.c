@@ -40,7 +40,7 @@ int flash_physical_read(int offset, int size, char *data)
 	int i, read_size;
 
 	for (i = 0; i < size; i += read_size) {
-		read_size = MIN((size - i), SPI_FLASH_MAX_READ_SIZE);
+		read_size = MIN((size - i), CONFIG_SPI_FLASH_READ_CHUNK_SIZE);
 		ret = spi_flash_read((uint8_t *)(data + i),
 					offset + i,
 					read_size);
@@ -64,9 +64,6 @@ int flash_physical_read(int offset, int size, char *data)
  */
 int flash_physical_write(int offset, int size, const char *data)
 {
-	int ret = EC_SUCCESS;
-	int  i, write_size;
-
 	if (entire_flash_locked)
 		return EC_ERROR_ACCESS_DENIED;
 
@@ -74,15 +71,8 @@ int flash_physical_write(int offset, int size, const char *data)
 	if ((offset | size | (uint32_t)(uintptr_t)data) & 3)
 		return EC_ERROR_INVAL;
 
-	for (i = 0; i < size; i += write_size) {
-		write_size = MIN((size - i), SPI_FLASH_MAX_WRITE_SIZE);
-		ret = spi_flash_write(offset + i,
-				      write_size,
-				      (uint8_t *)data + i);
-		if (ret != EC_SUCCESS)
-			break;
-	}
-	return ret;
+	/* One call, so each page is prepared while the last one programs */
+	return spi_flash_write(offset, size, (const uint8_t *)data);
 }
 
 /**
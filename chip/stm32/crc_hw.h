@@ -9,6 +9,7 @@
 
 #include "clock.h"
 #include "registers.h"
+#include "util.h"
 
 static inline void crc32_init(void)
 {
@@ -33,6 +34,37 @@ static inline void crc32_hash16(uint16_t val)
 	STM32_CRC_DR16 = val;
 }
 
+/* Feed single bytes, reversing the input by byte rather than by word */
+static inline void crc32_hash_bytes(const uint8_t *p, int size)
+{
+	if (size <= 0)
+		return;
+
+	STM32_CRC_CR = STM32_CRC_CR_REV_OUT | STM32_CRC_CR_REV_IN_BYTE;
+	while (size--)
+		STM32_CRC_DR8 = *p++;
+	STM32_CRC_CR = STM32_CRC_CR_REV_OUT | STM32_CRC_CR_REV_IN_WORD;
+}
+
+static inline void crc32_hash(const void *buf, int size)
+{
+	const uint8_t *p = buf;
+	int head = MIN((int)(-(uintptr_t)p & 3), size);
+
+	/* Feed as much as possible as whole aligned words */
+	crc32_hash_bytes(p, head);
+	p += head;
+	size -= head;
+
+	while (size >= 4) {
+		STM32_CRC_DR32 = *(const uint32_t *)p;
+		p += 4;
+		size -= 4;
+	}
+
+	crc32_hash_bytes(p, size);
+}
+
 static inline uint32_t crc32_result(void)
 {
 	return STM32_CRC_DR ^ 0xFFFFFFFF;
@@ -33,6 +33,7 @@ common-$(CONFIG_CHARGER)+=charger.o
 common-$(CONFIG_CHARGER_V1)+=charge_state_v1.o
 common-$(CONFIG_CHARGER_V2)+=charge_state_v2.o
 common-$(CONFIG_CMD_I2CWEDGE)+=i2c_wedge.o
+common-$(CONFIG_CONSOLE_TOKENIZED)+=console_tokens.o
 common-$(CONFIG_COMMON_GPIO)+=gpio.o
 common-$(CONFIG_COMMON_PANIC_OUTPUT)+=panic_output.o
 common-$(CONFIG_COMMON_RUNTIME)+=hooks.o main.o system.o shared_mem.o
@@ -79,6 +80,7 @@ common-$(CONFIG_SWITCH)+=switch.o
 common-$(CONFIG_SW_CRC)+=crc.o
 common-$(CONFIG_TEMP_SENSOR)+=temp_sensor.o thermal.o throttle_ap.o
 common-$(CONFIG_TPM_SPS)+=tpm_registers.o
+common-$(CONFIG_TRACE)+=trace.o
 common-$(CONFIG_USB_CHARGER)+=usb_charger.o
 common-$(CONFIG_USB_PORT_POWER_DUMB)+=usb_port_power_dumb.o
 common-$(CONFIG_USB_PORT_POWER_SMART)+=usb_port_power_smart.o
@@ -677,7 +677,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 	 * attached.
 	 */
 	if (charge_manager_is_seeded())
-		hook_call_deferred(charge_manager_refresh, 0);
+		hook_call_deferred_data(&charge_manager_refresh_data, 0);
 }
 
 /**
@@ -734,7 +734,8 @@ void charge_manager_set_ceil(int port, enum ceil_requestor requestor, int ceil)
 	if (charge_ceil[port][requestor] != ceil) {
 		charge_ceil[port][requestor] = ceil;
 		if (port == charge_port && charge_manager_is_seeded())
-				hook_call_deferred(charge_manager_refresh, 0);
+				hook_call_deferred_data(
+					&charge_manager_refresh_data, 0);
 	}
 }
 
@@ -770,7 +771,8 @@ int charge_manager_set_override(int port)
 		if (override_port != port) {
 			override_port = port;
 			if (charge_manager_is_seeded())
-				hook_call_deferred(charge_manager_refresh, 0);
+				hook_call_deferred_data(
+					&charge_manager_refresh_data, 0);
 		}
 	}
 	/*
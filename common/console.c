@@ -115,6 +115,55 @@ static int split_words(char *input, int *argc, char **argv)
 	return EC_SUCCESS;
 }
 
+/*
+ * Set once at init if the command table is in case-insensitive order.  The
+ * linker sorts .rodata.cmds.* by name, so this only fails if a command name
+ * contains upper case letters; fall back to a linear scan in that case.
+ */
+static int cmds_sorted;
+
+/**
+ * Find the range of commands whose names start with a prefix.
+ *
+ * Requires the command table to be sorted.
+ *
+ * @param name		Prefix to look up; need not be null-terminated.
+ * @param len		Length of the prefix.
+ * @param end		Destination for the end of the range (exclusive).
+ *
+ * @return The first matching command.  If there are no matches, this is
+ *	equal to *end.
+ */
+static const struct console_command *find_command_range(
+	const char *name, int len, const struct console_command **end)
+{
+	const struct console_command *lo = __cmds, *hi = __cmds_end, *mid;
+	const struct console_command *first;
+
+	/* First entry not sorting before the prefix */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncasecmp(mid->name, name, len) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	first = lo;
+
+	/* First entry sorting after the prefix */
+	hi = __cmds_end;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strncasecmp(mid->name, name, len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	*end = lo;
+
+	return first;
+}
+
 /**
  * Find a command by name.
  *
@@ -131,6 +180,19 @@ static const struct console_command *find_command(char *name)
 	const struct console_command *cmd, *match = NULL;
 	int match_length = strlen(name);
 
+	if (cmds_sorted) {
+		cmd = find_command_range(name, match_length, &match);
+		if (cmd == match)
+			return NULL;
+		/*
+		 * A full match sorts before any longer name it prefixes, so
+		 * it is always first in the range.
+		 */
+		if (cmd->name[match_length] == '\0' || match - cmd == 1)
+			return cmd;
+		return NULL;
+	}
+
 	for (cmd = __cmds; cmd < __cmds_end; cmd++) {
 		if (!strncasecmp(name, cmd->name, match_length)) {
 			if (match)
@@ -148,7 +210,6 @@ static const struct console_command *find_command(char *name)
 	return match;
 }
 
-
 static const char const *errmsgs[] = {
 	"OK",
 	"Unknown error",
@@ -263,6 +324,16 @@ command_has_error:
 
 static void console_init(void)
 {
+	const struct console_command *cmd;
+
+	cmds_sorted = 1;
+	for (cmd = __cmds + 1; cmd < __cmds_end; cmd++) {
+		if (strcasecmp(cmd[-1].name, cmd->name) >= 0) {
+			cmds_sorted = 0;
+			break;
+		}
+	}
+
 	*input_buf = '\0';
 	ccprintf("Console is enabled; type HELP for help.\n");
 	ccputs(PROMPT);
@@ -383,6 +454,58 @@ static void handle_backspace(void)
 	input_pos--;
 }
 
+/**
+ * Complete the command name at the cursor.
+ *
+ * Extends the line by the longest prefix common to every command matching
+ * what has been typed so far, adding a space if the match is unique.  If
+ * there is nothing to add, list the candidates and reprint the line.
+ */
+static void handle_tab(void)
+{
+	const struct console_command *first, *end, *cmd;
+	int len, i;
+
+	/* Only the command name itself is completed */
+	if (!cmds_sorted || input_pos != input_len)
+		return;
+	for (i = 0; i < input_len; i++) {
+		if (isspace(input_buf[i]))
+			return;
+	}
+
+	first = find_command_range(input_buf, input_len, &end);
+	if (first == end)
+		return;
+
+	/* The table is sorted, so the first and last match bound the rest */
+	for (len = input_len; first->name[len]; len++) {
+		if (tolower(first->name[len]) != tolower(end[-1].name[len]))
+			break;
+	}
+
+	if (len == input_len && end - first > 1) {
+		console_putc('\n');
+		for (cmd = first; cmd < end; cmd++)
+			ccprintf("%s ", cmd->name);
+		ccputs("\n" PROMPT);
+		ccputs(input_buf);
+		return;
+	}
+
+	/* Leave room for the terminating null */
+	while (len > input_len && input_len < sizeof(input_buf) - 1) {
+		input_buf[input_len] = first->name[input_len];
+		console_putc(input_buf[input_len++]);
+	}
+	if (end - first == 1 && input_len < sizeof(input_buf) - 1) {
+		input_buf[input_len++] = ' ';
+		console_putc(' ');
+	}
+	input_buf[input_len] = '\0';
+	input_pos = input_len;
+}
+
 /**
  * Escape code handler
  *
@@ -500,6 +623,10 @@ static void console_handle_char(int c)
 	case 0x7f:
 		handle_backspace();
 		break;
+
+	case '\t':
+		handle_tab();
+		break;
 #endif /* !defined(CONFIG_EXPERIMENTAL_CONSOLE) */
 
 	case '\n':
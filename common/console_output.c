@@ -143,6 +143,24 @@ int cprints(enum console_channel channel, const char *format, ...)
 	return r ? r : rv;
 }
 
+#ifdef CONFIG_CONSOLE_TOKENIZED
+int ctprints(enum console_channel channel, const char *format, ...)
+{
+	int rv;
+	va_list args;
+
+	/* Filter out inactive channels */
+	if (!(CC_MASK(channel) & channel_mask))
+		return EC_SUCCESS;
+
+	va_start(args, format);
+	rv = console_tokens_vadd(channel, format, args);
+	va_end(args);
+
+	return rv;
+}
+#endif
+
 void cflush(void)
 {
 	uart_flush_output();
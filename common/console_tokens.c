@@ -0,0 +1,269 @@
+/* Copyright (c) 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Tokenized console logging.
+ *
+ * Instead of formatting a message to text, ctprints() stores the address of
+ * its format string, a timestamp and the raw argument values in a binary
+ * ring buffer.  The host reads the records back with
+ * EC_CMD_CONSOLE_READ_TOKENS and reconstructs the text from the format
+ * strings in the EC's ELF image (see util/ec_tokens.py).
+ */
+
+#include "common.h"
+#include "console.h"
+#include "host_command.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+#define BUF_SIZE CONFIG_CONSOLE_TOKENIZED_BUF_SIZE
+BUILD_ASSERT(POWER_OF_TWO(BUF_SIZE));
+
+/* Longest string copied for a %s argument */
+#define MAX_STR_LEN 32
+
+/*
+ * Records are packed back to back.  head and tail are free-running byte
+ * counts, so head - tail is the number of bytes in use.
+ */
+static uint8_t token_buf[BUF_SIZE];
+static uint32_t token_head;
+static uint32_t token_tail;
+
+/* Records overwritten before the host read them */
+static uint32_t token_dropped;
+
+static void buf_write(uint32_t pos, const void *data, int size)
+{
+	int first = MIN(size, BUF_SIZE - (pos & (BUF_SIZE - 1)));
+
+	memcpy(token_buf + (pos & (BUF_SIZE - 1)), data, first);
+	if (first < size)
+		memcpy(token_buf, (const uint8_t *)data + first, size - first);
+}
+
+static void buf_read(uint32_t pos, void *data, int size)
+{
+	int first = MIN(size, BUF_SIZE - (pos & (BUF_SIZE - 1)));
+
+	memcpy(data, token_buf + (pos & (BUF_SIZE - 1)), first);
+	if (first < size)
+		memcpy((uint8_t *)data + first, token_buf, size - first);
+}
+
+/* Size of the record at the given position, including its header */
+static int record_size(uint32_t pos)
+{
+	return sizeof(struct ec_console_token) +
+		token_buf[(pos + offsetof(struct ec_console_token, size)) &
+			  (BUF_SIZE - 1)];
+}
+
+/**
+ * Append an argument value to the record being built.
+ *
+ * @return 0 if added, 1 if there was no room.
+ */
+static int add_arg(uint8_t *args, int *len, const void *data, int size)
+{
+	if (*len + size > EC_CONSOLE_TOKEN_MAX_ARGS)
+		return 1;
+
+	memcpy(args + *len, data, size);
+	*len += size;
+	return 0;
+}
+
+/**
+ * Pack the arguments for a format string.
+ *
+ * This walks the format the same way vfnprintf() does, but only to find out
+ * how many arguments to pull and how wide they are.  Integers are stored
+ * little-endian in 4 or 8 bytes, strings as a length byte followed by the
+ * characters, and %h data as the raw bytes.  %T uses the record timestamp,
+ * so takes no space.
+ *
+ * @return 0 if all arguments fit, 1 if they or a string were truncated.
+ */
+static int pack_args(uint8_t *args, int *len, const char *format,
+		     va_list va)
+{
+	int c, precision;
+	uint32_t v;
+	uint64_t v64;
+	const char *s;
+	uint8_t slen;
+	int truncated = 0;
+
+	while (*format) {
+		if (*format++ != '%')
+			continue;
+
+		c = *format++;
+		if (c == '%')
+			continue;
+		if (c == '\0')
+			break;
+
+		if (c == 'c') {
+			v = va_arg(va, int);
+			if (add_arg(args, len, &v, sizeof(v)))
+				return 1;
+			continue;
+		}
+
+		if (c == '-')
+			c = *format++;
+		if (c == '0')
+			c = *format++;
+
+		if (c == '*') {
+			v = va_arg(va, int);
+			if (add_arg(args, len, &v, sizeof(v)))
+				return 1;
+			c = *format++;
+		} else {
+			while (c >= '0' && c <= '9')
+				c = *format++;
+		}
+
+		precision = 0;
+		if (c == '.') {
+			c = *format++;
+			if (c == '*') {
+				precision = va_arg(va, int);
+				if (add_arg(args, len, &precision,
+					    sizeof(precision)))
+					return 1;
+				c = *format++;
+			} else {
+				while (c >= '0' && c <= '9') {
+					precision = 10 * precision + c - '0';
+					c = *format++;
+				}
+			}
+		}
+
+		if (c == 's') {
+			s = va_arg(va, const char *);
+			if (!s)
+				s = "(NULL)";
+			for (slen = 0; slen < MAX_STR_LEN && s[slen]; slen++)
+				;
+			if (s[slen])
+				truncated = 1;
+			if (add_arg(args, len, &slen, 1) ||
+			    add_arg(args, len, s, slen))
+				return 1;
+		} else if (c == 'h') {
+			s = va_arg(va, const char *);
+			if (add_arg(args, len, s, precision))
+				return 1;
+		} else if (c == 'l') {
+			format++;
+			v64 = va_arg(va, uint64_t);
+			if (add_arg(args, len, &v64, sizeof(v64)))
+				return 1;
+		} else if (c == 'T') {
+			continue;
+		} else if (c) {
+			v = va_arg(va, uint32_t);
+			if (add_arg(args, len, &v, sizeof(v)))
+				return 1;
+		} else {
+			break;
+		}
+	}
+
+	return truncated;
+}
+
+int console_tokens_vadd(enum console_channel channel, const char *format,
+			va_list va)
+{
+	struct ec_console_token hdr;
+	uint8_t args[EC_CONSOLE_TOKEN_MAX_ARGS];
+	int len = 0;
+	int size;
+	int rv = EC_SUCCESS;
+
+	hdr.format = (uint32_t)(uintptr_t)format;
+	hdr.timestamp = get_time().le.lo;
+	hdr.channel = channel;
+	if (pack_args(args, &len, format, va)) {
+		hdr.channel |= EC_CONSOLE_TOKEN_TRUNCATED;
+		rv = EC_ERROR_OVERFLOW;
+	}
+	hdr.size = len;
+	size = sizeof(hdr) + len;
+
+	interrupt_disable();
+
+	/* Make room by throwing away the oldest records */
+	while (BUF_SIZE - (token_head - token_tail) < size) {
+		token_tail += record_size(token_tail);
+		token_dropped++;
+	}
+
+	buf_write(token_head, &hdr, sizeof(hdr));
+	buf_write(token_head + sizeof(hdr), args, len);
+	token_head += size;
+
+	interrupt_enable();
+
+	return rv;
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static int host_command_console_read_tokens(struct host_cmd_handler_args *args)
+{
+	struct ec_response_console_read_tokens *r = args->response;
+	uint8_t *dest = (uint8_t *)(r + 1);
+	int space = args->response_max - sizeof(*r);
+	int size;
+
+	interrupt_disable();
+
+	r->dropped = token_dropped;
+	token_dropped = 0;
+
+	/* Copy out as many whole records as fit */
+	while (token_tail != token_head) {
+		size = record_size(token_tail);
+		if (size > space)
+			break;
+		buf_read(token_tail, dest, size);
+		token_tail += size;
+		dest += size;
+		space -= size;
+	}
+
+	interrupt_enable();
+
+	args->response_size = dest - (uint8_t *)args->response;
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ_TOKENS,
+		     host_command_console_read_tokens,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_tokens(int argc, char **argv)
+{
+	ccprintf("Used:    %d / %d bytes\n", token_head - token_tail, BUF_SIZE);
+	ccprintf("Dropped: %d records\n", token_dropped);
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(tokens, command_tokens,
+			NULL,
+			"Print tokenized log buffer usage",
+			NULL);
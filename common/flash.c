@@ -5,11 +5,13 @@
 
 /* Flash memory module for Chrome EC - common functions */
 
+#include "atomic.h"
 #include "common.h"
 #include "console.h"
 #include "flash.h"
 #include "gpio.h"
 #include "host_command.h"
+#include "sha256.h"
 #include "shared_mem.h"
 #include "system.h"
 #include "util.h"
@@ -23,6 +25,49 @@
 #define CONFIG_FLASH_ERASED_VALUE32 (-1U)
 #endif
 
+/* Count of writes and erases, so cached views of flash can tell it changed */
+static uint32_t flash_generation;
+
+#define ERASE_BLOCKS (CONFIG_FLASH_SIZE / CONFIG_FLASH_ERASE_SIZE)
+
+/*
+ * Erase blocks known to be erased, because flash_erase() erased them and
+ * nothing has written to them since.  Other blocks are checked by reading.
+ */
+static uint32_t erased_map[DIV_ROUND_UP(ERASE_BLOCKS, 32)];
+
+/**
+ * Mark the erase blocks covering a range of flash as erased or not.
+ *
+ * Blocks are only marked erased if the range covers all of them.
+ */
+static void flash_mark_erased(int offset, int size, int erased)
+{
+	int block, end;
+
+	if (erased) {
+		block = DIV_ROUND_UP(offset, CONFIG_FLASH_ERASE_SIZE);
+		end = (offset + size) / CONFIG_FLASH_ERASE_SIZE;
+	} else {
+		block = offset / CONFIG_FLASH_ERASE_SIZE;
+		end = DIV_ROUND_UP(offset + size, CONFIG_FLASH_ERASE_SIZE);
+	}
+
+	for (end = MIN(end, ERASE_BLOCKS); block < end; block++) {
+		if (erased)
+			atomic_or(erased_map + block / 32,
+				  1U << (block % 32));
+		else
+			atomic_clear(erased_map + block / 32,
+				     1U << (block % 32));
+	}
+}
+
+static int flash_known_erased(int block)
+{
+	return erased_map[block / 32] & (1U << (block % 32));
+}
+
 #ifdef CONFIG_FLASH_PSTATE
 
 /*
@@ -173,10 +218,13 @@ static int flash_write_pstate(uint32_t flags)
 		return EC_SUCCESS;
 
 	/* Erase pstate */
+	flash_invalidate(CONFIG_FW_PSTATE_OFF, CONFIG_FW_PSTATE_SIZE);
 	rv = flash_physical_erase(CONFIG_FW_PSTATE_OFF,
 				  CONFIG_FW_PSTATE_SIZE);
-	if (rv)
+	if (rv) {
+		flash_invalidate(CONFIG_FW_PSTATE_OFF, CONFIG_FW_PSTATE_SIZE);
 		return rv;
+	}
 
 	/*
 	 * Note that if we lose power in here, we'll lose the pstate contents.
@@ -189,8 +237,10 @@ static int flash_write_pstate(uint32_t flags)
 	pstate.version = PERSIST_STATE_VERSION;
 	if (flags & EC_FLASH_PROTECT_RO_AT_BOOT)
 		pstate.flags |= PERSIST_FLAG_PROTECT_RO;
-	return flash_physical_write(CONFIG_FW_PSTATE_OFF, sizeof(pstate),
-				    (const char *)&pstate);
+	rv = flash_physical_write(CONFIG_FW_PSTATE_OFF, sizeof(pstate),
+				  (const char *)&pstate);
+	flash_invalidate(CONFIG_FW_PSTATE_OFF, CONFIG_FW_PSTATE_SIZE);
+	return rv;
 }
 
 #else /* !CONFIG_FLASH_PSTATE_BANK */
@@ -231,6 +281,7 @@ static uint32_t flash_read_pstate(void)
 static int flash_write_pstate(uint32_t flags)
 {
 	const uint32_t new_pstate = PSTATE_MAGIC_LOCKED;
+	int rv;
 
 	/* Only check the flags we write to pstate */
 	flags &= EC_FLASH_PROTECT_RO_AT_BOOT;
@@ -246,17 +297,24 @@ static int flash_write_pstate(uint32_t flags)
 	/*
 	 * Write a new pstate.  We can overwrite the existing value, because
 	 * we're only moving bits from the erased state to the unerased state.
+	 * The pstate lives in the RO image, so this changes its hash.
 	 */
-	return flash_physical_write(get_pstate_addr() -
-				    CONFIG_PROGRAM_MEMORY_BASE,
-				    sizeof(new_pstate),
-				    (const char *)&new_pstate);
+	flash_invalidate(get_pstate_addr() - CONFIG_PROGRAM_MEMORY_BASE,
+			 sizeof(new_pstate));
+	rv = flash_physical_write(get_pstate_addr() -
+				  CONFIG_PROGRAM_MEMORY_BASE,
+				  sizeof(new_pstate),
+				  (const char *)&new_pstate);
+	flash_invalidate(get_pstate_addr() - CONFIG_PROGRAM_MEMORY_BASE,
+			 sizeof(new_pstate));
+	return rv;
 }
 
 #endif /* !CONFIG_FLASH_PSTATE_BANK */
 #endif /* CONFIG_FLASH_PSTATE */
 
-int flash_is_erased(uint32_t offset, int size)
+/* Check a region of flash is erased by reading it */
+static int flash_scan_erased(uint32_t offset, int size)
 {
 	const uint32_t *ptr;
 
@@ -294,6 +352,27 @@ int flash_is_erased(uint32_t offset, int size)
 	return 1;
 }
 
+int flash_is_erased(uint32_t offset, int size)
+{
+	int block, chunk;
+
+	/* Only read blocks which aren't known to be erased */
+	while (size > 0) {
+		block = offset / CONFIG_FLASH_ERASE_SIZE;
+		chunk = MIN(size, (block + 1) * CONFIG_FLASH_ERASE_SIZE -
+			    (int)offset);
+
+		if (block >= ERASE_BLOCKS || !flash_known_erased(block))
+			if (!flash_scan_erased(offset, chunk))
+				return 0;
+
+		offset += chunk;
+		size -= chunk;
+	}
+
+	return 1;
+}
+
 int flash_read(int offset, int size, char *data)
 {
 #ifdef CONFIG_MAPPED_STORAGE
@@ -311,6 +390,8 @@ int flash_read(int offset, int size, char *data)
 
 int flash_write(int offset, int size, const char *data)
 {
+	int rv;
+
 	if (!flash_range_ok(offset, size, CONFIG_FLASH_WRITE_SIZE))
 		return EC_ERROR_INVAL;  /* Invalid range */
 
@@ -326,11 +407,22 @@ int flash_write(int offset, int size, const char *data)
 		vboot_hash_invalidate(offset, size);
 #endif
 
-	return flash_physical_write(offset, size, data);
+	/*
+	 * Change the generation before as well as after, so that a hash of
+	 * the range taken while it is being written is not cached as current.
+	 */
+	flash_invalidate(offset, size);
+	rv = flash_physical_write(offset, size, data);
+
+	/* Count even failed attempts, which may have changed some data */
+	flash_invalidate(offset, size);
+	return rv;
 }
 
 int flash_erase(int offset, int size)
 {
+	int rv;
+
 	if (!flash_range_ok(offset, size, CONFIG_FLASH_ERASE_SIZE))
 		return EC_ERROR_INVAL;  /* Invalid range */
 
@@ -346,7 +438,26 @@ int flash_erase(int offset, int size)
 		vboot_hash_invalidate(offset, size);
 #endif
 
-	return flash_physical_erase(offset, size);
+	/* Before and after, as for flash_write() */
+	flash_invalidate(offset, size);
+	rv = flash_physical_erase(offset, size);
+
+	/* Count even failed attempts, which may have changed some data */
+	flash_invalidate(offset, size);
+	if (rv == EC_SUCCESS)
+		flash_mark_erased(offset, size, 1);
+	return rv;
+}
+
+void flash_invalidate(int offset, int size)
+{
+	flash_mark_erased(offset, size, 0);
+	flash_generation++;
+}
+
+uint32_t flash_get_generation(void)
+{
+	return flash_generation;
 }
 
 int flash_protect_at_boot(enum flash_wp_range range)
@@ -855,6 +966,123 @@ DECLARE_HOST_COMMAND(EC_CMD_FLASH_ERASE,
 		     flash_command_erase,
 		     EC_VER_MASK(0));
 
+static int flash_command_blank_check(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_blank_check *p = args->params;
+	uint32_t offset = p->offset + EC_FLASH_REGION_START;
+	uint8_t *erased = args->response;
+	int count = p->size / CONFIG_FLASH_ERASE_SIZE;
+	int size = DIV_ROUND_UP(count, 8);
+	int i;
+
+	if (!flash_range_ok(offset, p->size, CONFIG_FLASH_ERASE_SIZE) ||
+	    p->size > EC_FLASH_BLANK_CHECK_MAX_SIZE)
+		return EC_RES_INVALID_PARAM;
+
+	if (size > args->response_max)
+		return EC_RES_OVERFLOW;
+
+	/* The response may overwrite the params, so they're not used below */
+	memset(erased, 0, size);
+	for (i = 0; i < count; i++, offset += CONFIG_FLASH_ERASE_SIZE)
+		if (flash_is_erased(offset, CONFIG_FLASH_ERASE_SIZE))
+			erased[i / 8] |= 1 << (i % 8);
+
+	args->response_size = size;
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_BLANK_CHECK,
+		     flash_command_blank_check,
+		     EC_VER_MASK(EC_VER_FLASH_BLANK_CHECK));
+
+#ifdef CONFIG_FLASH_HASH
+/**
+ * Compute the SHA-256 digest of a block of flash.
+ *
+ * @param offset	Flash offset of block
+ * @param size		Size of block in bytes
+ * @param digest	Destination for SHA256_DIGEST_SIZE byte digest
+ *
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+static int flash_hash_block(int offset, int size, uint8_t *digest)
+{
+	/* Too big for the host command task stack; commands run one at once */
+	static struct sha256_ctx ctx;
+#ifdef CONFIG_MAPPED_STORAGE
+	const char *src;
+
+	if (flash_dataptr(offset, size, 1, &src) < 0)
+		return EC_ERROR_INVAL;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (const uint8_t *)src, size);
+#else
+	uint32_t buf[SHA256_BLOCK_SIZE / sizeof(uint32_t)];
+	int chunk;
+	int rv;
+
+	if (!flash_range_ok(offset, size, 1))
+		return EC_ERROR_INVAL;
+
+	/* Read through a small buffer, to hash without shared memory */
+	SHA256_init(&ctx);
+	for (; size > 0; offset += chunk, size -= chunk) {
+		chunk = MIN(size, sizeof(buf));
+		rv = flash_read(offset, chunk, (char *)buf);
+		if (rv) {
+			SHA256_abort(&ctx);
+			return rv;
+		}
+		SHA256_update(&ctx, (const uint8_t *)buf, chunk);
+	}
+#endif
+	memcpy(digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+	return EC_SUCCESS;
+}
+
+static int flash_command_hash(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_hash *p = args->params;
+	struct ec_flash_hash_block block[EC_FLASH_HASH_MAX_BLOCKS];
+	uint8_t *digest = args->response;
+	int count = p->block_count;
+	uint32_t total = 0;
+	int i;
+
+	if (p->hash_type != EC_FLASH_HASH_TYPE_SHA256 ||
+	    count > EC_FLASH_HASH_MAX_BLOCKS ||
+	    sizeof(*p) + count * sizeof(block[0]) > args->params_size)
+		return EC_RES_INVALID_PARAM;
+
+	if (count * SHA256_DIGEST_SIZE > args->response_max)
+		return EC_RES_OVERFLOW;
+
+	/* Digests may overwrite the blocks if the buffers are shared */
+	memcpy(block, p->block, count * sizeof(block[0]));
+
+	/* Bound the time spent hashing without yielding */
+	for (i = 0; i < count; i++) {
+		if (block[i].size > EC_FLASH_HASH_MAX_SIZE - total)
+			return EC_RES_INVALID_PARAM;
+		total += block[i].size;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (flash_hash_block(block[i].offset + EC_FLASH_REGION_START,
+				     block[i].size, digest))
+			return EC_RES_INVALID_PARAM;
+		digest += SHA256_DIGEST_SIZE;
+	}
+
+	args->response_size = count * SHA256_DIGEST_SIZE;
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_HASH,
+		     flash_command_hash,
+		     EC_VER_MASK(EC_VER_FLASH_HASH));
+#endif /* CONFIG_FLASH_HASH */
+
 static int flash_command_protect(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_flash_protect *p = args->params;
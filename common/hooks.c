@@ -10,6 +10,7 @@
 #include "hooks.h"
 #include "link_defs.h"
 #include "timer.h"
+#include "trace.h"
 #include "util.h"
 
 #ifdef CONFIG_HOOK_DEBUG
@@ -22,6 +23,12 @@
 
 #define DEFERRED_FUNCS_COUNT (__deferred_funcs_end - __deferred_funcs)
 
+/*
+ * The tick doesn't need an exact period, so let it run a little late if that
+ * lets it share a wakeup with another task's timer.
+ */
+#define HOOK_TICK_SLACK (HOOK_TICK_INTERVAL / 16)
+
 struct hook_ptrs {
 	const struct hook_data *start;
 	const struct hook_data *end;
@@ -50,11 +57,34 @@ static const struct hook_ptrs hook_list[] = {
 	{__hooks_second, __hooks_second_end},
 };
 
+/*
+ * Hooks of each type in priority order.  Each type's entries in hook_order[]
+ * are indices into that type's section; hook_order_start[] says where those
+ * entries begin, or is -1 if the type didn't fit and must be scanned.
+ */
+static uint8_t hook_order[CONFIG_HOOK_SORTED_MAX];
+static int16_t hook_order_start[ARRAY_SIZE(hook_list)];
+static int hooks_sorted;
+
 /* Times for deferrable functions */
 static uint64_t defer_until[DEFERRABLE_MAX_COUNT];
-static int defer_new_call;
 static int hook_task_started;
 
+/*
+ * Pending deferred calls, as a min-heap of deferred function indices ordered
+ * by deadline.  Only the hook task touches the heap.  hook_call_deferred()
+ * just updates defer_until[] and flags the index in defer_changed[]; the
+ * hook task then moves changed entries into or out of the heap.
+ */
+#define DEFER_MASK_WORDS ((DEFERRABLE_MAX_COUNT + 31) / 32)
+static uint32_t defer_changed[DEFER_MASK_WORDS];
+static uint8_t defer_heap[DEFERRABLE_MAX_COUNT];
+static int defer_heap_size;
+/* Deadline each index was queued with */
+static uint64_t defer_heap_time[DEFERRABLE_MAX_COUNT];
+/* Position of each index in the heap plus 1, or 0 if not queued */
+static uint8_t defer_heap_pos[DEFERRABLE_MAX_COUNT];
+
 #ifdef CONFIG_HOOK_DEBUG
 /* Stats for hooks */
 static uint64_t max_hook_tick_delay;
@@ -65,6 +95,15 @@ static uint64_t avg_hook_tick_delay;
 static uint64_t avg_hook_second_delay;
 static uint64_t avg_hook_run_time[ARRAY_SIZE(hook_list)];
 
+/* Deferred call counts, and how late they ran relative to their deadline */
+static uint32_t deferred_calls[DEFERRABLE_MAX_COUNT];
+static uint32_t max_deferred_late[DEFERRABLE_MAX_COUNT];
+static uint32_t avg_deferred_late[DEFERRABLE_MAX_COUNT];
+
+/* Per-hook stats, indexed the same as hook_order[] */
+static uint32_t max_hook_routine_time[CONFIG_HOOK_SORTED_MAX];
+static uint32_t avg_hook_routine_time[CONFIG_HOOK_SORTED_MAX];
+
 static inline void update_hook_average(uint64_t *avg, uint64_t time)
 {
 	*avg = (*avg * 7 + time) >> 3;
@@ -89,23 +128,57 @@ static void record_hook_delay(uint64_t now, uint64_t last, uint64_t interval,
 }
 #endif
 
-void hook_notify(enum hook_type type)
+/**
+ * Sort each type of hook by priority into hook_order[].
+ *
+ * Hooks with the same priority stay in link order, which is the order the
+ * unsorted scan called them in.
+ */
+static void hook_sort(void)
 {
-	const struct hook_data *start, *end, *p;
-	int count, called = 0;
-	int last_prio = HOOK_PRIO_FIRST - 1, prio;
-#ifdef CONFIG_HOOK_DEBUG
-	uint64_t start_time = get_time().val;
-	uint64_t run_time;
-#endif
+	const struct hook_data *start;
+	uint8_t *order;
+	int type, count, used = 0;
+	int i, j;
 
-	CPRINTS("hook notify %d", type);
+	for (type = 0; type < ARRAY_SIZE(hook_list); type++) {
+		start = hook_list[type].start;
+		count = hook_list[type].end - start;
 
-	start = hook_list[type].start;
-	end = hook_list[type].end;
-	count = end - start;
+		if (count > 255 || used + count > CONFIG_HOOK_SORTED_MAX) {
+			hook_order_start[type] = -1;
+			continue;
+		}
+
+		/* Insertion sort; the lists are short and mostly in order */
+		order = hook_order + used;
+		for (i = 0; i < count; i++) {
+			for (j = i; j > 0 && start[order[j - 1]].priority >
+					     start[i].priority; j--)
+				order[j] = order[j - 1];
+			order[j] = i;
+		}
+
+		hook_order_start[type] = used;
+		used += count;
+	}
+
+	hooks_sorted = 1;
+}
+
+/**
+ * Call hooks in priority order without a sorted table.
+ *
+ * Scans the whole list once to find each priority, and again to call the
+ * hooks with it.
+ */
+static void hook_notify_scan(const struct hook_data *start,
+			     const struct hook_data *end)
+{
+	const struct hook_data *p;
+	int count = end - start, called = 0;
+	int last_prio = HOOK_PRIO_FIRST - 1, prio;
 
-	/* Call all the hooks in priority order */
 	while (called < count) {
 		/* Find the lowest remaining priority */
 		for (p = start, prio = HOOK_PRIO_LAST + 1; p < end; p++) {
@@ -122,6 +195,55 @@ void hook_notify(enum hook_type type)
 			}
 		}
 	}
+}
+
+void hook_notify(enum hook_type type)
+{
+	const struct hook_data *start, *end;
+	const uint8_t *order;
+	int count, i;
+#ifdef CONFIG_HOOK_DEBUG
+	uint64_t start_time = get_time().val;
+	uint64_t run_time;
+	uint32_t t, routine_time;
+	int slot;
+#endif
+
+	CPRINTS("hook notify %d", type);
+	TRACE_BEGIN(EC_TRACE_ID_HOOK, type);
+
+	/*
+	 * Sort on first use.  The first hooks are called from main() or the
+	 * hook task before other tasks run, so this can't race.
+	 */
+	if (!hooks_sorted)
+		hook_sort();
+
+	start = hook_list[type].start;
+	end = hook_list[type].end;
+	count = end - start;
+
+	if (hook_order_start[type] < 0) {
+		hook_notify_scan(start, end);
+	} else {
+		/* Call all the hooks in priority order */
+		order = hook_order + hook_order_start[type];
+		for (i = 0; i < count; i++) {
+#ifdef CONFIG_HOOK_DEBUG
+			t = get_time().le.lo;
+#endif
+			start[order[i]].routine();
+#ifdef CONFIG_HOOK_DEBUG
+			routine_time = get_time().le.lo - t;
+			slot = hook_order_start[type] + i;
+			if (routine_time > max_hook_routine_time[slot])
+				max_hook_routine_time[slot] = routine_time;
+			avg_hook_routine_time[slot] =
+				(avg_hook_routine_time[slot] * 7 +
+				 routine_time) >> 3;
+#endif
+		}
+	}
 
 #ifdef CONFIG_HOOK_DEBUG
 	run_time = get_time().val - start_time;
@@ -129,35 +251,108 @@ void hook_notify(enum hook_type type)
 		max_hook_run_time[type] = run_time;
 	update_hook_average(avg_hook_run_time + type, run_time);
 #endif
+	TRACE_END(EC_TRACE_ID_HOOK, type);
 }
 
-int hook_call_deferred(void (*routine)(void), int us)
+/* Place an entry at a heap position */
+static void defer_heap_put(int pos, int i)
 {
-	const struct deferred_data *p;
-	int i;
+	defer_heap[pos] = i;
+	defer_heap_pos[i] = pos + 1;
+}
 
-	/* Find the index of the routine */
-	for (p = __deferred_funcs; p < __deferred_funcs_end; p++) {
-		if (p->routine == routine)
+/* Move the entry at a heap position up or down to where it belongs */
+static void defer_heap_fix(int pos)
+{
+	int i = defer_heap[pos];
+	uint64_t t = defer_heap_time[i];
+	int child;
+
+	/* Up */
+	while (pos && defer_heap_time[defer_heap[(pos - 1) / 2]] > t) {
+		defer_heap_put(pos, defer_heap[(pos - 1) / 2]);
+		pos = (pos - 1) / 2;
+	}
+
+	/* Down */
+	while ((child = 2 * pos + 1) < defer_heap_size) {
+		if (child + 1 < defer_heap_size &&
+		    defer_heap_time[defer_heap[child + 1]] <
+		    defer_heap_time[defer_heap[child]])
+			child++;
+		if (defer_heap_time[defer_heap[child]] >= t)
 			break;
+		defer_heap_put(pos, defer_heap[child]);
+		pos = child;
 	}
-	if (p >= __deferred_funcs_end)
-		return EC_ERROR_INVAL;  /* Routine not registered */
 
-	i = p - __deferred_funcs;
+	defer_heap_put(pos, i);
+}
+
+static void defer_heap_remove(int i)
+{
+	int pos = defer_heap_pos[i] - 1;
+
+	defer_heap_pos[i] = 0;
+	if (--defer_heap_size == pos)
+		return;
+
+	/* Fill the hole with the last entry */
+	defer_heap_put(pos, defer_heap[defer_heap_size]);
+	defer_heap_fix(pos);
+}
+
+/* Bring the heap up to date with calls to hook_call_deferred() */
+static void defer_heap_update(void)
+{
+	uint32_t changed;
+	int w, i;
+
+	for (w = 0; w < DEFER_MASK_WORDS; w++) {
+		changed = atomic_read_clear(defer_changed + w);
+		while (changed) {
+			i = w * 32 + get_next_bit(&changed);
+
+			if (!defer_until[i]) {
+				/* Cancelled */
+				if (defer_heap_pos[i])
+					defer_heap_remove(i);
+				continue;
+			}
+
+			defer_heap_time[i] = defer_until[i];
+			if (!defer_heap_pos[i])
+				defer_heap_put(defer_heap_size++, i);
+			defer_heap_fix(defer_heap_pos[i] - 1);
+		}
+	}
+}
+
+static int defer_heap_changed(void)
+{
+	int w;
+
+	for (w = 0; w < DEFER_MASK_WORDS; w++)
+		if (defer_changed[w])
+			return 1;
+	return 0;
+}
+
+int hook_call_deferred_data(const struct deferred_data *data, int us)
+{
+	int i = data - __deferred_funcs;
+
+	if (data < __deferred_funcs || data >= __deferred_funcs_end)
+		return EC_ERROR_INVAL;  /* Routine not registered */
 
 	if (us == -1) {
 		/* Cancel */
 		defer_until[i] = 0;
+		atomic_or(defer_changed + i / 32, 1U << (i % 32));
 	} else {
 		/* Set alarm */
 		defer_until[i] = get_time().val + us;
-		/*
-		 * Flag that hook_call_deferred() has been called.  If the hook
-		 * task is already active, this will allow it to go through the
-		 * loop one more time before sleeping.
-		 */
-		defer_new_call = 1;
+		atomic_or(defer_changed + i / 32, 1U << (i % 32));
 
 		/* Wake task so it can re-sleep for the proper time */
 		if (hook_task_started)
@@ -167,12 +362,28 @@ int hook_call_deferred(void (*routine)(void), int us)
 	return EC_SUCCESS;
 }
 
+int hook_call_deferred(void (*routine)(void), int us)
+{
+	const struct deferred_data *p;
+
+	/* Find the routine; callers which know it can skip this */
+	for (p = __deferred_funcs; p < __deferred_funcs_end; p++) {
+		if (p->routine == routine)
+			return hook_call_deferred_data(p, us);
+	}
+
+	return EC_ERROR_INVAL;  /* Routine not registered */
+}
+
 void hook_task(void)
 {
 	/* Periodic hooks will be called first time through the loop */
 	static uint64_t last_second = -SECOND;
 	static uint64_t last_tick = -HOOK_TICK_INTERVAL;
 
+	/* Checked at link time on real chips, but not by the emulator */
+	ASSERT(DEFERRED_FUNCS_COUNT <= DEFERRABLE_MAX_COUNT);
+
 	hook_task_started = 1;
 
 	/* Call HOOK_INIT hooks. */
@@ -184,20 +395,49 @@ void hook_task(void)
 	while (1) {
 		uint64_t t = get_time().val;
 		int next = 0;
+		int slack = 0;
 		int i;
+#ifdef CONFIG_HOOK_DEBUG
+		uint32_t late;
+#endif
 
-		/* Handle deferred routines */
-		for (i = 0; i < DEFERRED_FUNCS_COUNT; i++) {
-			if (defer_until[i] && defer_until[i] < t) {
-				CPRINTS("hook call deferred 0x%p",
-					__deferred_funcs[i].routine);
-				/*
-				 * Call deferred function.  Clear timer first,
-				 * so it can request itself be called later.
-				 */
-				defer_until[i] = 0;
-				__deferred_funcs[i].routine();
-			}
+		/* Handle deferred routines whose time has come */
+		defer_heap_update();
+		while (defer_heap_size &&
+		       defer_heap_time[defer_heap[0]] < t) {
+			i = defer_heap[0];
+			defer_heap_remove(i);
+
+			/*
+			 * Skip it if it was moved or cancelled since the heap
+			 * was updated; the change is still flagged and will
+			 * be picked up next time round.
+			 */
+			if (defer_until[i] != defer_heap_time[i])
+				continue;
+
+			CPRINTS("hook call deferred 0x%p",
+				__deferred_funcs[i].routine);
+#ifdef CONFIG_HOOK_DEBUG
+			late = get_time().val - defer_heap_time[i];
+			deferred_calls[i]++;
+			if (late > max_deferred_late[i])
+				max_deferred_late[i] = late;
+			avg_deferred_late[i] =
+				(avg_deferred_late[i] * 7 + late) >> 3;
+#endif
+			/*
+			 * Call deferred function.  Clear timer first, so it
+			 * can request itself be called later.
+			 */
+			defer_until[i] = 0;
+			TRACE_BEGIN(EC_TRACE_ID_DEFERRED,
+				    (uint32_t)(uintptr_t)
+				    __deferred_funcs[i].routine);
+			__deferred_funcs[i].routine();
+			TRACE_END(EC_TRACE_ID_DEFERRED,
+				  (uint32_t)(uintptr_t)
+				  __deferred_funcs[i].routine);
 		}
 
 		if (t - last_tick >= HOOK_TICK_INTERVAL) {
@@ -222,28 +462,31 @@ void hook_task(void)
 
 		/* Calculate when next tick needs to occur */
 		t = get_time().val;
-		if (last_tick + HOOK_TICK_INTERVAL > t)
+		if (last_tick + HOOK_TICK_INTERVAL > t) {
 			next = last_tick + HOOK_TICK_INTERVAL - t;
+			slack = HOOK_TICK_SLACK;
+		}
 
 		/* Wake earlier if needed by a deferred routine */
-		defer_new_call = 0;
-		for (i = 0; i < DEFERRED_FUNCS_COUNT && next > 0; i++) {
-			if (!defer_until[i])
-				continue;
+		defer_heap_update();
+		if (defer_heap_size && next > 0) {
+			uint64_t deadline = defer_heap_time[defer_heap[0]];
 
-			if (defer_until[i] < t)
+			if (deadline < t) {
 				next = 0;
-			else if (defer_until[i] - t < next)
-				next = defer_until[i] - t;
+			} else if (deadline - t < next) {
+				next = deadline - t;
+				slack = 0;
+			}
 		}
 
 		/*
 		 * If nothing is immediately pending, and hook_call_deferred()
-		 * hasn't been called since we started calculating next, sleep
-		 * until the next event.
+		 * hasn't been called since we updated the heap, sleep until
+		 * the next event.
 		 */
-		if (next > 0 && !defer_new_call)
-			task_wait_event(next);
+		if (next > 0 && !defer_heap_changed())
+			task_wait_event_slack(next, slack);
 	}
 }
 
@@ -261,6 +504,27 @@ static void print_hook_delay(uint32_t interval, uint32_t delay, uint32_t avg)
 	ccprintf("  Average:     %7d us (%d%%)\n\n", avg, percent_avg);
 }
 
+static void print_hook_routines(int type)
+{
+	const struct hook_data *start = hook_list[type].start;
+	const uint8_t *order;
+	int count = hook_list[type].end - start;
+	int i, slot;
+
+	if (!hooks_sorted || hook_order_start[type] < 0)
+		return;
+
+	order = hook_order + hook_order_start[type];
+	for (i = 0; i < count; i++) {
+		slot = hook_order_start[type] + i;
+		ccprintf("    0x%p prio %4d:%6d us (Avg: %5d us)\n",
+			 start[order[i]].routine, start[order[i]].priority,
+			 max_hook_routine_time[slot],
+			 avg_hook_routine_time[slot]);
+	}
+	cflush();
+}
+
 static int command_stats(int argc, char **argv)
 {
 	int i;
@@ -272,11 +536,21 @@ static int command_stats(int argc, char **argv)
 	ccprintf("HOOK_SECOND:\n");
 	print_hook_delay(SECOND, max_hook_second_delay, avg_hook_second_delay);
 
+	ccprintf("Deferred calls:\n");
+	for (i = 0; i < DEFERRED_FUNCS_COUNT; i++) {
+		ccprintf("  0x%p: %8d calls, late max %6d us (Avg: %5d us)\n",
+			 __deferred_funcs[i].routine, deferred_calls[i],
+			 max_deferred_late[i], avg_deferred_late[i]);
+	}
+	cflush();
+
 	ccprintf("Max run time for each hook:\n");
-	for (i = 0; i < ARRAY_SIZE(hook_list); ++i)
+	for (i = 0; i < ARRAY_SIZE(hook_list); ++i) {
 		ccprintf("%3d:%6d us (Avg: %5d us)\n", i,
 			 (uint32_t)max_hook_run_time[i],
 			 (uint32_t)avg_hook_run_time[i]);
+		print_hook_routines(i);
+	}
 
 	return EC_SUCCESS;
 }
@@ -15,6 +15,7 @@
 #include "system.h"
 #include "task.h"
 #include "timer.h"
+#include "trace.h"
 #include "util.h"
 
 /* Console output macros */
@@ -567,6 +568,10 @@ enum ec_status host_command_process(struct host_cmd_handler_args *args)
 	if (hcdebug)
 		host_command_debug_request(args);
 
+	/* Reading the trace isn't traced, so the host can drain it */
+	if (args->command != EC_CMD_TRACE_READ)
+		TRACE_BEGIN(EC_TRACE_ID_HOST_CMD, args->command);
+
 #ifdef HAS_TASK_PDCMD
 	if (args->command >= EC_CMD_PASSTHRU_OFFSET(1) &&
 	    args->command <= EC_CMD_PASSTHRU_MAX(1)) {
@@ -601,6 +606,8 @@ enum ec_status host_command_process(struct host_cmd_handler_args *args)
 		CPRINTS("HC resp:%.*h", args->response_size,
 			args->response);
 
+	if (args->command != EC_CMD_TRACE_READ)
+		TRACE_END(EC_TRACE_ID_HOST_CMD, rv);
 	return rv;
 }
 
@@ -758,6 +765,42 @@ DECLARE_HOST_COMMAND(EC_CMD_GET_FEATURES,
 		     host_command_get_features,
 		     EC_VER_MASK(0));
 
+#ifdef CONFIG_TASK_PROFILING
+static int host_command_task_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_task_stats *p = args->params;
+	struct ec_response_task_stats *r = args->response;
+	struct ec_task_stats *out = (struct ec_task_stats *)(r + 1);
+	int max = (args->response_max - sizeof(*r)) / sizeof(*out);
+	struct task_stats stats;
+	int i;
+
+	if (p->first > TASK_ID_COUNT)
+		return EC_RES_INVALID_PARAM;
+
+	r->task_count = TASK_ID_COUNT;
+	r->count = 0;
+	r->reserved = 0;
+
+	for (i = p->first; i < TASK_ID_COUNT && r->count < max; i++) {
+		task_get_stats(i, &stats);
+		memset(out->name, 0, sizeof(out->name));
+		strzcpy(out->name, task_get_name(i), sizeof(out->name));
+		out->runtime = stats.runtime;
+		out->switches = stats.switches;
+		out->max_run = stats.max_run;
+		out++;
+		r->count++;
+	}
+
+	args->response_size = sizeof(*r) + r->count * sizeof(*out);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TASK_STATS,
+		     host_command_task_stats,
+		     EC_VER_MASK(0));
+#endif
+
 
 /*****************************************************************************/
 /* Console commands */
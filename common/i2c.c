@@ -14,6 +14,7 @@
 #include "i2c.h"
 #include "system.h"
 #include "task.h"
+#include "trace.h"
 #include "util.h"
 #include "watchdog.h"
 
@@ -40,12 +41,14 @@ int i2c_xfer(int port, int slave_addr, const uint8_t *out, int out_size,
 	int i;
 	int ret = EC_SUCCESS;
 
+	TRACE_BEGIN(EC_TRACE_ID_I2C_XFER, port << 8 | slave_addr);
 	for (i = 0; i <= CONFIG_I2C_NACK_RETRY_COUNT; i++) {
 		ret = chip_i2c_xfer(port, slave_addr, out, out_size, in,
 			in_size, flags);
 		if (ret != EC_ERROR_BUSY)
 			break;
 	}
+	TRACE_END(EC_TRACE_ID_I2C_XFER, ret);
 	return ret;
 }
 
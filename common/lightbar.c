@@ -24,6 +24,7 @@
 #include "system.h"
 #include "task.h"
 #include "timer.h"
+#include "trace.h"
 #include "util.h"
 #endif
 
@@ -38,6 +39,7 @@
 /* Console output macros */
 #define CPUTS(outstr) cputs(CC_LIGHTBAR, outstr)
 #define CPRINTS(format, args...) cprints(CC_LIGHTBAR, format, ## args)
+#define CTPRINTS(format, args...) ctprints(CC_LIGHTBAR, format, ## args)
 
 #define FP_SCALE 10000
 
@@ -541,8 +543,10 @@ static uint32_t pending_msg;
 
 /* Interruptible delay. */
 #define WAIT_OR_RET(A) do {				\
-		uint32_t msg = task_wait_event(A);	\
-		uint32_t p_msg = pending_msg;		\
+		uint32_t msg, p_msg;			\
+		TRACE_INSTANT(EC_TRACE_ID_LIGHTBAR_FRAME, st.cur_seq); \
+		msg = task_wait_event(A);		\
+		p_msg = pending_msg;			\
 		if (TASK_EVENT_CUSTOM(msg) == PENDING_MSG &&	\
 		    p_msg != st.cur_seq)			\
 			return p_msg; } while (0)
@@ -1672,7 +1676,7 @@ static uint32_t sequence_PROGRAM(void)
 			lb_set_brightness(saved_brightness);
 			return EC_RES_INVALID_PARAM;
 		} else {
-			CPRINTS("LB PROGRAM pc: 0x%02x, opcode 0x%02x -> %s",
+			CTPRINTS("LB PROGRAM pc: 0x%02x, opcode 0x%02x -> %s",
 				 old_pc, next_inst, lightbyte_names[next_inst]);
 			rc = lightbyte_dispatch[next_inst]();
 			if (rc) {
@@ -1721,7 +1725,9 @@ void lightbar_task(void)
 		CPRINTS("LB running cur_seq %d %s. prev_seq %d %s",
 			st.cur_seq, lightbar_cmds[st.cur_seq].string,
 			st.prev_seq, lightbar_cmds[st.prev_seq].string);
+		TRACE_BEGIN(EC_TRACE_ID_LIGHTBAR_SEQ, st.cur_seq);
 		next_seq = lightbar_cmds[st.cur_seq].sequence();
+		TRACE_END(EC_TRACE_ID_LIGHTBAR_SEQ, next_seq);
 		if (next_seq) {
 			CPRINTS("LB cur_seq %d %s returned pending msg %d %s",
 				st.cur_seq, lightbar_cmds[st.cur_seq].string,
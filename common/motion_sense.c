@@ -30,6 +30,7 @@
 #define CPUTS(outstr) cputs(CC_MOTION_SENSE, outstr)
 #define CPRINTS(format, args...) cprints(CC_MOTION_SENSE, format, ## args)
 #define CPRINTF(format, args...) cprintf(CC_MOTION_SENSE, format, ## args)
+#define CTPRINTS(format, args...) ctprints(CC_MOTION_SENSE, format, ## args)
 
 /*
  * Sampling interval for measuring acceleration and calculating lid angle.
@@ -767,6 +768,18 @@ void motion_sense_task(void)
 #endif
 #ifdef CONFIG_CMD_ACCEL_INFO
 		if (accel_disp) {
+#ifdef CONFIG_CONSOLE_TOKENIZED
+			/* One record per sensor; tokens can't be appended to */
+			for (i = 0; i < motion_sensor_count; ++i) {
+				sensor = &motion_sensors[i];
+				CTPRINTS("event 0x%08x %s=%-5d, %-5d, %-5d",
+					 event, sensor->name, sensor->xyz[X],
+					 sensor->xyz[Y], sensor->xyz[Z]);
+			}
+#ifdef CONFIG_LID_ANGLE
+			CTPRINTS("a=%-4d", motion_lid_get_angle());
+#endif
+#else
 			CPRINTF("[%T event 0x%08x ", event);
 			for (i = 0; i < motion_sensor_count; ++i) {
 				sensor = &motion_sensors[i];
@@ -779,6 +792,7 @@ void motion_sense_task(void)
 			CPRINTF("a=%-4d", motion_lid_get_angle());
 #endif
 			CPRINTF("]\n");
+#endif
 		}
 #endif
 #ifdef UPDATE_HOST_MEM_MAP
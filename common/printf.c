@@ -50,8 +50,27 @@ static int hexdigit(int c)
 #define PF_NEGATIVE	(1 << 2)  /* Number is negative */
 #define PF_64BIT	(1 << 3)  /* Number is 64-bit */
 
-int vfnprintf(int (*addchar)(void *context, int c), void *context,
-	      const char *format, va_list args)
+/**
+ * Output a run of characters through addstr() if present, else addchar().
+ *
+ * @return 0 if all characters were accepted, non-zero if any were dropped.
+ */
+static int addchars(int (*addchar)(void *context, int c),
+		    int (*addstr)(void *context, const char *str, int len),
+		    void *context, const char *str, int len)
+{
+	if (addstr)
+		return addstr(context, str, len);
+
+	while (len-- > 0)
+		if (addchar(context, *str++))
+			return 1;
+	return 0;
+}
+
+int vfnprintf_bulk(int (*addchar)(void *context, int c),
+		   int (*addstr)(void *context, const char *str, int len),
+		   void *context, const char *format, va_list args)
 {
 	/*
 	 * Longest uint64 in decimal = 20
@@ -69,9 +88,14 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 	while (*format) {
 		int c = *format++;
 
-		/* Copy normal characters */
+		/* Copy normal characters, up to the next format code */
 		if (c != '%') {
-			if (addchar(context, c))
+			const char *start = format - 1;
+
+			while (*format && *format != '%')
+				format++;
+			if (addchars(addchar, addstr, context, start,
+				     format - start))
 				return EC_ERROR_OVERFLOW;
 			continue;
 		}
@@ -283,15 +307,15 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 		/* If precision is zero, print everything */
 		if (!precision)
 			precision = MAX(vlen, pad_width);
+		precision = MIN(vlen, precision);
 
 		while (vlen < pad_width && !(flags & PF_LEFT)) {
 			if (addchar(context, flags & PF_PADZERO ? '0' : ' '))
 				return EC_ERROR_OVERFLOW;
 			vlen++;
 		}
-		while (*vstr && --precision >= 0)
-			if (addchar(context, *vstr++))
-				return EC_ERROR_OVERFLOW;
+		if (addchars(addchar, addstr, context, vstr, precision))
+			return EC_ERROR_OVERFLOW;
 		while (vlen < pad_width && flags & PF_LEFT) {
 			if (addchar(context, ' '))
 				return EC_ERROR_OVERFLOW;
@@ -303,6 +327,12 @@ int vfnprintf(int (*addchar)(void *context, int c), void *context,
 	return EC_SUCCESS;
 }
 
+int vfnprintf(int (*addchar)(void *context, int c), void *context,
+	      const char *format, va_list args)
+{
+	return vfnprintf_bulk(addchar, NULL, context, format, args);
+}
+
 /* Context for snprintf() */
 struct snprintf_context {
 	char *str;
@@ -328,6 +358,25 @@ static int snprintf_addchar(void *context, int c)
 	return 0;
 }
 
+/**
+ * Add a run of characters to the string context.
+ *
+ * @param context	Context receiving characters
+ * @param str		Characters to add
+ * @param len		Number of characters
+ * @return 0 if all characters added, 1 if some dropped because no space.
+ */
+static int snprintf_addstr(void *context, const char *str, int len)
+{
+	struct snprintf_context *ctx = (struct snprintf_context *)context;
+	int n = MIN(len, ctx->size);
+
+	memcpy(ctx->str, str, n);
+	ctx->str += n;
+	ctx->size -= n;
+	return n < len;
+}
+
 int snprintf(char *str, int size, const char *format, ...)
 {
 	struct snprintf_context ctx;
@@ -341,7 +390,8 @@ int snprintf(char *str, int size, const char *format, ...)
 	ctx.size = size - 1;  /* Reserve space for terminating '\0' */
 
 	va_start(args, format);
-	rv = vfnprintf(snprintf_addchar, &ctx, format, args);
+	rv = vfnprintf_bulk(snprintf_addchar, snprintf_addstr, &ctx, format,
+			    args);
 	va_end(args);
 
 	/* Terminate string */
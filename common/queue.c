@@ -5,6 +5,7 @@
  * Queue data structure implementation.
  */
 #include "queue.h"
+#include "task.h"
 #include "util.h"
 
 static void queue_action_null(struct queue_policy const *policy, size_t count)
@@ -23,8 +24,19 @@ void queue_init(struct queue const *q)
 	ASSERT(q->policy->add);
 	ASSERT(q->policy->remove);
 
-	q->state->head = 0;
-	q->state->tail = 0;
+	q->state->head    = 0;
+	q->state->tail    = 0;
+	q->state->reserve = 0;
+	q->state->writers = 0;
+}
+
+/*
+ * Wrap a unit index into the queue buffer.  The buffer size is a power of two
+ * (checked by queue_init), so this is a mask rather than a divide.
+ */
+static inline size_t queue_wrap(struct queue const *q, size_t i)
+{
+	return i & (q->buffer_units - 1);
 }
 
 int queue_is_empty(struct queue const *q)
@@ -70,8 +82,8 @@ int queue_is_full(struct queue const *q)
 
 struct queue_chunk queue_get_write_chunk(struct queue const *q)
 {
-	size_t head = q->state->head & (q->buffer_units - 1);
-	size_t tail = q->state->tail & (q->buffer_units - 1);
+	size_t head = queue_wrap(q, q->state->head);
+	size_t tail = queue_wrap(q, q->state->tail);
 	size_t last = (queue_is_full(q) ? tail : /* Full           */
 		       ((tail < head) ? head :   /* Wrapped        */
 			q->buffer_units));       /* Normal | Empty */
@@ -84,8 +96,8 @@ struct queue_chunk queue_get_write_chunk(struct queue const *q)
 
 struct queue_chunk queue_get_read_chunk(struct queue const *q)
 {
-	size_t head = q->state->head & (q->buffer_units - 1);
-	size_t tail = q->state->tail & (q->buffer_units - 1);
+	size_t head = queue_wrap(q, q->state->head);
+	size_t tail = queue_wrap(q, q->state->tail);
 	size_t last = (queue_is_empty(q) ? head : /* Empty          */
 		       ((head < tail) ? tail :    /* Normal         */
 			q->buffer_units));        /* Wrapped | Full */
@@ -118,9 +130,29 @@ size_t queue_advance_tail(struct queue const *q, size_t count)
 	return transfer;
 }
 
+static void queue_write_safe(struct queue const *q,
+			     const void *src,
+			     size_t tail,
+			     size_t transfer,
+			     void *(*memcpy)(void *dest,
+					     const void *src,
+					     size_t n))
+{
+	size_t first = MIN(transfer, q->buffer_units - tail);
+
+	memcpy(q->buffer + tail * q->unit_bytes,
+	       src,
+	       first * q->unit_bytes);
+
+	if (first < transfer)
+		memcpy(q->buffer,
+		       ((uint8_t const *) src) + first * q->unit_bytes,
+		       (transfer - first) * q->unit_bytes);
+}
+
 size_t queue_add_unit(struct queue const *q, const void *src)
 {
-	size_t tail = q->state->tail & (q->buffer_units - 1);
+	size_t tail = queue_wrap(q, q->state->tail);
 
 	if (queue_space(q) == 0)
 		return 0;
@@ -130,7 +162,12 @@ size_t queue_add_unit(struct queue const *q, const void *src)
 	else
 		memcpy(q->buffer + tail * q->unit_bytes, src, q->unit_bytes);
 
-	return queue_advance_tail(q, 1);
+	/* There is known to be space, so skip queue_advance_tail's check */
+	q->state->tail++;
+
+	q->policy->add(q->policy, 1);
+
+	return 1;
 }
 
 size_t queue_add_units(struct queue const *q, const void *src, size_t count)
@@ -146,17 +183,9 @@ size_t queue_add_memcpy(struct queue const *q,
 					size_t n))
 {
 	size_t transfer = MIN(count, queue_space(q));
-	size_t tail     = q->state->tail & (q->buffer_units - 1);
-	size_t first    = MIN(transfer, q->buffer_units - tail);
+	size_t tail     = queue_wrap(q, q->state->tail);
 
-	memcpy(q->buffer + tail * q->unit_bytes,
-	       src,
-	       first * q->unit_bytes);
-
-	if (first < transfer)
-		memcpy(q->buffer,
-		       ((uint8_t const *) src) + first * q->unit_bytes,
-		       (transfer - first) * q->unit_bytes);
+	queue_write_safe(q, src, tail, transfer, memcpy);
 
 	return queue_advance_tail(q, transfer);
 }
@@ -183,7 +212,7 @@ static void queue_read_safe(struct queue const *q,
 
 size_t queue_remove_unit(struct queue const *q, void *dest)
 {
-	size_t head = q->state->head & (q->buffer_units - 1);
+	size_t head = queue_wrap(q, q->state->head);
 
 	if (queue_count(q) == 0)
 		return 0;
@@ -193,7 +222,11 @@ size_t queue_remove_unit(struct queue const *q, void *dest)
 	else
 		memcpy(dest, q->buffer + head * q->unit_bytes, q->unit_bytes);
 
-	return queue_advance_head(q, 1);
+	q->state->head++;
+
+	q->policy->remove(q->policy, 1);
+
+	return 1;
 }
 
 size_t queue_remove_units(struct queue const *q, void *dest, size_t count)
@@ -209,7 +242,7 @@ size_t queue_remove_memcpy(struct queue const *q,
 					   size_t n))
 {
 	size_t transfer = MIN(count, queue_count(q));
-	size_t head     = q->state->head & (q->buffer_units - 1);
+	size_t head     = queue_wrap(q, q->state->head);
 
 	queue_read_safe(q, dest, head, transfer, memcpy);
 
@@ -236,10 +269,140 @@ size_t queue_peek_memcpy(struct queue const *q,
 	size_t transfer  = MIN(count, available - i);
 
 	if (i < available) {
-		size_t head = (q->state->head + i) & (q->buffer_units - 1);
+		size_t head = queue_wrap(q, q->state->head + i);
 
 		queue_read_safe(q, dest, head, transfer, memcpy);
 	}
 
 	return transfer;
 }
+
+/*
+ * Producers claim space by moving reserve forward, and the consumer only sees
+ * units up to tail.  Reservations are made and committed with interrupts
+ * disabled for a handful of instructions, which makes them atomic with
+ * respect to every other task and interrupt handler, without a mutex.  tail
+ * is only moved when no reservation is outstanding, so everything between
+ * tail and reserve is known to be written by then, however the producers'
+ * commits were ordered.
+ */
+struct queue_reservation queue_reserve_tail(struct queue const *q,
+					    size_t count)
+{
+	struct queue_reservation r;
+
+	interrupt_disable();
+
+	r.start = q->state->reserve;
+	r.count = MIN(count, q->buffer_units - (r.start - q->state->head));
+
+	if (r.count) {
+		q->state->reserve += r.count;
+		q->state->writers++;
+	}
+
+	interrupt_enable();
+
+	return r;
+}
+
+void queue_commit_tail(struct queue const *q,
+		       struct queue_reservation const *r)
+{
+	size_t transfer = 0;
+
+	if (!r->count)
+		return;
+
+	interrupt_disable();
+
+	if (--q->state->writers == 0) {
+		transfer = q->state->reserve - q->state->tail;
+		q->state->tail = q->state->reserve;
+	}
+
+	interrupt_enable();
+
+	if (transfer)
+		q->policy->add(q->policy, transfer);
+}
+
+struct queue_reservation queue_reserve_head(struct queue const *q,
+					    size_t count)
+{
+	return ((struct queue_reservation) {
+		.start = q->state->head,
+		.count = MIN(count, queue_count(q)),
+	});
+}
+
+size_t queue_commit_head(struct queue const *q,
+			 struct queue_reservation const *r)
+{
+	return queue_advance_head(q, r->count);
+}
+
+void *queue_reservation_unit(struct queue const *q,
+			     struct queue_reservation const *r,
+			     size_t i)
+{
+	return q->buffer + queue_wrap(q, r->start + i) * q->unit_bytes;
+}
+
+size_t queue_reservation_write(struct queue const *q,
+			       struct queue_reservation const *r,
+			       size_t i,
+			       const void *src,
+			       size_t count)
+{
+	size_t transfer = (i < r->count) ? MIN(count, r->count - i) : 0;
+
+	queue_write_safe(q, src, queue_wrap(q, r->start + i), transfer,
+			 memcpy);
+
+	return transfer;
+}
+
+size_t queue_reservation_read(struct queue const *q,
+			      struct queue_reservation const *r,
+			      size_t i,
+			      void *dest,
+			      size_t count)
+{
+	size_t transfer = (i < r->count) ? MIN(count, r->count - i) : 0;
+
+	queue_read_safe(q, dest, queue_wrap(q, r->start + i), transfer,
+			memcpy);
+
+	return transfer;
+}
+
+size_t queue_add_unit_mpsc(struct queue const *q, const void *src)
+{
+	struct queue_reservation r = queue_reserve_tail(q, 1);
+
+	if (!r.count)
+		return 0;
+
+	if (q->unit_bytes == 1)
+		*((uint8_t *) queue_reservation_unit(q, &r, 0)) =
+			*((uint8_t *) src);
+	else
+		memcpy(queue_reservation_unit(q, &r, 0), src, q->unit_bytes);
+
+	queue_commit_tail(q, &r);
+
+	return 1;
+}
+
+size_t queue_add_units_mpsc(struct queue const *q,
+			    const void *src,
+			    size_t count)
+{
+	struct queue_reservation r = queue_reserve_tail(q, count);
+
+	queue_reservation_write(q, &r, 0, src, r.count);
+	queue_commit_tail(q, &r);
+
+	return r.count;
+}
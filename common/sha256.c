@@ -35,14 +35,20 @@
  * SUCH DAMAGE.
  */
 
+#include "byteorder.h"
 #include "sha256.h"
+#ifdef HOST_TOOLS_BUILD
+#include <string.h>
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#else
 #include "util.h"
+#endif
 
 #define SHFR(x, n)    (x >> n)
 #define ROTR(x, n)   ((x >> n) | (x << ((sizeof(x) << 3) - n)))
 #define ROTL(x, n)   ((x << n) | (x >> ((sizeof(x) << 3) - n)))
-#define CH(x, y, z)  ((x & y) ^ (~x & z))
-#define MAJ(x, y, z) ((x & y) ^ (x & z) ^ (y & z))
+#define CH(x, y, z)  (z ^ (x & (y ^ z)))
+#define MAJ(x, y, z) ((x & y) | (z & (x | y)))
 
 #define SHA256_F1(x) (ROTR(x,  2) ^ ROTR(x, 13) ^ ROTR(x, 22))
 #define SHA256_F2(x) (ROTR(x,  6) ^ ROTR(x, 11) ^ ROTR(x, 25))
@@ -65,21 +71,41 @@
 			| ((uint32_t) *((str) + 0) << 24);	\
 	}
 
-/* Macros used for loops unrolling */
+/*
+ * Message word i.  Words 0-15 are the block itself.  Rather than expanding
+ * the rest up front, the schedule is kept as a ring of the last 16, each new
+ * word replacing the oldest one, which it is the last to need.
+ */
+#define SHA256_W_BLOCK(i) w[i]
+#define SHA256_W_EXPAND(i)						\
+	(w[(i) & 15] += SHA256_F4(w[((i) - 2) & 15]) + w[((i) - 7) & 15]	\
+		+ SHA256_F3(w[((i) - 15) & 15]))
+#define SHA256_W(i) ((i) < 16 ? SHA256_W_BLOCK(i) : SHA256_W_EXPAND(i))
 
-#define SHA256_SCR(i)						\
-	{							\
-		w[i] =  SHA256_F4(w[i -  2]) + w[i -  7]	\
-			+ SHA256_F3(w[i - 15]) + w[i - 16];	\
+/*
+ * One round, with message word W(i).  Instead of shifting the eight working
+ * variables along after each round, callers pass them in rotated order, so
+ * they stay in registers.
+ */
+#define SHA256_ROUND(a, b, c, d, e, f, g, h, i, W)			\
+	{								\
+		uint32_t t1 = h + SHA256_F2(e) + CH(e, f, g)		\
+			+ sha256_k[i] + W(i);				\
+		d += t1;						\
+		h = t1 + SHA256_F1(a) + MAJ(a, b, c);			\
 	}
 
-#define SHA256_EXP(a, b, c, d, e, f, g, h, j)				\
+/* Eight rounds, after which the variables are back in place */
+#define SHA256_ROUNDS_8(j, W)						\
 	{								\
-		t1 = wv[h] + SHA256_F2(wv[e]) + CH(wv[e], wv[f], wv[g])	\
-			+ sha256_k[j] + w[j];				\
-		t2 = SHA256_F1(wv[a]) + MAJ(wv[a], wv[b], wv[c]);	\
-		wv[d] += t1;						\
-		wv[h] = t1 + t2;					\
+		SHA256_ROUND(a, b, c, d, e, f, g, h, (j) + 0, W);	\
+		SHA256_ROUND(h, a, b, c, d, e, f, g, (j) + 1, W);	\
+		SHA256_ROUND(g, h, a, b, c, d, e, f, (j) + 2, W);	\
+		SHA256_ROUND(f, g, h, a, b, c, d, e, (j) + 3, W);	\
+		SHA256_ROUND(e, f, g, h, a, b, c, d, (j) + 4, W);	\
+		SHA256_ROUND(d, e, f, g, h, a, b, c, (j) + 5, W);	\
+		SHA256_ROUND(c, d, e, f, g, h, a, b, (j) + 6, W);	\
+		SHA256_ROUND(b, c, d, e, f, g, h, a, (j) + 7, W);	\
 	}
 
 static const uint32_t sha256_h0[8] = {
@@ -104,15 +130,8 @@ static const uint32_t sha256_k[64] = {
 	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
 	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
 
-#define SHA256_DIGESTINFO_LEN 19
-
-static const uint8_t SHA256_digestinfo[] = {
-	0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86,
-	0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01, 0x05,
-	0x00, 0x04, 0x20
-};
-
-void SHA256_init(struct sha256_ctx *ctx)
+/* Set up the software hash state */
+static void SHA256_reset(struct sha256_ctx *ctx)
 {
 	int i;
 
@@ -123,77 +142,127 @@ void SHA256_init(struct sha256_ctx *ctx)
 	ctx->tot_len = 0;
 }
 
-static void SHA256_transform(struct sha256_ctx *ctx, const uint8_t *message,
-			     unsigned int block_nb)
+void SHA256_init(struct sha256_ctx *ctx)
 {
-	/* Note: this function requires a considerable amount of stack */
-	uint32_t w[64];
-	uint32_t wv[8];
-	uint32_t t1, t2;
-	const unsigned char *sub_block;
-	int i, j;
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	ctx->hw = SHA256_hw_init();
+	if (ctx->hw)
+		return;
+#endif
 
-	for (i = 0; i < (int) block_nb; i++) {
-		sub_block = message + (i << 6);
+	SHA256_reset(ctx);
+}
 
-		for (j = 0; j < 16; j++)
-			PACK32(&sub_block[j << 2], &w[j]);
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+void SHA256_sw_init(struct sha256_ctx *ctx)
+{
+	ctx->hw = 0;
+	SHA256_reset(ctx);
+}
+#endif
 
-		for (j = 16; j < 64; j++)
-			SHA256_SCR(j);
+static void SHA256_transform(struct sha256_ctx *ctx, const uint8_t *message,
+			     unsigned int block_nb)
+{
+	uint32_t w[16];
+	uint32_t a, b, c, d, e, f, g, h;
+#ifndef CONFIG_SHA256_UNROLL
+	uint32_t t;
+#endif
+	const uint32_t *words;
+	int i, j;
 
-		for (j = 0; j < 8; j++)
-			wv[j] = ctx->h[j];
+	for (i = 0; i < (int) block_nb; i++, message += SHA256_BLOCK_SIZE) {
+		if ((uintptr_t)message & 3) {
+			for (j = 0; j < 16; j++)
+				PACK32(&message[j << 2], &w[j]);
+		} else {
+			words = (const uint32_t *)message;
+			for (j = 0; j < 16; j++)
+				w[j] = be32toh(words[j]);
+		}
 
+		a = ctx->h[0];
+		b = ctx->h[1];
+		c = ctx->h[2];
+		d = ctx->h[3];
+		e = ctx->h[4];
+		f = ctx->h[5];
+		g = ctx->h[6];
+		h = ctx->h[7];
+
+#ifdef CONFIG_SHA256_UNROLL
+		/* Rounds 0-15 are peeled, so the rest expand unconditionally */
+		SHA256_ROUNDS_8(0, SHA256_W_BLOCK);
+		SHA256_ROUNDS_8(8, SHA256_W_BLOCK);
+		for (j = 16; j < 64; j += 8)
+			SHA256_ROUNDS_8(j, SHA256_W_EXPAND);
+#else
 		for (j = 0; j < 64; j++) {
-			t1 = wv[7] + SHA256_F2(wv[4]) + CH(wv[4], wv[5], wv[6])
-				+ sha256_k[j] + w[j];
-			t2 = SHA256_F1(wv[0]) + MAJ(wv[0], wv[1], wv[2]);
-			wv[7] = wv[6];
-			wv[6] = wv[5];
-			wv[5] = wv[4];
-			wv[4] = wv[3] + t1;
-			wv[3] = wv[2];
-			wv[2] = wv[1];
-			wv[1] = wv[0];
-			wv[0] = t1 + t2;
+			SHA256_ROUND(a, b, c, d, e, f, g, h, j, SHA256_W);
+			t = h;
+			h = g;
+			g = f;
+			f = e;
+			e = d;
+			d = c;
+			c = b;
+			b = a;
+			a = t;
 		}
-
-		for (j = 0; j < 8; j++)
-			ctx->h[j] += wv[j];
+#endif
+
+		ctx->h[0] += a;
+		ctx->h[1] += b;
+		ctx->h[2] += c;
+		ctx->h[3] += d;
+		ctx->h[4] += e;
+		ctx->h[5] += f;
+		ctx->h[6] += g;
+		ctx->h[7] += h;
 	}
 }
 
 void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len)
 {
 	unsigned int block_nb;
-	unsigned int new_len, rem_len, tmp_len;
-	const uint8_t *shifted_data;
-
-	tmp_len = SHA256_BLOCK_SIZE - ctx->len;
-	rem_len = len < tmp_len ? len : tmp_len;
+	unsigned int rem_len;
 
-	memcpy(&ctx->block[ctx->len], data, rem_len);
-
-	if (ctx->len + len < SHA256_BLOCK_SIZE) {
-		ctx->len += len;
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	if (ctx->hw) {
+		SHA256_hw_update(data, len);
 		return;
 	}
+#endif
+
+	/* Top up a partly filled block first */
+	if (ctx->len) {
+		rem_len = MIN(len, SHA256_BLOCK_SIZE - ctx->len);
+		memcpy(&ctx->block[ctx->len], data, rem_len);
+		ctx->len += rem_len;
+		data += rem_len;
+		len -= rem_len;
+
+		if (ctx->len < SHA256_BLOCK_SIZE)
+			return;
+
+		SHA256_transform(ctx, ctx->block, 1);
+		ctx->tot_len += SHA256_BLOCK_SIZE;
+		ctx->len = 0;
+	}
 
-	new_len = len - rem_len;
-	block_nb = new_len / SHA256_BLOCK_SIZE;
-
-	shifted_data = data + rem_len;
-
-	SHA256_transform(ctx, ctx->block, 1);
-	SHA256_transform(ctx, shifted_data, block_nb);
-
-	rem_len = new_len % SHA256_BLOCK_SIZE;
-
-	memcpy(ctx->block, &shifted_data[block_nb << 6], rem_len);
+	/* Hash whole blocks straight from the caller's buffer */
+	block_nb = len / SHA256_BLOCK_SIZE;
+	if (block_nb) {
+		SHA256_transform(ctx, data, block_nb);
+		ctx->tot_len += block_nb * SHA256_BLOCK_SIZE;
+		data += block_nb * SHA256_BLOCK_SIZE;
+		len -= block_nb * SHA256_BLOCK_SIZE;
+	}
 
-	ctx->len = rem_len;
-	ctx->tot_len += (block_nb + 1) << 6;
+	/* Keep the rest for later */
+	memcpy(ctx->block, data, len);
+	ctx->len = len;
 }
 
 uint8_t *SHA256_final(struct sha256_ctx *ctx)
@@ -203,6 +272,13 @@ uint8_t *SHA256_final(struct sha256_ctx *ctx)
 	unsigned int len_b;
 	int i;
 
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	if (ctx->hw) {
+		SHA256_hw_final(ctx->buf);
+		return ctx->buf;
+	}
+#endif
+
 	block_nb = (1 + ((SHA256_BLOCK_SIZE - 9)
 			 < (ctx->len % SHA256_BLOCK_SIZE)));
 
@@ -220,3 +296,13 @@ uint8_t *SHA256_final(struct sha256_ctx *ctx)
 
 	return ctx->buf;
 }
+
+void SHA256_abort(struct sha256_ctx *ctx)
+{
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	if (ctx->hw) {
+		SHA256_hw_abort();
+		ctx->hw = 0;
+	}
+#endif
+}
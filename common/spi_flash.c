@@ -28,6 +28,15 @@
  */
 #define SPI_FLASH_TIMEOUT_USEC	(800*MSEC)
 
+/* Read instruction, and its size with address and any dummy byte */
+#ifdef CONFIG_SPI_FLASH_FAST_READ
+#define READ_CMD	SPI_FLASH_FAST_READ
+#define READ_CMD_SIZE	5
+#else
+#define READ_CMD	SPI_FLASH_READ
+#define READ_CMD_SIZE	4
+#endif
+
 /* Internal buffer used by SPI flash driver */
 static uint8_t buf[SPI_FLASH_MAX_MESSAGE_SIZE];
 
@@ -141,24 +150,42 @@ int spi_flash_set_status(int reg1, int reg2)
 
 /**
  * Returns the content of SPI flash
+ * Reads in transactions of up to CONFIG_SPI_FLASH_READ_CHUNK_SIZE bytes.
  *
  * @param buf Buffer to write flash contents
  * @param offset Flash offset to start reading from
- * @param bytes Number of bytes to read. Limited by receive buffer to 256.
+ * @param bytes Number of bytes to read
  *
  * @return EC_SUCCESS, or non-zero if any error.
  */
 int spi_flash_read(uint8_t *buf_usr, unsigned int offset, unsigned int bytes)
 {
-	uint8_t cmd[4] = {SPI_FLASH_READ,
-			  (offset >> 16) & 0xFF,
-			  (offset >> 8) & 0xFF,
-			  offset & 0xFF};
+	uint8_t cmd[READ_CMD_SIZE] = {READ_CMD};
+	int read_size;
+	int rv;
 
 	if (offset + bytes > CONFIG_FLASH_SIZE)
 		return EC_ERROR_INVAL;
 
-	return spi_transaction(SPI_FLASH_DEVICE, cmd, 4, buf_usr, bytes);
+	while (bytes > 0) {
+		read_size = MIN(bytes, CONFIG_SPI_FLASH_READ_CHUNK_SIZE);
+
+		/* Any dummy byte after the address stays 0 */
+		cmd[1] = (offset >> 16) & 0xFF;
+		cmd[2] = (offset >> 8) & 0xFF;
+		cmd[3] = offset & 0xFF;
+
+		rv = spi_transaction(SPI_FLASH_DEVICE, cmd, sizeof(cmd),
+				     buf_usr, read_size);
+		if (rv)
+			return rv;
+
+		buf_usr += read_size;
+		offset += read_size;
+		bytes -= read_size;
+	}
+
+	return EC_SUCCESS;
 }
 
 /**
@@ -248,7 +275,7 @@ int spi_flash_erase(unsigned int offset, unsigned int bytes)
 
 /**
  * Write to SPI flash. Assumes already erased.
- * Limited to SPI_FLASH_MAX_WRITE_SIZE by chip.
+ * Programs one flash page at a time, and waits for the last to finish.
  *
  * @param offset Flash offset to write
  * @param bytes Number of bytes to write
@@ -262,8 +289,7 @@ int spi_flash_write(unsigned int offset, unsigned int bytes,
 	int rv, write_size;
 
 	/* Invalid input */
-	if (!data || offset + bytes > CONFIG_FLASH_SIZE ||
-	    bytes > SPI_FLASH_MAX_WRITE_SIZE)
+	if (!data || offset + bytes > CONFIG_FLASH_SIZE)
 		return EC_ERROR_INVAL;
 
 	while (bytes > 0) {
@@ -271,6 +297,18 @@ int spi_flash_write(unsigned int offset, unsigned int bytes,
 		write_size = MIN(bytes, SPI_FLASH_MAX_WRITE_SIZE -
 		(offset & (SPI_FLASH_MAX_WRITE_SIZE - 1)));
 
+		/*
+		 * Copy data to send buffer; buffers may overlap.  This is done
+		 * before waiting, while the previous page is programming.
+		 */
+		memmove(buf + 4, data, write_size);
+
+		/* Compose instruction */
+		buf[0] = SPI_FLASH_PAGE_PRGRM;
+		buf[1] = (offset) >> 16;
+		buf[2] = (offset) >> 8;
+		buf[3] = offset;
+
 		/* Wait for previous operation to complete */
 		rv = spi_flash_wait();
 		if (rv)
@@ -281,15 +319,6 @@ int spi_flash_write(unsigned int offset, unsigned int bytes,
 		if (rv)
 			return rv;
 
-		/* Copy data to send buffer; buffers may overlap */
-		memmove(buf + 4, data, write_size);
-
-		/* Compose instruction */
-		buf[0] = SPI_FLASH_PAGE_PRGRM;
-		buf[1] = (offset) >> 16;
-		buf[2] = (offset) >> 8;
-		buf[3] = offset;
-
 		rv = spi_transaction(SPI_FLASH_DEVICE,
 				     buf, 4 + write_size, NULL, 0);
 		if (rv)
@@ -504,7 +533,12 @@ static int command_spi_flasherase(int argc, char **argv)
 		return EC_ERROR_ACCESS_DENIED;
 
 	ccprintf("Erasing %d bytes at 0x%x...\n", bytes, offset);
-	return spi_flash_erase(offset, bytes);
+
+	/* This bypasses flash_erase(), so invalidate the range as it does */
+	flash_invalidate(offset, bytes);
+	rv = spi_flash_erase(offset, bytes);
+	flash_invalidate(offset, bytes);
+	return rv;
 }
 DECLARE_CONSOLE_COMMAND(spi_flasherase, command_spi_flasherase,
 	"offset [bytes]",
@@ -515,6 +549,7 @@ static int command_spi_flashwrite(int argc, char **argv)
 {
 	int offset = -1;
 	int bytes = SPI_FLASH_MAX_WRITE_SIZE;
+	int start, size;
 	int write_len;
 	int rv = EC_SUCCESS;
 	int i;
@@ -534,6 +569,11 @@ static int command_spi_flashwrite(int argc, char **argv)
 		buf[i] = i;
 
 	ccprintf("Writing %d bytes to 0x%x...\n", bytes, offset);
+
+	/* This bypasses flash_write(), so invalidate the range as it does */
+	start = offset;
+	size = bytes;
+	flash_invalidate(start, size);
 	while (bytes > 0) {
 		watchdog_reload();
 
@@ -544,13 +584,14 @@ static int command_spi_flashwrite(int argc, char **argv)
 		/* Perform write */
 		rv = spi_flash_write(offset, write_len, buf);
 		if (rv)
-			return rv;
+			break;
 
 		offset += write_len;
 		bytes -= write_len;
 	}
+	flash_invalidate(start, size);
 
-	ASSERT(bytes == 0);
+	ASSERT(rv || bytes == 0);
 
 	return rv;
 }
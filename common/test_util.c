@@ -14,8 +14,13 @@
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
+#include "timer.h"
 #include "util.h"
 
+#ifdef CORE_CORTEX_M
+#include "cpu.h"
+#endif
+
 struct test_util_tag {
 	uint8_t error_count;
 };
@@ -155,10 +160,111 @@ uint32_t prng(uint32_t seed)
 	return 22695477 * seed + 1;
 }
 
+static uint32_t prng_state = 0x1234abcd;
+
 uint32_t prng_no_seed(void)
 {
-	static uint32_t seed = 0x1234abcd;
-	return seed = prng(seed);
+	return prng_state = prng(prng_state);
+}
+
+void prng_set_seed(uint32_t seed)
+{
+	prng_state = seed;
+}
+
+#ifdef CORE_CORTEX_M
+/* Start the DWT cycle counter; returns non-zero if the core has one */
+static int cycles_start(void)
+{
+	if (CPU_DWT_CTRL & CPU_DWT_CTRL_NOCYCCNT)
+		return 0;
+	CPU_DEMCR |= CPU_DEMCR_TRCENA;
+	CPU_DWT_CTRL |= CPU_DWT_CTRL_CYCCNTENA;
+	return 1;
+}
+
+static inline uint32_t cycles_read(void)
+{
+	return CPU_DWT_CYCCNT;
+}
+#else
+static int cycles_start(void)
+{
+	return 0;
+}
+
+static inline uint32_t cycles_read(void)
+{
+	return 0;
+}
+#endif
+
+/* Insertion sort; benchmarks have few enough samples */
+static void sort_samples(uint32_t *s, int count)
+{
+	uint32_t v;
+	int i, j;
+
+	for (i = 1; i < count; i++) {
+		v = s[i];
+		for (j = i; j > 0 && s[j - 1] > v; j--)
+			s[j] = s[j - 1];
+		s[j] = v;
+	}
+}
+
+int benchmark_run(const char *name, void (*routine)(void *data), void *data,
+		  int iterations, uint32_t *samples,
+		  struct benchmark_result *result)
+{
+	struct benchmark_result r;
+	int has_cycles = cycles_start();
+	uint32_t *bench_us = samples;
+	uint32_t *bench_cycles = samples + iterations;
+	uint32_t c;
+	timestamp_t t;
+	int i;
+
+	if (iterations < 1 || iterations > BENCHMARK_MAX_ITERATIONS)
+		return EC_ERROR_INVAL;
+
+	for (i = 0; i < BENCHMARK_WARMUP; i++)
+		routine(data);
+
+	for (i = 0; i < iterations; i++) {
+		t = get_time();
+		c = cycles_read();
+		routine(data);
+		bench_cycles[i] = cycles_read() - c;
+		bench_us[i] = get_time().val - t.val;
+	}
+
+	sort_samples(bench_us, iterations);
+	r.min_us = bench_us[0];
+	r.median_us = bench_us[iterations / 2];
+	r.max_us = bench_us[iterations - 1];
+
+	if (has_cycles) {
+		sort_samples(bench_cycles, iterations);
+		r.min_cycles = bench_cycles[0];
+		r.median_cycles = bench_cycles[iterations / 2];
+		r.max_cycles = bench_cycles[iterations - 1];
+	} else {
+		r.min_cycles = r.median_cycles = r.max_cycles = 0;
+	}
+
+	ccprintf("Benchmark: %s iterations=%d min_us=%u median_us=%u "
+		 "max_us=%u", name, iterations, r.min_us, r.median_us,
+		 r.max_us);
+	if (has_cycles)
+		ccprintf(" min_cycles=%u median_cycles=%u max_cycles=%u",
+			 r.min_cycles, r.median_cycles, r.max_cycles);
+	ccprintf("\n");
+	cflush();
+
+	if (result)
+		*result = r;
+	return EC_SUCCESS;
 }
 
 static void restore_state(void)
@@ -26,6 +26,13 @@ static uint32_t timer_running;
 static timestamp_t timer_deadline[TASK_ID_COUNT];
 static uint32_t next_deadline = 0xffffffff;
 
+/* How late each timer may fire, in us */
+static uint32_t timer_slack[TASK_ID_COUNT];
+
+/* Number of expirations of each timer, and of timer events expiring any */
+static uint32_t timer_wakeups[TASK_ID_COUNT];
+static uint32_t timer_events;
+
 /* Hardware timer routine IRQ number */
 static int timer_irq;
 
@@ -33,6 +40,7 @@ static void expire_timer(task_id_t tskid)
 {
 	/* we are done with this timer */
 	atomic_clear(&timer_running, 1 << tskid);
+	timer_wakeups[tskid]++;
 	/* wake up the taks waiting for this timer */
 	task_set_event(tskid, TASK_EVENT_TIMER, 0);
 }
@@ -52,8 +60,9 @@ int timestamp_expired(timestamp_t deadline, const timestamp_t *now)
 void process_timers(int overflow)
 {
 	uint32_t check_timer, running_t0;
-	timestamp_t next;
+	timestamp_t next, latest;
 	timestamp_t now;
+	int expired;
 
 	if (overflow)
 		clksrc_high++;
@@ -61,6 +70,7 @@ void process_timers(int overflow)
 	do {
 		next.val = -1ull;
 		now = get_time();
+		expired = 0;
 		do {
 			/* read atomically the current state of timer running */
 			check_timer = running_t0 = timer_running;
@@ -68,19 +78,38 @@ void process_timers(int overflow)
 
 				int tskid = __fls(check_timer);
 				/* timer has expired ? */
-				if (timer_deadline[tskid].val <= now.val)
+				if (timer_deadline[tskid].val <= now.val) {
 					expire_timer(tskid);
-				else if ((timer_deadline[tskid].le.hi ==
-					  now.le.hi) &&
-					 (timer_deadline[tskid].le.lo <
-					  next.le.lo))
-					next.val = timer_deadline[tskid].val;
+					expired = 1;
+					check_timer &= ~(1 << tskid);
+					continue;
+				}
+
+				/*
+				 * Wake up at the end of the earliest window.
+				 * Every timer which is due by then expires
+				 * with it, so timers whose windows overlap
+				 * share a single event.
+				 */
+				latest.val = timer_deadline[tskid].val +
+					timer_slack[tskid];
+				if (latest.le.hi != timer_deadline[tskid].le.hi)
+					latest.le.lo = 0xffffffff;
+				if ((timer_deadline[tskid].le.hi ==
+				     now.le.hi) &&
+				    (latest.le.lo < next.le.lo)) {
+					next.le.hi = now.le.hi;
+					next.le.lo = latest.le.lo;
+				}
 
 				check_timer &= ~(1 << tskid);
 			}
 		/* if there is a new timer, let's retry */
 		} while (timer_running & ~running_t0);
 
+		if (expired)
+			timer_events++;
+
 		if (next.le.hi == 0xffffffff) {
 			/* no deadline to set */
 			__hw_clock_event_clear();
@@ -113,24 +142,43 @@ void udelay(unsigned us)
 }
 #endif
 
-int timer_arm(timestamp_t tstamp, task_id_t tskid)
+int timer_arm_slack(timestamp_t tstamp, uint32_t slack_us, task_id_t tskid)
 {
+	timestamp_t latest;
+
 	ASSERT(tskid < TASK_ID_COUNT);
 
 	if (timer_running & (1<<tskid))
 		return EC_ERROR_BUSY;
 
 	timer_deadline[tskid] = tstamp;
+	timer_slack[tskid] = slack_us;
 	atomic_or(&timer_running, 1<<tskid);
 
 	/* Modify the next event if needed */
-	if ((tstamp.le.hi < clksrc_high) ||
-	    ((tstamp.le.hi == clksrc_high) && (tstamp.le.lo <= next_deadline)))
+	latest.val = tstamp.val + slack_us;
+	if ((latest.le.hi < clksrc_high) ||
+	    ((latest.le.hi == clksrc_high) && (latest.le.lo <= next_deadline)))
 		task_trigger_irq(timer_irq);
 
 	return EC_SUCCESS;
 }
 
+int timer_arm(timestamp_t tstamp, task_id_t tskid)
+{
+	return timer_arm_slack(tstamp, 0, tskid);
+}
+
+uint32_t timer_get_wakeups(task_id_t tskid)
+{
+	return timer_wakeups[tskid];
+}
+
+uint32_t timer_get_events(void)
+{
+	return timer_events;
+}
+
 void timer_cancel(task_id_t tskid)
 {
 	ASSERT(tskid < TASK_ID_COUNT);
@@ -212,9 +260,10 @@ void timer_print_info(void)
 
 	for (tskid = 0; tskid < TASK_ID_COUNT; tskid++) {
 		if (timer_running & (1<<tskid)) {
-			ccprintf("  Tsk %2d  0x%016lx -> %11.6ld\n", tskid,
-				 timer_deadline[tskid].val,
-				 timer_deadline[tskid].val - t);
+			ccprintf("  Tsk %2d  0x%016lx -> %11.6ld +%d us\n",
+				 tskid, timer_deadline[tskid].val,
+				 timer_deadline[tskid].val - t,
+				 timer_slack[tskid]);
 			cflush();
 		}
 	}
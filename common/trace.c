@@ -0,0 +1,126 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Event tracing.
+ *
+ * Trace points store a fixed-size record (timestamp, ID, type, task and a
+ * 32-bit argument) in a RAM ring buffer, overwriting the oldest records when
+ * it is full.  The host drains the buffer with EC_CMD_TRACE_READ and
+ * util/ec_trace.py converts the records to Chrome trace-event JSON, so task
+ * switches, hooks, host commands and so on can be seen on one timeline.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "host_command.h"
+#include "task.h"
+#include "timer.h"
+#include "trace.h"
+#include "util.h"
+
+#define BUF_EVENTS CONFIG_TRACE_BUF_EVENTS
+BUILD_ASSERT(POWER_OF_TWO(BUF_EVENTS));
+
+/*
+ * head and tail are free-running event counts, so head - tail is the number
+ * of events in the buffer.
+ */
+static struct ec_trace_event trace_buf[BUF_EVENTS];
+static uint32_t trace_head;
+static uint32_t trace_tail;
+
+/* Events overwritten before the host read them */
+static uint32_t trace_dropped;
+
+static int trace_enabled = 1;
+
+void __trace_add(uint16_t id, uint8_t type, uint32_t arg)
+{
+	struct ec_trace_event *e;
+
+	if (!trace_enabled)
+		return;
+
+	/* Make room by throwing away the oldest event */
+	if (trace_head - trace_tail == BUF_EVENTS) {
+		trace_tail++;
+		trace_dropped++;
+	}
+
+	e = trace_buf + (trace_head & (BUF_EVENTS - 1));
+	e->timestamp = get_time().le.lo;
+	e->id = id;
+	e->type = type;
+	if (in_interrupt_context())
+		e->type |= EC_TRACE_FLAG_ISR;
+	e->task = task_get_current();
+	e->arg = arg;
+	trace_head++;
+}
+
+void trace_add(uint16_t id, uint8_t type, uint32_t arg)
+{
+	interrupt_disable();
+	__trace_add(id, type, arg);
+	interrupt_enable();
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static int host_command_trace_read(struct host_cmd_handler_args *args)
+{
+	struct ec_response_trace_read *r = args->response;
+	struct ec_trace_event *dest = (struct ec_trace_event *)(r + 1);
+	int count = (args->response_max - sizeof(*r)) / sizeof(*dest);
+
+	interrupt_disable();
+
+	r->dropped = trace_dropped;
+	trace_dropped = 0;
+
+	/* Copy out as many events as fit */
+	while (trace_tail != trace_head && count--) {
+		*dest++ = trace_buf[trace_tail & (BUF_EVENTS - 1)];
+		trace_tail++;
+	}
+
+	interrupt_enable();
+
+	args->response_size = (uint8_t *)dest - (uint8_t *)args->response;
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TRACE_READ,
+		     host_command_trace_read,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_trace(int argc, char **argv)
+{
+	if (argc > 1) {
+		if (!strcasecmp(argv[1], "clear")) {
+			interrupt_disable();
+			trace_tail = trace_head;
+			trace_dropped = 0;
+			interrupt_enable();
+		} else if (!parse_bool(argv[1], &trace_enabled)) {
+			return EC_ERROR_PARAM1;
+		}
+	}
+
+	ccprintf("Tracing: %s\n", trace_enabled ? "on" : "off");
+	ccprintf("Used:    %d / %d events\n", trace_head - trace_tail,
+		 BUF_EVENTS);
+	ccprintf("Dropped: %d events\n", trace_dropped);
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(trace, command_trace,
+			"[on | off | clear]",
+			"Print or change event tracing state",
+			NULL);
@@ -49,6 +49,8 @@ static int tx_snapshot_head;
 static int tx_snapshot_tail;
 static int tx_last_snapshot_head;
 static int tx_next_snapshot_head;
+/* Total bytes ever written to tx_buf; tx_buf_head is this mod buffer size */
+static volatile uint32_t tx_buf_seq;
 static int uart_suspended;
 
 /**
@@ -95,10 +97,104 @@ static int __tx_char(void *context, int c)
 
 	tx_buf[tx_buf_head] = c;
 	tx_buf_head = tx_buf_next;
+	tx_buf_seq++;
 #endif
 	return 0;
 }
 
+/**
+ * Copy a run of characters into the transmit buffer.
+ *
+ * No newline translation is done.  This is the bulk equivalent of calling
+ * __tx_char() for each character, including moving the snapshot pointers
+ * out of the way of the new data.
+ *
+ * @param str		Characters to copy
+ * @param len		Number of characters
+ * @return 0 if all characters were copied, 1 if some were dropped.
+ */
+static int __tx_copy(const char *str, int len)
+{
+#if defined CONFIG_POLLING_UART
+	while (len--)
+		uart_write_char(*str++);
+	return 0;
+#else
+	int head = tx_buf_head;
+	int space, first, new_head, new_tail, d;
+	int dropped = 0;
+
+	/* One slot is always kept empty to tell full from empty */
+	space = CONFIG_UART_TX_BUF_SIZE - 1 - TX_BUF_DIFF(head, tx_buf_tail);
+	if (len > space) {
+		len = space;
+		dropped = 1;
+	}
+
+	if (len) {
+		/*
+		 * Like __tx_char(), fill the buffer before publishing the new
+		 * head.  At most two copies, split where the buffer wraps.
+		 */
+		first = MIN(len, CONFIG_UART_TX_BUF_SIZE - head);
+		memcpy((char *)tx_buf + head, str, first);
+		memcpy((char *)tx_buf, str + first, len - first);
+
+		/*
+		 * As in __tx_char(), a snapshot pointer overrun by the new
+		 * data is moved to just past the new head.
+		 */
+		new_head = (head + len) & (CONFIG_UART_TX_BUF_SIZE - 1);
+		new_tail = TX_BUF_NEXT(new_head);
+		d = TX_BUF_DIFF(tx_last_snapshot_head, head);
+		if (d && d <= len &&
+		    tx_last_snapshot_head != tx_snapshot_head)
+			tx_last_snapshot_head = new_tail;
+		d = TX_BUF_DIFF(tx_next_snapshot_head, head);
+		if (d && d <= len)
+			tx_next_snapshot_head = new_tail;
+
+		tx_buf_head = new_head;
+		tx_buf_seq += len;
+	}
+
+	return dropped;
+#endif
+}
+
+/**
+ * Put a run of characters into the transmit buffer.
+ *
+ * Does not enable the transmit interrupt; assumes that happens elsewhere.
+ *
+ * @param context	Context; ignored.
+ * @param str		Characters to write.
+ * @param len		Number of characters.
+ * @return 0 if all characters were transmitted, 1 if any were dropped.
+ */
+static int __tx_str(void *context, const char *str, int len)
+{
+	int run;
+
+	while (len > 0) {
+		/* Copy everything up to the next newline in one go */
+		for (run = 0; run < len && str[run] != '\n'; run++)
+			;
+		if (run && __tx_copy(str, run))
+			return 1;
+		if (run == len)
+			break;
+
+		/* Let __tx_char() do the CRLF translation */
+		if (__tx_char(NULL, '\n'))
+			return 1;
+		str += run + 1;
+		len -= run + 1;
+	}
+
+	return 0;
+}
+
 #ifdef CONFIG_UART_TX_DMA
 
 /**
@@ -265,22 +361,22 @@ int uart_putc(int c)
 
 int uart_puts(const char *outstr)
 {
-	/* Put all characters in the output buffer */
-	while (*outstr) {
-		if (__tx_char(NULL, *outstr++) != 0)
-			break;
-	}
+	return uart_put(outstr, strlen(outstr));
+}
+
+int uart_put(const char *out, int len)
+{
+	int rv = __tx_str(NULL, out, len);
 
 	if (!uart_suspended)
 		uart_tx_start();
 
-	/* Successful if we consumed all output */
-	return *outstr ? EC_ERROR_OVERFLOW : EC_SUCCESS;
+	return rv ? EC_ERROR_OVERFLOW : EC_SUCCESS;
 }
 
 int uart_vprintf(const char *format, va_list args)
 {
-	int rv = vfnprintf(__tx_char, NULL, format, args);
+	int rv = vfnprintf_bulk(__tx_char, __tx_str, NULL, format, args);
 
 	if (!uart_suspended)
 		uart_tx_start();
@@ -456,3 +552,63 @@ static int host_command_console_read(struct host_cmd_handler_args *args)
 DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ,
 		     host_command_console_read,
 		     EC_VER_MASK(0) | EC_VER_MASK(1));
+
+static int host_command_console_read_seq(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_console_read_seq *p = args->params;
+	struct ec_response_console_read_seq *r = args->response;
+	char *dest = (char *)(r + 1);
+	uint32_t seq = tx_buf_seq;
+	uint32_t oldest, start, end, overwritten;
+	int len, first, pos;
+
+	/*
+	 * Everything still in the buffer, up to one byte short of a full
+	 * buffer since the slot at the head is never written.
+	 */
+	oldest = seq - MIN(seq, CONFIG_UART_TX_BUF_SIZE - 1);
+
+	start = p->seq;
+	r->lost = 0;
+	if ((int32_t)(start - oldest) < 0) {
+		r->lost = oldest - start;
+		start = oldest;
+	} else if ((int32_t)(seq - start) < 0) {
+		/* Ahead of us; the host must have a stale sequence number */
+		start = oldest;
+	}
+
+	len = MIN(seq - start, args->response_max - sizeof(*r));
+	pos = start & (CONFIG_UART_TX_BUF_SIZE - 1);
+	first = MIN(len, CONFIG_UART_TX_BUF_SIZE - pos);
+	memcpy(dest, (const char *)tx_buf + pos, first);
+	memcpy(dest + first, (const char *)tx_buf, len - first);
+	end = start + len;
+
+	/*
+	 * Output written while we were copying may have overwritten the
+	 * oldest bytes we copied.  Drop those and count them as lost rather
+	 * than return garbage.  This does not catch a lower-priority writer
+	 * we preempted part way through a copy, so the first few bytes can
+	 * still be stale in that case; like the snapshot commands, this is
+	 * meant for logging, not for anything that needs exact data.
+	 */
+	seq = tx_buf_seq;
+	oldest = seq - MIN(seq, CONFIG_UART_TX_BUF_SIZE - 1);
+	if ((int32_t)(oldest - start) > 0) {
+		overwritten = MIN(oldest - start, len);
+		memmove(dest, dest + overwritten, len - overwritten);
+		start += overwritten;
+		r->lost += overwritten;
+		len -= overwritten;
+	}
+
+	r->seq = start;
+	r->next_seq = end;
+	args->response_size = sizeof(*r) + len;
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ_SEQ,
+		     host_command_console_read_seq,
+		     EC_VER_MASK(0));
@@ -920,8 +920,12 @@ int pd_custom_flash_vdm(int port, int cnt, uint32_t *payload)
 		pd_log_event(PD_EVENT_ACC_RW_ERASE, 0, 0, NULL);
 		flash_offset = CONFIG_EC_WRITABLE_STORAGE_OFF +
 			       CONFIG_RW_STORAGE_OFF;
+		flash_invalidate(CONFIG_EC_WRITABLE_STORAGE_OFF +
+				 CONFIG_RW_STORAGE_OFF, CONFIG_RW_SIZE);
 		flash_physical_erase(CONFIG_EC_WRITABLE_STORAGE_OFF +
 				     CONFIG_RW_STORAGE_OFF, CONFIG_RW_SIZE);
+		flash_invalidate(CONFIG_EC_WRITABLE_STORAGE_OFF +
+				 CONFIG_RW_STORAGE_OFF, CONFIG_RW_SIZE);
 		rw_flash_changed = 1;
 		break;
 	case VDO_CMD_FLASH_WRITE:
@@ -930,8 +934,10 @@ int pd_custom_flash_vdm(int port, int cnt, uint32_t *payload)
 		    (flash_offset < CONFIG_EC_WRITABLE_STORAGE_OFF +
 				    CONFIG_RW_STORAGE_OFF))
 			break;
+		flash_invalidate(flash_offset, 4*(cnt - 1));
 		flash_physical_write(flash_offset, 4*(cnt - 1),
 				     (const char *)(payload+1));
+		flash_invalidate(flash_offset, 4*(cnt - 1));
 		flash_offset += 4*(cnt - 1);
 		rw_flash_changed = 1;
 		break;
@@ -941,10 +947,14 @@ int pd_custom_flash_vdm(int port, int cnt, uint32_t *payload)
 			uint32_t zero = 0;
 			int offset;
 			/* zeroes the area containing the RSA signature */
+			flash_invalidate(FW_RW_END - RSANUMBYTES,
+					 RSANUMBYTES);
 			for (offset = FW_RW_END - RSANUMBYTES;
 			     offset < FW_RW_END; offset += 4)
 				flash_physical_write(offset, 4,
 						     (const char *)&zero);
+			flash_invalidate(FW_RW_END - RSANUMBYTES,
+					 RSANUMBYTES);
 		}
 		break;
 	default:
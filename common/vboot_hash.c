@@ -31,16 +31,43 @@ struct vboot_hash_tag {
 #define VBOOT_HASH_SYSJUMP_TAG 0x5648 /* "VH" */
 #define VBOOT_HASH_SYSJUMP_VERSION 1
 
-#define CHUNK_SIZE 1024       /* Bytes to hash per deferred call */
+/*
+ * Bytes to hash per deferred call.  The chunk size starts at CHUNK_SIZE and
+ * is doubled or halved after each call, so that a call takes about
+ * WORK_BUDGET_US whatever the speed of the core and flash.
+ */
+#define CHUNK_SIZE 1024
+#define CHUNK_SIZE_MIN 256
+#define CHUNK_SIZE_MAX 16384
+#define WORK_BUDGET_US 1000   /* Target time per deferred call */
 #define WORK_INTERVAL_US 100  /* Delay between deferred calls */
 
+#define CACHE_ENTRIES 2       /* Completed hashes to remember */
+
+/* A completed hash, valid until flash is next written or erased */
+struct vboot_hash_cache {
+	uint8_t hash[SHA256_DIGEST_SIZE];
+	uint32_t offset;
+	uint32_t size;
+	uint32_t generation;  /* Flash generation when the hash started */
+	int valid;
+};
+
 static uint32_t data_offset;
 static uint32_t data_size;
 static uint32_t curr_pos;
+static uint32_t chunk_size = CHUNK_SIZE;
 static const uint8_t *hash;   /* Hash, or NULL if not valid */
 static int want_abort;
 static int in_progress;
 
+/* Flash generation when the current hash started, if it can be cached */
+static uint32_t start_generation;
+static int cacheable;
+
+static struct vboot_hash_cache cache[CACHE_ENTRIES];
+static int cache_next;        /* Entry to replace next */
+
 static struct sha256_ctx ctx;
 
 int vboot_hash_in_progress(void)
@@ -63,9 +90,58 @@ void vboot_hash_abort(void)
 	}
 }
 
-#ifndef CONFIG_MAPPED_STORAGE
+/**
+ * Look up a cached hash of a flash region.
+ *
+ * @return the hash, or NULL if there is none or flash has changed since.
+ */
+static const uint8_t *cache_find(uint32_t offset, uint32_t size)
+{
+	int i;
+
+	for (i = 0; i < CACHE_ENTRIES; i++) {
+		if (cache[i].valid && cache[i].offset == offset &&
+		    cache[i].size == size &&
+		    cache[i].generation == flash_get_generation())
+			return cache[i].hash;
+	}
+
+	return NULL;
+}
+
+/**
+ * Remember a hash of a flash region, replacing any older hash of it.
+ *
+ * @return the cached copy of the hash.
+ */
+static const uint8_t *cache_add(uint32_t offset, uint32_t size,
+				uint32_t generation, const uint8_t *digest)
+{
+	struct vboot_hash_cache *c = NULL;
+	int i;
+
+	for (i = 0; i < CACHE_ENTRIES; i++) {
+		if (cache[i].offset == offset && cache[i].size == size)
+			c = cache + i;
+	}
+
+	if (!c) {
+		c = cache + cache_next;
+		cache_next = (cache_next + 1) % CACHE_ENTRIES;
+	}
+
+	memcpy(c->hash, digest, sizeof(c->hash));
+	c->offset = offset;
+	c->size = size;
+	c->generation = generation;
+	c->valid = 1;
+	return c->hash;
+}
 
 static void vboot_hash_next_chunk(void);
+DECLARE_DEFERRED(vboot_hash_next_chunk);
+
+#ifndef CONFIG_MAPPED_STORAGE
 
 static int read_and_hash_chunk(int offset, int size)
 {
@@ -78,18 +154,23 @@ static int read_and_hash_chunk(int offset, int size)
 	rv = shared_mem_acquire(size, &buf);
 	if (rv == EC_ERROR_BUSY) {
 		/* Couldn't update hash right now; try again later */
-		hook_call_deferred(vboot_hash_next_chunk, WORK_INTERVAL_US);
+		hook_call_deferred_data(&vboot_hash_next_chunk_data,
+					WORK_INTERVAL_US);
 		return rv;
 	} else if (rv != EC_SUCCESS) {
+		/* Come back to finish the abort */
 		vboot_hash_abort();
+		hook_call_deferred_data(&vboot_hash_next_chunk_data, 0);
 		return rv;
 	}
 
 	rv = flash_read(offset, size, buf);
-	if (rv == EC_SUCCESS)
+	if (rv == EC_SUCCESS) {
 		SHA256_update(&ctx, (const uint8_t *)buf, size);
-	else
+	} else {
 		vboot_hash_abort();
+		hook_call_deferred_data(&vboot_hash_next_chunk_data, 0);
+	}
 
 	shared_mem_release(buf);
 	return rv;
@@ -102,32 +183,53 @@ static int read_and_hash_chunk(int offset, int size)
  */
 static void vboot_hash_next_chunk(void)
 {
+	uint32_t start, elapsed;
 	int size;
 
 	/* Handle abort */
 	if (want_abort) {
 		in_progress = 0;
+		SHA256_abort(&ctx);
 		vboot_hash_abort();
 		return;
 	}
 
 	/* Compute the next chunk of hash */
-	size = MIN(CHUNK_SIZE, data_size - curr_pos);
+	size = MIN(chunk_size, data_size - curr_pos);
+	start = get_time().le.lo;
 
 #ifdef CONFIG_MAPPED_STORAGE
 	SHA256_update(&ctx, (const uint8_t *)(CONFIG_MAPPED_STORAGE_BASE +
 					      data_offset + curr_pos), size);
 #else
+	size = MIN(size, shared_mem_size());
 	if (read_and_hash_chunk(data_offset + curr_pos, size) != EC_SUCCESS)
 		return;
 #endif
 
+	/*
+	 * Resize the next chunk to fit the budget.  Preemption counts against
+	 * the budget too, which just makes hashing back off when busy.
+	 */
+	elapsed = get_time().le.lo - start;
+	if (size == chunk_size) {
+		if (elapsed < WORK_BUDGET_US / 2 && chunk_size < CHUNK_SIZE_MAX)
+			chunk_size *= 2;
+		else if (elapsed > WORK_BUDGET_US &&
+			 chunk_size > CHUNK_SIZE_MIN)
+			chunk_size /= 2;
+	}
+
 	curr_pos += size;
 	if (curr_pos >= data_size) {
 		/* Store the final hash */
 		hash = SHA256_final(&ctx);
 		CPRINTS("hash done %.*h", SHA256_DIGEST_SIZE, hash);
 
+		if (cacheable && !want_abort)
+			hash = cache_add(data_offset, data_size,
+					 start_generation, hash);
+
 		in_progress = 0;
 
 		/* Handle receiving abort during finalize */
@@ -138,9 +240,9 @@ static void vboot_hash_next_chunk(void)
 	}
 
 	/* If we're still here, more work to do; come back later */
-	hook_call_deferred(vboot_hash_next_chunk, WORK_INTERVAL_US);
+	hook_call_deferred_data(&vboot_hash_next_chunk_data,
+				WORK_INTERVAL_US);
 }
-DECLARE_DEFERRED(vboot_hash_next_chunk);
 
 /**
  * Start computing a hash of <size> bytes of data at flash offset <offset>.
@@ -164,6 +266,24 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 		return EC_ERROR_INVAL;
 	}
 
+	/*
+	 * If flash hasn't changed since we last hashed this region, the old
+	 * hash is still good.  A nonce makes every hash different, so those
+	 * always need computing.
+	 */
+	if (!nonce_size) {
+		const uint8_t *cached = cache_find(offset, size);
+
+		if (cached) {
+			CPRINTS("hash cached 0x%08x 0x%08x", offset, size);
+			data_offset = offset;
+			data_size = size;
+			hash = cached;
+			want_abort = 0;
+			return EC_SUCCESS;
+		}
+	}
+
 	/* Save new hash request */
 	data_offset = offset;
 	data_size = size;
@@ -171,6 +291,8 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	hash = NULL;
 	want_abort = 0;
 	in_progress = 1;
+	start_generation = flash_get_generation();
+	cacheable = !nonce_size;
 
 	/* Restart the hash computation */
 	CPRINTS("hash start 0x%08x 0x%08x", offset, size);
@@ -178,7 +300,7 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	if (nonce_size)
 		SHA256_update(&ctx, nonce, nonce_size);
 
-	hook_call_deferred(vboot_hash_next_chunk, 0);
+	hook_call_deferred_data(&vboot_hash_next_chunk_data, 0);
 
 	return EC_SUCCESS;
 }
@@ -222,7 +344,8 @@ static void vboot_hash_init(void)
 	    size == sizeof(*tag)) {
 		/* Already computed a hash, so don't recompute */
 		CPRINTS("hash precomputed");
-		hash = tag->hash;
+		hash = cache_add(tag->offset, tag->size,
+				 flash_get_generation(), tag->hash);
 		data_offset = tag->offset;
 		data_size = tag->size;
 	} else
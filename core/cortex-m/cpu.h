@@ -37,6 +37,16 @@
 #define CPU_NVIC_MFAR          CPUREG(0xe000ed34)
 #define CPU_NVIC_BFAR          CPUREG(0xe000ed38)
 
+/* Debug exception and monitor control */
+#define CPU_DEMCR              CPUREG(0xe000edfc)
+#define CPU_DEMCR_TRCENA       (1 << 24)
+
+/* Data watchpoint and trace unit; only the cycle counter is used */
+#define CPU_DWT_CTRL           CPUREG(0xe0001000)
+#define CPU_DWT_CTRL_CYCCNTENA (1 << 0)
+#define CPU_DWT_CTRL_NOCYCCNT  (1 << 25)
+#define CPU_DWT_CYCCNT         CPUREG(0xe0001004)
+
 enum {
 	CPU_NVIC_MMFS_BFARVALID		= 1 << 15,
 	CPU_NVIC_MMFS_MFARVALID		= 1 << 7,
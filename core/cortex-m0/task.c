@@ -13,6 +13,7 @@
 #include "panic.h"
 #include "task.h"
 #include "timer.h"
+#include "trace.h"
 #include "util.h"
 
 typedef union {
@@ -25,6 +26,11 @@ typedef union {
 		uint32_t events;   /* Bitmaps of received events */
 		uint64_t runtime;  /* Time spent in task */
 		uint32_t *stack;   /* Start of stack */
+#ifdef CONFIG_TASK_PROFILING
+		uint64_t run_start; /* runtime when last switched to */
+		uint32_t switches;  /* Number of times switched to */
+		uint32_t max_run;   /* Longest run without yielding, in us */
+#endif
 	};
 } task_;
 
@@ -138,6 +144,33 @@ static inline task_ *__task_id_to_ptr(task_id_t id)
 	return tasks + id;
 }
 
+#ifdef CONFIG_TASK_PROFILING
+/*
+ * Account for a switch between tasks.  Must be called after the outgoing
+ * task has been billed for its runtime.
+ */
+static void account_switch(task_ *from, task_ *to)
+{
+	uint64_t run = from->runtime - from->run_start;
+
+	if (run > from->max_run)
+		from->max_run = run;
+	to->switches++;
+	to->run_start = to->runtime;
+}
+
+int task_get_stats(task_id_t tskid, struct task_stats *stats)
+{
+	if (tskid >= TASK_ID_COUNT)
+		return EC_ERROR_INVAL;
+
+	stats->runtime = tasks[tskid].runtime;
+	stats->switches = tasks[tskid].switches;
+	stats->max_run = tasks[tskid].max_run;
+	return EC_SUCCESS;
+}
+#endif
+
 void interrupt_disable(void)
 {
 	asm("cpsid i");
@@ -242,9 +275,13 @@ task_  __attribute__((noinline)) *__svc_handler(int desched, task_id_t resched)
 #endif
 
 	/* Switch to new task */
-#ifdef CONFIG_TASK_PROFILING
 	if (next != current)
+		TRACE_TASK_SWITCH(next - tasks);
+#ifdef CONFIG_TASK_PROFILING
+	if (next != current) {
 		task_switches++;
+		account_switch(current, next);
+	}
 #endif
 	current_task = next;
 	return current;
@@ -330,7 +367,7 @@ void task_end_irq_handler(void *excep_return)
 }
 #endif
 
-static uint32_t __wait_evt(int timeout_us, task_id_t resched)
+static uint32_t __wait_evt(int timeout_us, int slack_us, task_id_t resched)
 {
 	task_ *tsk = current_task;
 	task_id_t me = tsk - tasks;
@@ -342,7 +379,7 @@ static uint32_t __wait_evt(int timeout_us, task_id_t resched)
 	if (timeout_us > 0) {
 		timestamp_t deadline = get_time();
 		deadline.val += timeout_us;
-		ret = timer_arm(deadline, me);
+		ret = timer_arm_slack(deadline, slack_us, me);
 		ASSERT(ret == EC_SUCCESS);
 	}
 	while (!(evt = atomic_read_clear(&tsk->events))) {
@@ -383,7 +420,7 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 		}
 	} else {
 		if (wait) {
-			return __wait_evt(-1, tskid);
+			return __wait_evt(-1, 0, tskid);
 		} else {
 			/*
 			 * We need to ensure that the execution priority is
@@ -402,7 +439,12 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 
 uint32_t task_wait_event(int timeout_us)
 {
-	return __wait_evt(timeout_us, TASK_ID_IDLE);
+	return __wait_evt(timeout_us, 0, TASK_ID_IDLE);
+}
+
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
+{
+	return __wait_evt(timeout_us, slack_us, TASK_ID_IDLE);
 }
 
 uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
@@ -416,7 +458,7 @@ uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
 
 	while (!(events & event_mask)) {
 		/* Collect events to re-post later */
-		events |= __wait_evt(time_remaining_us, TASK_ID_IDLE);
+		events |= __wait_evt(time_remaining_us, 0, TASK_ID_IDLE);
 
 		time_remaining_us = deadline - get_time().val;
 		if (timeout_us > 0 && time_remaining_us <= 0) {
@@ -540,11 +582,17 @@ void mutex_unlock(struct mutex *mtx)
 	atomic_clear(&tsk->events, TASK_EVENT_MUTEX);
 }
 
+const char *task_get_name(task_id_t tskid)
+{
+	return task_names[tskid];
+}
+
 void task_print_list(void)
 {
 	int i;
 
-	ccputs("Task Ready Name         Events      Time (s)  StkUsed\n");
+	ccputs("Task Ready Name         Events      Time (s)  StkUsed"
+	       "    Wakes\n");
 
 	for (i = 0; i < TASK_ID_COUNT; i++) {
 		char is_ready = (tasks_ready & (1<<i)) ? 'R' : ' ';
@@ -557,11 +605,13 @@ void task_print_list(void)
 		     sp++)
 			stackused -= sizeof(uint32_t);
 
-		ccprintf("%4d %c %-16s %08x %11.6ld  %3d/%3d\n", i, is_ready,
-			 task_names[i], tasks[i].events, tasks[i].runtime,
-			 stackused, tasks_init[i].stack_size);
+		ccprintf("%4d %c %-16s %08x %11.6ld  %3d/%3d %8d\n", i,
+			 is_ready, task_names[i], tasks[i].events,
+			 tasks[i].runtime, stackused, tasks_init[i].stack_size,
+			 timer_get_wakeups(i));
 		cflush();
 	}
+	ccprintf("Timer events: %d\n", timer_get_events());
 }
 
 int command_task_info(int argc, char **argv)
@@ -589,6 +639,14 @@ int command_task_info(int argc, char **argv)
 	ccprintf("Time in tasks:          %11.6ld s\n",
 		 get_time().val - task_start_time);
 	ccprintf("Time in exceptions:     %11.6ld s\n", exc_total_time);
+	cflush();
+
+	ccputs("Task Name              Switches  Max run (s)\n");
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		ccprintf("%4d %-16s %10d %12.6ld\n", i, task_names[i],
+			 tasks[i].switches, (uint64_t)tasks[i].max_run);
+		cflush();
+	}
 #endif
 
 	return EC_SUCCESS;
@@ -11,6 +11,7 @@
 #include <pthread.h>
 
 #include "task.h"
+#include "timer.h"
 
 /**
  * Returns the thread corresponding to the task.
@@ -29,6 +30,14 @@ task_id_t task_get_running(void);
  */
 void task_register_interrupt(void);
 
+#ifdef EMU_VIRTUAL_TIME
+/**
+ * Lets the interrupt generator run if virtual time has reached its deadline,
+ * and runs any interrupts it triggers before returning.
+ */
+void task_run_interrupt_generator(timestamp_t now);
+#endif
+
 /**
  * Returns the process ID of the calling process.
  */
@@ -5,6 +5,8 @@
 
 /* Entry point of unit test executable */
 
+#include <stdlib.h>
+
 #include "console.h"
 #include "flash.h"
 #include "hooks.h"
@@ -30,8 +32,14 @@ const char *__get_prog_name(void)
 
 int main(int argc, char **argv)
 {
+	const char *seed = getenv("EMU_SEED");
+
 	__prog_name = argv[0];
 
+	/* Random numbers used by tests can be varied between runs */
+	if (seed)
+		prng_set_seed(strtoul(seed, NULL, 0));
+
 	/*
 	 * In order to properly service IRQs before task switching is enabled,
 	 * we must set up our signal handler for the main thread.
@@ -80,7 +80,9 @@ static void __attribute__((noinline)) _task_dump_trace_dispatch(int sig)
 				running, task_get_name(running));
 	}
 
-	if (need_dispatch) {
+	/* Coroutine tasks run on the main thread, so no need to dispatch */
+	if (need_dispatch &&
+	    !pthread_equal(task_get_thread(running), pthread_self())) {
 		pthread_kill(task_get_thread(running), SIGNAL_TRACE_DUMP);
 	} else {
 		_task_dump_trace_impl(SIGNAL_TRACE_OFFSET);
@@ -3,7 +3,19 @@
  * found in the LICENSE file.
  */
 
-/* Task scheduling / events module for Chrome EC operating system */
+/*
+ * Task scheduling / events module for Chrome EC operating system
+ *
+ * By default each task runs in its own thread, and a context switch hands
+ * control over through a condition variable.  Building with EMU_COROUTINES=y
+ * instead runs every task as a coroutine on the main thread, switching with
+ * swapcontext(), which avoids waking a kernel thread on every switch.
+ *
+ * Building with EMU_VIRTUAL_TIME=y makes time virtual (see timer.c).  The
+ * interrupt generator thread then only runs when virtual time reaches its
+ * deadline, and the interrupts it triggers run while the rest of the
+ * emulator waits, so that runs are reproducible.
+ */
 
 #include <malloc.h>
 #include <pthread.h>
@@ -13,6 +25,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef EMU_COROUTINES
+#include <ucontext.h>
+#endif
 
 #include "atomic.h"
 #include "common.h"
@@ -22,15 +37,35 @@
 #include "task_id.h"
 #include "test_util.h"
 #include "timer.h"
+#include "trace.h"
 
 #define SIGNAL_INTERRUPT SIGUSR1
 
+/*
+ * Stack size for coroutine tasks.  Tasks run host libc code, so this is much
+ * bigger than the stack sizes in the task lists.
+ */
+#define EMU_TASK_STACK_SIZE (256 * 1024)
+
 struct emu_task_t {
+#ifdef EMU_COROUTINES
+	ucontext_t context;
+	void *stack;
+	uint8_t created;
+#else
 	pthread_t thread;
 	pthread_cond_t resume;
+#endif
 	uint32_t event;
 	timestamp_t wake_time;
+	uint32_t wake_slack;
+	uint32_t wakeups;
 	uint8_t started;
+#ifdef CONFIG_TASK_PROFILING
+	uint64_t runtime;
+	uint32_t switches;
+	uint32_t max_run;
+#endif
 };
 
 struct task_args {
@@ -39,8 +74,13 @@ struct task_args {
 };
 
 static struct emu_task_t tasks[TASK_ID_COUNT];
+#ifdef EMU_COROUTINES
+static ucontext_t scheduler_context;
+static pthread_t main_thread;
+#else
 static pthread_cond_t scheduler_cond;
 static pthread_mutex_t run_lock;
+#endif
 static task_id_t running_task_id;
 static int task_started;
 
@@ -53,10 +93,20 @@ static void (*pending_isr)(void);
 static int generator_sleeping;
 static timestamp_t generator_sleep_deadline;
 static int has_interrupt_generator = 1;
+#ifdef EMU_VIRTUAL_TIME
+static sem_t generator_wake;
+static sem_t generator_done;
+#endif
+
+/* Time of the last timer wakeup, and number of them */
+static timestamp_t last_timer_wake;
+static uint32_t timer_events;
 
 static __thread task_id_t my_task_id; /* thread local task id */
 
+#ifndef EMU_COROUTINES
 static void task_enable_all_tasks_callback(void);
+#endif
 
 #define TASK(n, r, d, s) void r(void *);
 CONFIG_TASK_LIST
@@ -103,8 +153,16 @@ int in_interrupt_context(void)
 	return !!in_interrupt;
 }
 
+/*
+ * Emulated interrupts don't nest, so interrupts are already off in an ISR.
+ * The interrupt generator also holds interrupt_lock while the ISR runs, so
+ * taking it here would deadlock.
+ */
 void interrupt_disable(void)
 {
+	if (in_interrupt)
+		return;
+
 	pthread_mutex_lock(&interrupt_lock);
 	interrupt_disabled = 1;
 	pthread_mutex_unlock(&interrupt_lock);
@@ -112,6 +170,9 @@ void interrupt_disable(void)
 
 void interrupt_enable(void)
 {
+	if (in_interrupt)
+		return;
+
 	pthread_mutex_lock(&interrupt_lock);
 	interrupt_disabled = 0;
 	pthread_mutex_unlock(&interrupt_lock);
@@ -134,6 +195,19 @@ void task_register_interrupt(void)
 void task_trigger_test_interrupt(void (*isr)(void))
 {
 	pid_t main_pid;
+
+#ifdef EMU_VIRTUAL_TIME
+	/* Hand the ISR to task_run_interrupt_generator() */
+	if (task_get_current() == TASK_ID_INT_GEN) {
+		if (interrupt_disabled)
+			return;
+		pending_isr = isr;
+		sem_post(&generator_done);
+		sem_wait(&generator_wake);
+		return;
+	}
+#endif
+
 	pthread_mutex_lock(&interrupt_lock);
 	if (interrupt_disabled) {
 		pthread_mutex_unlock(&interrupt_lock);
@@ -143,7 +217,7 @@ void task_trigger_test_interrupt(void (*isr)(void))
 	/* Suspend current task and excute ISR */
 	pending_isr = isr;
 	if (task_started) {
-		pthread_kill(tasks[running_task_id].thread, SIGNAL_INTERRUPT);
+		pthread_kill(task_get_thread(running_task_id), SIGNAL_INTERRUPT);
 	} else {
 		main_pid = getpid();
 		kill(main_pid, SIGNAL_INTERRUPT);
@@ -162,21 +236,102 @@ void interrupt_generator_udelay(unsigned us)
 {
 	generator_sleep_deadline.val = get_time().val + us;
 	generator_sleeping = 1;
+#ifdef EMU_VIRTUAL_TIME
+	sem_post(&generator_done);
+	sem_wait(&generator_wake);
+#else
 	while (get_time().val < generator_sleep_deadline.val)
 		;
 	generator_sleeping = 0;
+#endif
+}
+
+#ifdef EMU_VIRTUAL_TIME
+/* Service the interrupt generator until it sleeps again or exits */
+static void wait_for_generator(void)
+{
+	while (1) {
+		sem_wait(&generator_done);
+		if (!pending_isr)
+			return;
+
+		in_interrupt = 1;
+		pending_isr();
+		in_interrupt = 0;
+		pending_isr = NULL;
+		sem_post(&generator_wake);
+	}
+}
+
+void task_run_interrupt_generator(timestamp_t now)
+{
+	static int running;
+
+	if (running || !has_interrupt_generator || !generator_sleeping ||
+	    now.val < generator_sleep_deadline.val)
+		return;
+
+	running = 1;
+	generator_sleeping = 0;
+	sem_post(&generator_wake);
+	wait_for_generator();
+	running = 0;
 }
+#endif
 
 const char *task_get_name(task_id_t tskid)
 {
 	return task_names[tskid];
 }
 
+#ifdef EMU_COROUTINES
+pthread_t task_get_thread(task_id_t tskid)
+{
+	/* All tasks run on the thread which started the scheduler */
+	return main_thread;
+}
+
+static int task_created(task_id_t tskid)
+{
+	return tasks[tskid].created;
+}
+
+/* Save the current task's context and switch back to the scheduler */
+static void task_switch_to_scheduler(task_id_t tskid)
+{
+	swapcontext(&tasks[tskid].context, &scheduler_context);
+}
+
+/* Switch from the scheduler to a task, until it switches back */
+static void task_resume(task_id_t tskid)
+{
+	my_task_id = tskid;
+	swapcontext(&scheduler_context, &tasks[tskid].context);
+}
+#else
 pthread_t task_get_thread(task_id_t tskid)
 {
 	return tasks[tskid].thread;
 }
 
+static int task_created(task_id_t tskid)
+{
+	return tasks[tskid].thread != (pthread_t)NULL;
+}
+
+static void task_switch_to_scheduler(task_id_t tskid)
+{
+	pthread_cond_signal(&scheduler_cond);
+	pthread_cond_wait(&tasks[tskid].resume, &run_lock);
+}
+
+static void task_resume(task_id_t tskid)
+{
+	pthread_cond_signal(&tasks[tskid].resume);
+	pthread_cond_wait(&scheduler_cond, &run_lock);
+}
+#endif
+
 uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 {
 	tasks[tskid].event = event;
@@ -186,16 +341,22 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 }
 
 uint32_t task_wait_event(int timeout_us)
+{
+	return task_wait_event_slack(timeout_us, 0);
+}
+
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
 {
 	int tid = task_get_current();
 	int ret;
 	pthread_mutex_lock(&interrupt_lock);
-	if (timeout_us > 0)
+	if (timeout_us > 0) {
 		tasks[tid].wake_time.val = get_time().val + timeout_us;
+		tasks[tid].wake_slack = slack_us;
+	}
 
 	/* Transfer control to scheduler */
-	pthread_cond_signal(&scheduler_cond);
-	pthread_cond_wait(&tasks[tid].resume, &run_lock);
+	task_switch_to_scheduler(tid);
 
 	/* Resume */
 	ret = tasks[tid].event;
@@ -292,6 +453,40 @@ void wait_for_task_started(void)
 	}
 }
 
+uint32_t timer_get_wakeups(task_id_t tskid)
+{
+	return tasks[tskid].wakeups;
+}
+
+uint32_t timer_get_events(void)
+{
+	return timer_events;
+}
+
+/* Latest time at which a task's timer may fire */
+static timestamp_t task_wake_latest(int i)
+{
+	timestamp_t t;
+
+	t.val = tasks[i].wake_time.val;
+	if (t.val != ~0ull)
+		t.val += tasks[i].wake_slack;
+	return t;
+}
+
+/*
+ * Whether a task's timer should fire now.  A timer fires at the end of its
+ * slack window, or earlier if its window overlaps a wakeup which another
+ * timer already caused.
+ */
+static int task_timer_due(int i, timestamp_t now)
+{
+	if (now.val >= task_wake_latest(i).val)
+		return 1;
+	return now.val >= tasks[i].wake_time.val &&
+		tasks[i].wake_time.val <= last_timer_wake.val;
+}
+
 static task_id_t task_get_next_wake(void)
 {
 	int i;
@@ -301,8 +496,8 @@ static task_id_t task_get_next_wake(void)
 	min_time.val = ~0ull;
 
 	for (i = TASK_ID_COUNT - 1; i >= 0; --i)
-		if (min_time.val >= tasks[i].wake_time.val) {
-			min_time.val = tasks[i].wake_time.val;
+		if (min_time.val >= task_wake_latest(i).val) {
+			min_time.val = task_wake_latest(i).val;
 			which_task = i;
 		}
 
@@ -322,12 +517,18 @@ static int fast_forward(void)
 	 *   2. When the next task wakes up
 	 */
 	int task_id = task_get_next_wake();
+	int generator = has_interrupt_generator;
 
-	if (!has_interrupt_generator) {
+#ifdef EMU_VIRTUAL_TIME
+	/* A generator which isn't sleeping has exited */
+	generator = generator && generator_sleeping;
+#endif
+
+	if (!generator) {
 		if (task_id == TASK_ID_INVALID) {
 			return TASK_ID_IDLE;
 		} else {
-			force_time(tasks[task_id].wake_time);
+			force_time(task_wake_latest(task_id));
 			return task_id;
 		}
 	}
@@ -336,12 +537,15 @@ static int fast_forward(void)
 		return TASK_ID_IDLE;
 
 	if (task_id != TASK_ID_INVALID &&
-	    tasks[task_id].thread != (pthread_t)NULL &&
-	    tasks[task_id].wake_time.val < generator_sleep_deadline.val) {
-		force_time(tasks[task_id].wake_time);
+	    task_created(task_id) &&
+	    task_wake_latest(task_id).val < generator_sleep_deadline.val) {
+		force_time(task_wake_latest(task_id));
 		return task_id;
 	} else {
 		force_time(generator_sleep_deadline);
+#ifdef EMU_VIRTUAL_TIME
+		task_run_interrupt_generator(generator_sleep_deadline);
+#endif
 		return TASK_ID_IDLE;
 	}
 }
@@ -351,10 +555,59 @@ int task_start_called(void)
 	return task_started;
 }
 
+#ifdef CONFIG_TASK_PROFILING
+int task_get_stats(task_id_t tskid, struct task_stats *stats)
+{
+	if (tskid >= TASK_ID_COUNT)
+		return EC_ERROR_INVAL;
+
+	stats->runtime = tasks[tskid].runtime;
+	stats->switches = tasks[tskid].switches;
+	stats->max_run = tasks[tskid].max_run;
+	return EC_SUCCESS;
+}
+#endif
+
+void task_print_list(void)
+{
+	int i;
+
+	ccputs("Task Name              Events      Time (s)  Switches"
+	       "  Max run (s)    Wakes\n");
+
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+#ifdef CONFIG_TASK_PROFILING
+		ccprintf("%4d %-16s %08x %11.6ld %9d %12.6ld %8d\n", i,
+			 task_names[i], tasks[i].event, tasks[i].runtime,
+			 tasks[i].switches, (uint64_t)tasks[i].max_run,
+			 timer_get_wakeups(i));
+#else
+		ccprintf("%4d %-16s %08x %8d\n", i, task_names[i],
+			 tasks[i].event, timer_get_wakeups(i));
+#endif
+		cflush();
+	}
+	ccprintf("Timer events: %d\n", timer_get_events());
+}
+
+static int command_task_info(int argc, char **argv)
+{
+	task_print_list();
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(taskinfo, command_task_info,
+			NULL,
+			"Print task info",
+			NULL);
+
 void task_scheduler(void)
 {
 	int i;
+	int last_task = -1;
 	timestamp_t now;
+#ifdef CONFIG_TASK_PROFILING
+	uint64_t run;
+#endif
 
 	task_started = 1;
 
@@ -363,12 +616,11 @@ void task_scheduler(void)
 		i = TASK_ID_COUNT - 1;
 		while (i >= 0) {
 			/*
-			 * Only tasks with spawned threads are valid to be
+			 * Only tasks which have been created are valid to be
 			 * resumed.
 			 */
-			if (tasks[i].thread) {
-				if (tasks[i].event ||
-				    now.val >= tasks[i].wake_time.val)
+			if (task_created(i)) {
+				if (tasks[i].event || task_timer_due(i, now))
 					break;
 			}
 			--i;
@@ -376,24 +628,74 @@ void task_scheduler(void)
 		if (i < 0)
 			i = fast_forward();
 
+		now = get_time();
+		if (tasks[i].wake_time.val != ~0ull &&
+		    now.val >= tasks[i].wake_time.val) {
+			tasks[i].wakeups++;
+			if (tasks[i].wake_time.val > last_timer_wake.val)
+				timer_events++;
+			last_timer_wake = now;
+		}
 		tasks[i].wake_time.val = ~0ull;
 		running_task_id = i;
 		tasks[i].started = 1;
-		pthread_cond_signal(&tasks[i].resume);
-		pthread_cond_wait(&scheduler_cond, &run_lock);
+		if (i != last_task)
+			TRACE_TASK_SWITCH(i);
+		last_task = i;
+		task_resume(i);
+
+#ifdef CONFIG_TASK_PROFILING
+		/* Bill the task for the time until it gave control back */
+		run = get_time().val - now.val;
+		tasks[i].runtime += run;
+		tasks[i].switches++;
+		if (run > tasks[i].max_run)
+			tasks[i].max_run = run;
+#endif
 	}
 }
 
-void *_task_start_impl(void *a)
+test_mockable void interrupt_generator(void)
+{
+	has_interrupt_generator = 0;
+}
+
+void *_task_int_generator_start(void *d)
+{
+	my_task_id = TASK_ID_INT_GEN;
+	interrupt_generator();
+#ifdef EMU_VIRTUAL_TIME
+	sem_post(&generator_done);
+#endif
+	return NULL;
+}
+
+/* Start the interrupt generator thread */
+static void task_start_interrupt_generator(void)
+{
+#ifdef EMU_VIRTUAL_TIME
+	sem_init(&generator_wake, 0, 0);
+	sem_init(&generator_done, 0, 0);
+#endif
+	pthread_create(&interrupt_thread, NULL,
+		       _task_int_generator_start, NULL);
+#ifdef EMU_VIRTUAL_TIME
+	/* Let it run up to its first sleep */
+	wait_for_generator();
+#endif
+}
+
+#ifdef EMU_COROUTINES
+static void _task_start_impl(int tid)
 {
-	long tid = (long)a;
 	struct task_args *arg = task_info + tid;
-	my_task_id = tid;
-	pthread_mutex_lock(&run_lock);
 
-	/* Wait for scheduler */
-	task_wait_event(1);
+	/*
+	 * We were resumed by the scheduler for the first time; finish the
+	 * switch the way task_wait_event_slack() would.
+	 */
 	tasks[tid].event = 0;
+	pthread_mutex_unlock(&interrupt_lock);
 
 	/* Start the task routine */
 	(arg->routine)(arg->d);
@@ -403,16 +705,72 @@ void *_task_start_impl(void *a)
 		task_wait_event(-1);
 }
 
-test_mockable void interrupt_generator(void)
+static void task_create(task_id_t tskid)
 {
-	has_interrupt_generator = 0;
+	tasks[tskid].event = TASK_EVENT_WAKE;
+	tasks[tskid].wake_time.val = ~0ull;
+	tasks[tskid].started = 0;
+
+	tasks[tskid].stack = malloc(EMU_TASK_STACK_SIZE);
+	getcontext(&tasks[tskid].context);
+	tasks[tskid].context.uc_stack.ss_sp = tasks[tskid].stack;
+	tasks[tskid].context.uc_stack.ss_size = EMU_TASK_STACK_SIZE;
+	tasks[tskid].context.uc_link = NULL;
+	makecontext(&tasks[tskid].context, (void (*)(void))_task_start_impl,
+		    1, (int)tskid);
+	tasks[tskid].created = 1;
 }
 
-void *_task_int_generator_start(void *d)
+int task_start(void)
 {
-	my_task_id = TASK_ID_INT_GEN;
-	interrupt_generator();
-	return NULL;
+	main_thread = pthread_self();
+	pthread_mutex_init(&interrupt_lock, NULL);
+
+	/*
+	 * Only the hooks task runs at first.  After its init, it will call
+	 * task_enable_all_tasks() to create the remaining tasks.
+	 */
+	task_create(TASK_ID_HOOKS);
+
+	/*
+	 * The scheduler always holds the interrupt lock, and each task
+	 * releases it as it resumes.
+	 */
+	pthread_mutex_lock(&interrupt_lock);
+
+	task_start_interrupt_generator();
+
+	task_scheduler();
+
+	return 0;
+}
+
+void task_enable_all_tasks(void)
+{
+	int i;
+
+	for (i = 0; i < TASK_ID_COUNT; ++i)
+		if (!task_created(i))
+			task_create(i);
+}
+#else
+void *_task_start_impl(void *a)
+{
+	long tid = (long)a;
+	struct task_args *arg = task_info + tid;
+	my_task_id = tid;
+	pthread_mutex_lock(&run_lock);
+
+	/* Wait for scheduler */
+	task_wait_event(1);
+	tasks[tid].event = 0;
+
+	/* Start the task routine */
+	(arg->routine)(arg->d);
+
+	/* Catch exited routine */
+	while (1)
+		task_wait_event(-1);
 }
 
 int task_start(void)
@@ -448,8 +806,7 @@ int task_start(void)
 	 */
 	pthread_mutex_lock(&interrupt_lock);
 
-	pthread_create(&interrupt_thread, NULL,
-		       _task_int_generator_start, NULL);
+	task_start_interrupt_generator();
 
 	/*
 	 * Tell the hooks task to continue so that it can call back to enable
@@ -494,3 +851,4 @@ void task_enable_all_tasks(void)
 	/* Signal to the scheduler to enable the remaining tasks. */
 	pthread_cond_signal(&scheduler_cond);
 }
+#endif
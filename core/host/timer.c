@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <time.h>
 
+#include "host_task.h"
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
@@ -34,9 +35,36 @@
  */
 #define TEST_TIME_SLOW_DOWN 10
 
-static timestamp_t boot_time;
 static int time_set;
 
+#ifdef EMU_VIRTUAL_TIME
+/*
+ * Time moves only when the emulator moves it: when every task is blocked
+ * (see fast_forward()), during udelay(), and by a fixed amount each time a
+ * task reads the clock, so that polling loops still end.  Runs are then
+ * reproducible, and sleeping costs no real time.
+ */
+#define EMU_TIME_READ_COST 1
+
+static timestamp_t virtual_time;
+
+static void advance_time(unsigned us)
+{
+	/* The interrupt generator only reads time while tasks are stopped */
+	if (!task_start_called() || in_interrupt_context()) {
+		virtual_time.val += us;
+		return;
+	}
+	if (task_get_current() == TASK_ID_INT_GEN)
+		return;
+
+	virtual_time.val += us;
+	task_run_interrupt_generator(virtual_time);
+}
+#else
+static timestamp_t boot_time;
+#endif
+
 void usleep(unsigned us)
 {
 	if (!task_start_called()) {
@@ -50,6 +78,29 @@ void usleep(unsigned us)
 	task_wait_event(us);
 }
 
+#ifdef EMU_VIRTUAL_TIME
+timestamp_t get_time(void)
+{
+	advance_time(EMU_TIME_READ_COST);
+	return virtual_time;
+}
+
+void force_time(timestamp_t ts)
+{
+	virtual_time = ts;
+	time_set = 1;
+}
+
+void udelay(unsigned us)
+{
+	if (!in_interrupt_context() && task_get_current() == TASK_ID_INT_GEN) {
+		interrupt_generator_udelay(us);
+		return;
+	}
+
+	advance_time(us);
+}
+#else
 timestamp_t _get_time(void)
 {
 	struct timespec ts;
@@ -87,6 +138,7 @@ void udelay(unsigned us)
 	while (get_time().val < deadline.val)
 		;
 }
+#endif
 
 int timestamp_expired(timestamp_t deadline, const timestamp_t *now)
 {
@@ -102,6 +154,8 @@ int timestamp_expired(timestamp_t deadline, const timestamp_t *now)
 
 void timer_init(void)
 {
+#ifndef EMU_VIRTUAL_TIME
 	if (!time_set)
 		boot_time = _get_time();
+#endif
 }
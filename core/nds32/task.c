@@ -16,6 +16,7 @@
 #include "registers.h"
 #include "task.h"
 #include "timer.h"
+#include "trace.h"
 #include "util.h"
 
 typedef union {
@@ -28,6 +29,11 @@ typedef union {
 		uint32_t events;   /* Bitmaps of received events */
 		uint64_t runtime;  /* Time spent in task */
 		uint32_t *stack;   /* Start of stack */
+#ifdef CONFIG_TASK_PROFILING
+		uint64_t run_start; /* runtime when last switched to */
+		uint32_t switches;  /* Number of times switched to */
+		uint32_t max_run;   /* Longest run without yielding, in us */
+#endif
 	};
 } task_;
 
@@ -184,6 +190,33 @@ static inline task_ *__task_id_to_ptr(task_id_t id)
 	return tasks + id;
 }
 
+#ifdef CONFIG_TASK_PROFILING
+/*
+ * Account for a switch between tasks.  Must be called after the outgoing
+ * task has been billed for its runtime.
+ */
+static void account_switch(task_ *from, task_ *to)
+{
+	uint64_t run = from->runtime - from->run_start;
+
+	if (run > from->max_run)
+		from->max_run = run;
+	to->switches++;
+	to->run_start = to->runtime;
+}
+
+int task_get_stats(task_id_t tskid, struct task_stats *stats)
+{
+	if (tskid >= TASK_ID_COUNT)
+		return EC_ERROR_INVAL;
+
+	stats->runtime = tasks[tskid].runtime;
+	stats->switches = tasks[tskid].switches;
+	stats->max_run = tasks[tskid].max_run;
+	return EC_SUCCESS;
+}
+#endif
+
 /*
  * We use INT_MASK to enable (interrupt_enable)/
  * disable (interrupt_disable) all maskable interrupts.
@@ -298,11 +331,15 @@ task_ *next_sched_task(void)
 {
 	task_ *new_task = __task_id_to_ptr(__fls(tasks_ready));
 
+	if (current_task != new_task)
+		TRACE_TASK_SWITCH(new_task - tasks);
+
 #ifdef CONFIG_TASK_PROFILING
 	if (current_task != new_task) {
 		if ((current_task - tasks) < TASK_ID_COUNT) {
 			current_task->runtime +=
 				(exc_start_time - exc_end_time - exc_sub_time);
+			account_switch(current_task, new_task);
 		}
 		task_will_switch = 1;
 	}
@@ -397,7 +434,7 @@ void end_irq_handler(void)
 #endif
 }
 
-static uint32_t __wait_evt(int timeout_us, task_id_t resched)
+static uint32_t __wait_evt(int timeout_us, int slack_us, task_id_t resched)
 {
 	task_ *tsk = current_task;
 	task_id_t me = tsk - tasks;
@@ -409,7 +446,7 @@ static uint32_t __wait_evt(int timeout_us, task_id_t resched)
 	if (timeout_us > 0) {
 		timestamp_t deadline = get_time();
 		deadline.val += timeout_us;
-		ret = timer_arm(deadline, me);
+		ret = timer_arm_slack(deadline, slack_us, me);
 		ASSERT(ret == EC_SUCCESS);
 	}
 	while (!(evt = atomic_read_clear(&tsk->events))) {
@@ -437,7 +474,7 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 		need_resched = 1;
 	} else {
 		if (wait)
-			return __wait_evt(-1, tskid);
+			return __wait_evt(-1, 0, tskid);
 		else
 			__schedule(0, tskid, 0);
 	}
@@ -447,7 +484,12 @@ uint32_t task_set_event(task_id_t tskid, uint32_t event, int wait)
 
 uint32_t task_wait_event(int timeout_us)
 {
-	return __wait_evt(timeout_us, TASK_ID_IDLE);
+	return __wait_evt(timeout_us, 0, TASK_ID_IDLE);
+}
+
+uint32_t task_wait_event_slack(int timeout_us, int slack_us)
+{
+	return __wait_evt(timeout_us, slack_us, TASK_ID_IDLE);
 }
 
 uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
@@ -461,7 +503,7 @@ uint32_t task_wait_event_mask(uint32_t event_mask, int timeout_us)
 
 	while (!(events & event_mask)) {
 		/* Collect events to re-post later */
-		events |= __wait_evt(time_remaining_us, TASK_ID_IDLE);
+		events |= __wait_evt(time_remaining_us, 0, TASK_ID_IDLE);
 
 		time_remaining_us = deadline - get_time().val;
 		if (timeout_us > 0 && time_remaining_us <= 0) {
@@ -633,11 +675,17 @@ void mutex_unlock(struct mutex *mtx)
 	atomic_clear(&tsk->events, TASK_EVENT_MUTEX);
 }
 
+const char *task_get_name(task_id_t tskid)
+{
+	return task_names[tskid];
+}
+
 void task_print_list(void)
 {
 	int i;
 
-	ccputs("Task Ready Name         Events      Time (s)  StkUsed\n");
+	ccputs("Task Ready Name         Events      Time (s)  StkUsed"
+	       "    Wakes\n");
 
 	for (i = 0; i < TASK_ID_COUNT; i++) {
 		char is_ready = (tasks_ready & (1<<i)) ? 'R' : ' ';
@@ -650,11 +698,13 @@ void task_print_list(void)
 		     sp++)
 			stackused -= sizeof(uint32_t);
 
-		ccprintf("%4d %c %-16s %08x %11.6ld  %3d/%3d\n", i, is_ready,
-			 task_names[i], tasks[i].events, tasks[i].runtime,
-			 stackused, tasks_init[i].stack_size);
+		ccprintf("%4d %c %-16s %08x %11.6ld  %3d/%3d %8d\n", i,
+			 is_ready, task_names[i], tasks[i].events,
+			 tasks[i].runtime, stackused, tasks_init[i].stack_size,
+			 timer_get_wakeups(i));
 		cflush();
 	}
+	ccprintf("Timer events: %d\n", timer_get_events());
 }
 
 int command_task_info(int argc, char **argv)
@@ -683,6 +733,14 @@ int command_task_info(int argc, char **argv)
 	ccprintf("Time in tasks:          %11.6ld s\n",
 		 get_time().val - task_start_time);
 	ccprintf("Time in exceptions:     %11.6ld s\n", exc_total_time);
+	cflush();
+
+	ccputs("Task Name              Switches  Max run (s)\n");
+	for (i = 0; i < TASK_ID_COUNT; i++) {
+		ccprintf("%4d %-16s %10d %12.6ld\n", i, task_names[i],
+			 tasks[i].switches, (uint64_t)tasks[i].max_run);
+		cflush();
+	}
 #endif
 
 	return EC_SUCCESS;
@@ -619,6 +619,20 @@
  */
 #undef CONFIG_CONSOLE_RESTRICTED_INPUT
 
+/*
+ * Enable tokenized console logging.  Messages printed with ctprints() are
+ * stored in a binary ring buffer as the address of their format string, a
+ * timestamp and the raw arguments instead of being formatted on the EC.
+ * The host drains them with EC_CMD_CONSOLE_READ_TOKENS and util/ec_tokens.py
+ * turns them back into text using the EC's ELF images.
+ *
+ * Without this, ctprints() is the same as cprints().
+ */
+#undef CONFIG_CONSOLE_TOKENIZED
+
+/* Size of the tokenized console log in bytes; must be a power of two */
+#define CONFIG_CONSOLE_TOKENIZED_BUF_SIZE 1024
+
 /*
  * Enable the experimental console.
  *
@@ -770,6 +784,14 @@
 #undef CONFIG_FLASH_ERASED_VALUE32
 #undef CONFIG_FLASH_ERASE_SIZE
 
+/*
+ * Support the EC_CMD_FLASH_HASH host command, so the host can verify flash
+ * from SHA-256 digests of blocks instead of reading it all back.  Dropped
+ * unless SHA-256 is in the image anyway, for CONFIG_SHA256 or
+ * CONFIG_VBOOT_HASH.
+ */
+#define CONFIG_FLASH_HASH
+
 /* Base address of program memory */
 #undef CONFIG_PROGRAM_MEMORY_BASE
 
@@ -1061,6 +1083,14 @@
 /* Enable debugging and profiling statistics for hook functions */
 #undef CONFIG_HOOK_DEBUG
 
+/*
+ * Maximum number of hooks, across all hook types, which can be sorted by
+ * priority at first use.  hook_notify() then calls them with a single walk
+ * of the sorted table.  Hook types which don't fit, or which have more than
+ * 255 hooks, fall back to searching for each priority in turn.
+ */
+#define CONFIG_HOOK_SORTED_MAX 128
+
 /*****************************************************************************/
 /* CRC configuration */
 
@@ -1547,6 +1577,19 @@
 #undef CONFIG_SHA384
 #undef CONFIG_SHA512
 
+/*
+ * Hash with the chip's SHA engine where it has one.  The chip provides the
+ * SHA256_hw_*() hooks declared in sha256.h.
+ */
+#undef CONFIG_SHA256_HW_ACCELERATE
+
+/*
+ * Unroll the SHA-256 rounds, for speed at the cost of about 1.7 KB of code.
+ * Boards which hash enough for it to matter, and have the flash, can define
+ * this.
+ */
+#undef CONFIG_SHA256_UNROLL
+
 /* Emulate the CLZ (Count Leading Zeros) in software for CPU lacking support */
 #undef CONFIG_SOFTWARE_CLZ
 
@@ -1588,6 +1631,20 @@
 /* SPI flash part supports SR2 register */
 #undef CONFIG_SPI_FLASH_HAS_SR2
 
+/*
+ * Read SPI flash with Fast Read (0x0B) rather than Read Data (0x03).  Parts
+ * specify Read Data to a lower clock than their other instructions, so this
+ * is needed to run the SPI bus at the part's full speed.
+ */
+#undef CONFIG_SPI_FLASH_FAST_READ
+
+/*
+ * Largest SPI flash read done as one SPI transaction, in bytes.  Should be as
+ * much as the SPI master can receive at once; bigger reads take fewer
+ * transactions but hold the SPI bus for longer.
+ */
+#define CONFIG_SPI_FLASH_READ_CHUNK_SIZE 4096
+
 /* SPI master feature */
 #undef CONFIG_SPI_MASTER
 
@@ -1683,6 +1740,20 @@
 /* Speak the TPM SPI Hardware Protocol on the SPI slave interface */
 #undef CONFIG_TPM_SPS
 
+/*****************************************************************************/
+/*
+ * Enable event tracing.  The trace points in trace.h record task switches,
+ * hooks, deferred calls, host commands, I2C transfers and lightbar frames
+ * into a RAM ring buffer.  The host drains it with EC_CMD_TRACE_READ and
+ * util/ec_trace.py turns it into a Chrome trace-event timeline.
+ *
+ * Without this, the trace points compile to nothing.
+ */
+#undef CONFIG_TRACE
+
+/* Number of events in the trace buffer; must be a power of two */
+#define CONFIG_TRACE_BUF_EVENTS 128
+
 /*****************************************************************************/
 /* USART stream config */
 #undef CONFIG_STREAM_USART
@@ -2077,6 +2148,12 @@
 #define CONFIG_CRC8
 #endif /* defined(CONFIG_EXPERIMENTAL_CONSOLE) */
 
+/*****************************************************************************/
+/* Flash hashing is only worth it if SHA-256 is there for something else */
+#if !defined(CONFIG_SHA256) && !defined(CONFIG_VBOOT_HASH)
+#undef CONFIG_FLASH_HASH
+#endif
+
 /*****************************************************************************/
 /*
  * Handle task-dependent configs.
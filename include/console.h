@@ -110,6 +110,34 @@ int cprintf(enum console_channel channel, const char *format, ...);
  */
 int cprints(enum console_channel channel, const char *format, ...);
 
+#ifdef CONFIG_CONSOLE_TOKENIZED
+#include <stdarg.h>
+
+/**
+ * Log a message in tokenized form.
+ *
+ * Takes the same arguments as cprints(), but records the format string
+ * address, a timestamp and the raw arguments instead of printing text.  The
+ * format must be a string constant in the image; %s arguments are copied
+ * and truncated to 32 characters.
+ *
+ * @param channel	Output channel
+ * @param format	Format string; see printf.h for valid formatting codes
+ *
+ * @return EC_SUCCESS, or EC_ERROR_OVERFLOW if the arguments did not all fit
+ * or a string was truncated; the record is logged either way.
+ */
+int ctprints(enum console_channel channel, const char *format, ...);
+
+/**
+ * Add a record to the tokenized log; used by ctprints().
+ */
+int console_tokens_vadd(enum console_channel channel, const char *format,
+			va_list args);
+#else
+#define ctprints cprints
+#endif
+
 /**
  * Flush the console output for all channels.
  */
@@ -20,6 +20,9 @@ void crc32_hash32(uint32_t val);
 
 void crc32_hash16(uint16_t val);
 
+/* Add a buffer of any size and alignment to the CRC */
+void crc32_hash(const void *buf, int size);
+
 uint32_t crc32_result(void);
 
 #endif /* CONFIG_HW_CRC */
@@ -950,6 +950,35 @@ struct ec_response_get_features {
 	uint32_t flags[2];
 } __packed;
 
+/*
+ * Get per-task CPU usage, for boards with CONFIG_TASK_PROFILING.
+ *
+ * Response is struct ec_response_task_stats followed by stats for as many
+ * tasks as fit, starting at task 'first'.  Call again with first advanced by
+ * count until first + count reaches task_count.
+ */
+#define EC_CMD_TASK_STATS 0x0e
+
+#define EC_TASK_NAME_SIZE 16
+
+struct ec_params_task_stats {
+	uint8_t first;		/* ID of first task to return */
+} __packed;
+
+struct ec_task_stats {
+	char name[EC_TASK_NAME_SIZE];	/* Null-padded, may be truncated */
+	uint64_t runtime;	/* Time spent running, in us */
+	uint32_t switches;	/* Number of times switched to */
+	uint32_t max_run;	/* Longest run without yielding, in us */
+} __packed;
+
+struct ec_response_task_stats {
+	uint8_t task_count;	/* Total number of tasks */
+	uint8_t count;		/* Number of entries which follow */
+	uint16_t reserved;
+	/* struct ec_task_stats stats[count]; */
+} __packed;
+
 /*****************************************************************************/
 /* Flash commands */
 
@@ -1100,6 +1129,38 @@ struct ec_response_flash_protect {
  * write protect.  These commands may be reused with version > 0.
  */
 
+/*
+ * Hash blocks of flash
+ *
+ * Lets the host check flash contents without reading them back.  Response
+ * is the SHA-256 digest of each block in turn, so at most
+ * EC_FLASH_HASH_MAX_BLOCKS blocks can be hashed at once, and fewer if the
+ * response buffer is small.  The blocks may total at most
+ * EC_FLASH_HASH_MAX_SIZE bytes, so that one command doesn't hold up the host
+ * command task for long; larger areas must be hashed in smaller blocks.
+ */
+#define EC_CMD_FLASH_HASH 0x14
+#define EC_VER_FLASH_HASH 1  /* Version 0 was an old command */
+
+#define EC_FLASH_HASH_MAX_BLOCKS 8
+#define EC_FLASH_HASH_MAX_SIZE 0x10000
+
+enum ec_flash_hash_type {
+	EC_FLASH_HASH_TYPE_SHA256 = 0,  /* 32-byte digest per block */
+};
+
+struct ec_flash_hash_block {
+	uint32_t offset;   /* Byte offset of block */
+	uint32_t size;     /* Size of block in bytes */
+} __packed;
+
+struct ec_params_flash_hash {
+	uint8_t hash_type;    /* enum ec_flash_hash_type */
+	uint8_t block_count;  /* Number of blocks which follow */
+	uint16_t reserved;    /* Set to 0 */
+	struct ec_flash_hash_block block[0];
+} __packed;
+
 /* Get the region offset/size */
 #define EC_CMD_FLASH_REGION_INFO 0x16
 #define EC_VER_FLASH_REGION_INFO 1
@@ -1146,6 +1207,23 @@ struct ec_response_vbnvcontext {
 	uint8_t block[EC_VBNV_BLOCK_SIZE];
 } __packed;
 
+/*
+ * Find out which erase blocks of a range of flash are erased, so the host
+ * can skip erasing them.  Offset and size must be multiples of the erase
+ * block size, and size at most EC_FLASH_BLANK_CHECK_MAX_SIZE, since blocks
+ * may have to be read to check them.  Response is a bitmap with a bit per
+ * block, LSB of the first byte first, set if the block is erased.
+ */
+#define EC_CMD_FLASH_BLANK_CHECK 0x18
+#define EC_VER_FLASH_BLANK_CHECK 1  /* Version 0 was an old command */
+
+#define EC_FLASH_BLANK_CHECK_MAX_SIZE 0x10000
+
+struct ec_params_flash_blank_check {
+	uint32_t offset;   /* Byte offset of range */
+	uint32_t size;     /* Size of range in bytes */
+} __packed;
+
 /*****************************************************************************/
 /* PWM commands */
 
@@ -2667,6 +2745,113 @@ struct ec_params_console_read_v1 {
 	uint8_t subcmd; /* enum ec_console_read_subcmd */
 } __packed;
 
+/*
+ * Read console output by byte sequence number.
+ *
+ * Every byte written to the console output buffer is numbered, starting at
+ * 0 when the EC boots.  The host passes the sequence number of the next byte
+ * it wants, and gets back as much output from there as fits, without
+ * needing EC_CMD_CONSOLE_SNAPSHOT.  To tail the console, pass the next_seq
+ * from the previous response.
+ *
+ * If the requested bytes have already been overwritten, the response starts
+ * at the oldest byte still buffered and lost says how many were skipped.  If
+ * seq is ahead of the EC (for example, the EC rebooted), the response starts
+ * at the oldest byte still buffered with lost = 0; the host can tell this
+ * happened from next_seq going backwards.
+ *
+ * Response is struct ec_response_console_read_seq followed by
+ * (next_seq - seq) bytes of console output; not null-terminated.
+ */
+#define EC_CMD_CONSOLE_READ_SEQ 0xa4
+
+struct ec_params_console_read_seq {
+	uint32_t seq;		/* Sequence number of the first byte wanted */
+} __packed;
+
+struct ec_response_console_read_seq {
+	uint32_t seq;		/* Sequence number of the first byte returned */
+	uint32_t next_seq;	/* Sequence number after the last byte */
+	uint32_t lost;		/* Bytes overwritten before they were read */
+	/* uint8_t data[]; */
+} __packed;
+
+/*
+ * Read and remove records from the tokenized console log.
+ *
+ * Response is struct ec_response_console_read_tokens followed by as many
+ * whole struct ec_console_token records as fit.  An empty list means the
+ * log is drained.
+ */
+#define EC_CMD_CONSOLE_READ_TOKENS 0xa3
+
+/* Maximum bytes of argument data in a single token record */
+#define EC_CONSOLE_TOKEN_MAX_ARGS 64
+
+/* Set in the channel field if the arguments or a string did not all fit */
+#define EC_CONSOLE_TOKEN_TRUNCATED 0x80
+
+struct ec_console_token {
+	uint32_t format;	/* Address of the format string in the image */
+	uint32_t timestamp;	/* Low 32 bits of the EC time, in us */
+	uint8_t channel;	/* enum console_channel | flags above */
+	uint8_t size;		/* Bytes of argument data that follow */
+	/* uint8_t args[size]; */
+} __packed;
+
+struct ec_response_console_read_tokens {
+	uint32_t dropped;	/* Records lost to overflow since last read */
+	/* struct ec_console_token records[]; */
+} __packed;
+
+/*
+ * Read and remove events from the trace buffer.
+ *
+ * Response is struct ec_response_trace_read followed by as many struct
+ * ec_trace_event records as fit, oldest first.  An empty list means the
+ * buffer is drained.  util/ec_trace.py converts the records to Chrome
+ * trace-event JSON.
+ */
+#define EC_CMD_TRACE_READ 0xa5
+
+/* Trace event types */
+enum ec_trace_type {
+	EC_TRACE_BEGIN = 0,	/* Start of a span */
+	EC_TRACE_END,		/* End of the innermost span with the same ID */
+	EC_TRACE_INSTANT,	/* Single point in time */
+};
+
+/* Set in the type field if the event was recorded in interrupt context */
+#define EC_TRACE_FLAG_ISR 0x80
+
+/* Trace point IDs */
+enum ec_trace_id {
+	EC_TRACE_ID_TASK_SWITCH = 0,	/* Instant; arg = task switched to */
+	EC_TRACE_ID_HOOK,		/* arg = enum hook_type */
+	EC_TRACE_ID_DEFERRED,		/* arg = address of deferred routine */
+	EC_TRACE_ID_HOST_CMD,		/* arg = command; at end, result */
+	EC_TRACE_ID_I2C_XFER,		/* arg = port << 8 | slave address;
+					 * at end, result */
+	EC_TRACE_ID_LIGHTBAR_SEQ,	/* arg = sequence; at end, next */
+	EC_TRACE_ID_LIGHTBAR_FRAME,	/* Instant; arg = sequence */
+
+	/* IDs from here on are free for boards and tests */
+	EC_TRACE_ID_USER = 0x8000,
+};
+
+struct ec_trace_event {
+	uint32_t timestamp;	/* Low 32 bits of the EC time, in us */
+	uint16_t id;		/* enum ec_trace_id */
+	uint8_t type;		/* enum ec_trace_type | EC_TRACE_FLAG_ISR */
+	uint8_t task;		/* Task which recorded the event */
+	uint32_t arg;		/* Payload; meaning depends on id */
+} __packed;
+
+struct ec_response_trace_read {
+	uint32_t dropped;	/* Events lost to overflow since last read */
+	/* struct ec_trace_event events[]; */
+} __packed;
+
 /*****************************************************************************/
 
 /*
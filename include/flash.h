@@ -138,7 +138,9 @@ uint32_t flash_physical_get_writable_flags(uint32_t cur_flags);
 /**
  * Check if a region of flash is erased
  *
- * It is assumed that an erased region has all bits set to 1.
+ * It is assumed that an erased region has all bits set to 1.  Erase blocks
+ * which flash_erase() has erased, and which have not been written since, are
+ * known to be erased without reading them.
  *
  * @param offset	Flash offset to check
  * @param size		Number of bytes to check (word-aligned)
@@ -230,6 +232,35 @@ int flash_write(int offset, int size, const char *data);
  */
 int flash_erase(int offset, int size);
 
+/**
+ * Note that a range of flash has changed.
+ *
+ * flash_write() and flash_erase() do this themselves.  Code which changes
+ * flash with flash_physical_write() or flash_physical_erase() directly must
+ * call this both before and after, so that the generation count changes and
+ * the range is no longer assumed to be erased.  The call before keeps
+ * anything computed from the flash while it is changing from being cached
+ * under the old count.
+ *
+ * @param offset	Flash offset of changed range
+ * @param size		Size of changed range in bytes
+ */
+#ifdef CONFIG_FLASH
+void flash_invalidate(int offset, int size);
+#else
+static inline void flash_invalidate(int offset, int size) { }
+#endif
+
+/**
+ * Return the flash generation count.
+ *
+ * The count changes on every flash_write() or flash_erase(), and when the
+ * write protect state is written to flash.  Code caching something derived
+ * from flash contents can save the count and compare it later to check the
+ * cache is still valid.
+ */
+uint32_t flash_get_generation(void);
+
 /**
  * Return the flash protect state.
  *
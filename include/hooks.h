@@ -198,6 +198,22 @@ void hook_notify(enum hook_type type);
  */
 int hook_call_deferred(void (*routine)(void), int us);
 
+struct deferred_data;
+
+/**
+ * Start a timer to call a deferred routine, given its handle.
+ *
+ * Same as hook_call_deferred(), but takes the routine_data handle that
+ * DECLARE_DEFERRED(routine) defines, so the routine doesn't need to be
+ * looked up.  Prefer this for routines which are re-armed often.
+ *
+ * @param data		Handle of the routine; &routine_data
+ * @param us		Delay in microseconds, as for hook_call_deferred()
+ *
+ * @return non-zero if error.
+ */
+int hook_call_deferred_data(const struct deferred_data *data, int us);
+
 #ifdef CONFIG_COMMON_RUNTIME
 /**
  * Register a hook routine.
@@ -248,10 +264,13 @@ struct deferred_data {
  * functions are called from the same hook task.  See DECLARE_HOOK() for an
  * example.
  *
+ * This also defines routine_data, the handle to pass to
+ * hook_call_deferred_data().
+ *
  * @param routine	Function pointer, with prototype void routine(void)
  */
 #define DECLARE_DEFERRED(routine)					\
-	const struct deferred_data __keep CONCAT2(__deferred_, routine)	\
+	const struct deferred_data __keep CONCAT2(routine, _data)	\
 	__attribute__((section(".rodata.deferred")))			\
 	     = {routine}
 
@@ -67,6 +67,27 @@
 int vfnprintf(int (*addchar)(void *context, int c), void *context,
 	      const char *format, va_list args);
 
+/**
+ * Print formatted output to a function, passing runs of characters in bulk.
+ *
+ * Like vfnprintf(), but literal text between format codes and the body of
+ * each converted field are passed to addstr() in one call instead of one
+ * addchar() call per character.  Padding still goes through addchar().
+ *
+ * @param addchar	Function to be called for single characters
+ * @param addstr	Function to be called for runs of characters.  Should
+ *			return 0 if all len characters were accepted, or
+ *			non-zero if any were dropped due to overflow.  May be
+ *			NULL, in which case addchar() is used for everything.
+ * @param context	Context pointer to pass to addchar() and addstr()
+ * @param format	Format string (see above for acceptable formats)
+ * @param args		Parameters
+ * @return EC_SUCCESS, or non-zero if output was truncated.
+ */
+int vfnprintf_bulk(int (*addchar)(void *context, int c),
+		   int (*addstr)(void *context, const char *str, int len),
+		   void *context, const char *format, va_list args);
+
 /**
  * Print formatted outut to a string.
  *
@@ -64,6 +64,16 @@ struct queue_state {
 	 */
 	size_t head; /* head: next to dequeue */
 	size_t tail; /* tail: next to enqueue */
+
+	/*
+	 * Used only by the multi-producer calls (queue_reserve_tail and
+	 * friends).  Units from tail up to reserve have been handed out to
+	 * producers but not yet committed, and writers is the number of
+	 * reservations still being filled.  Once writers drops to zero, tail
+	 * catches up with reserve.
+	 */
+	size_t reserve;
+	size_t writers;
 };
 
 /*
@@ -157,6 +167,76 @@ size_t queue_advance_head(struct queue const *q, size_t count);
  */
 size_t queue_advance_tail(struct queue const *q, size_t count);
 
+/*
+ * Reservation based queue access.  A queue_reservation is a run of units,
+ * which may wrap around the end of the queue buffer, claimed at the tail by a
+ * producer or at the head by the consumer.  Reserved units are filled (or
+ * read) in place with the calls below and then committed, so a bulk transfer
+ * pays for the queue bookkeeping once rather than once per unit.
+ */
+struct queue_reservation {
+	size_t start; /* Index of first unit, not yet wrapped */
+	size_t count; /* Number of units reserved; may be 0 */
+};
+
+/*
+ * Reserve up to count units of free space at the tail of the queue.
+ *
+ * This is the multi-producer way to add to a queue: any number of tasks and
+ * interrupt handlers may reserve and commit at once, with only a few
+ * instructions run with interrupts disabled.  Units become visible to the
+ * consumer once every reservation made before them has been committed as
+ * well, so commit promptly.  A queue that is added to this way must not also
+ * be added to with queue_advance_tail or queue_add_* (the _mpsc versions are
+ * fine), though it is read with the usual calls.
+ *
+ * Returns the reservation, whose count is less than the count asked for if
+ * the queue is short of space.
+ */
+struct queue_reservation queue_reserve_tail(struct queue const *q,
+					    size_t count);
+
+/*
+ * Commit a reservation returned by queue_reserve_tail, once all of its units
+ * have been written.  Calls the policy add function for the units published.
+ */
+void queue_commit_tail(struct queue const *q,
+		       struct queue_reservation const *r);
+
+/*
+ * Reserve up to count units at the head of the queue, for the consumer to
+ * read in place.  Nothing is removed until queue_commit_head is called.
+ */
+struct queue_reservation queue_reserve_head(struct queue const *q,
+					    size_t count);
+
+/* Remove the units of a reservation returned by queue_reserve_head. */
+size_t queue_commit_head(struct queue const *q,
+			 struct queue_reservation const *r);
+
+/* Return a pointer to the i'th unit of a reservation. */
+void *queue_reservation_unit(struct queue const *q,
+			     struct queue_reservation const *r,
+			     size_t i);
+
+/*
+ * Copy count units into a reservation, starting with its i'th unit.  Returns
+ * the number of units copied, which is limited by the size of the
+ * reservation.
+ */
+size_t queue_reservation_write(struct queue const *q,
+			       struct queue_reservation const *r,
+			       size_t i,
+			       const void *src,
+			       size_t count);
+
+/* Copy count units out of a reservation, starting with its i'th unit. */
+size_t queue_reservation_read(struct queue const *q,
+			      struct queue_reservation const *r,
+			      size_t i,
+			      void *dest,
+			      size_t count);
+
 /* Add one unit to queue. */
 size_t queue_add_unit(struct queue const *q, const void *src);
 
@@ -171,6 +251,15 @@ size_t queue_add_memcpy(struct queue const *q,
 					const void *src,
 					size_t n));
 
+/*
+ * Add one or more units to a queue that may have several producers; see
+ * queue_reserve_tail.  Adds as many units as there is space for.
+ */
+size_t queue_add_unit_mpsc(struct queue const *q, const void *src);
+size_t queue_add_units_mpsc(struct queue const *q,
+			    const void *src,
+			    size_t count);
+
 /* Remove one unit from the begin of the queue. */
 size_t queue_remove_unit(struct queue const *q, void *dest);
 
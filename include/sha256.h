@@ -20,10 +20,40 @@ struct sha256_ctx {
 	uint32_t len;
 	uint8_t block[2 * SHA256_BLOCK_SIZE];
 	uint8_t buf[SHA256_DIGEST_SIZE];  /* Used to store the final digest. */
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+	uint8_t hw;  /* Hashing with the chip's SHA engine */
+#endif
 };
 
 void SHA256_init(struct sha256_ctx *ctx);
 void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len);
 uint8_t *SHA256_final(struct sha256_ctx *ctx);
 
+/*
+ * Abandon a hash without computing the digest.  Callers which may stop
+ * between SHA256_init() and SHA256_final() must call this, so that a SHA
+ * engine in use for the hash is released.
+ */
+void SHA256_abort(struct sha256_ctx *ctx);
+
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+/*
+ * Start a hash which is done in software even though the chip has a SHA
+ * engine; for callers which need to run hashes side by side.
+ */
+void SHA256_sw_init(struct sha256_ctx *ctx);
+
+/*
+ * Hooks provided by the chip.  SHA256_hw_init() claims the SHA engine and
+ * returns non-zero, or returns zero if the engine is busy, in which case
+ * SHA256_init() falls back to software for that hash.  The engine is
+ * released by SHA256_hw_final(), which stores the digest, or by
+ * SHA256_hw_abort(), which discards it.
+ */
+int SHA256_hw_init(void);
+void SHA256_hw_update(const uint8_t *data, uint32_t len);
+void SHA256_hw_final(uint8_t *digest);
+void SHA256_hw_abort(void);
+#endif
+
 #endif  /* __CROS_EC_SHA256_H */
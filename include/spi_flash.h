@@ -22,6 +22,7 @@
 #define SPI_FLASH_ERASE_64KB		0xD8
 #define SPI_FLASH_ERASE_CHIP		0xC7
 #define SPI_FLASH_READ			0x03
+#define SPI_FLASH_FAST_READ		0x0B
 #define SPI_FLASH_PAGE_PRGRM		0x02
 #define SPI_FLASH_REL_PWRDWN		0xAB
 #define SPI_FLASH_MFR_DEV_ID		0x90
@@ -90,10 +91,11 @@ int spi_flash_set_status(int reg1, int reg2);
 
 /**
  * Returns the content of SPI flash
+ * Reads in transactions of up to CONFIG_SPI_FLASH_READ_CHUNK_SIZE bytes.
  *
  * @param buf Buffer to write flash contents
  * @param offset Flash offset to start reading from
- * @param bytes Number of bytes to read. Limited by receive buffer to 256.
+ * @param bytes Number of bytes to read
  *
  * @return EC_SUCCESS, or non-zero if any error.
  */
@@ -111,7 +113,7 @@ int spi_flash_erase(unsigned int offset, unsigned int bytes);
 
 /**
  * Write to SPI flash. Assumes already erased.
- * Limited to SPI_FLASH_MAX_WRITE_SIZE by chip.
+ * Programs one flash page at a time, and waits for the last to finish.
  *
  * @param offset Flash offset to write
  * @param bytes Number of bytes to write
@@ -115,6 +115,22 @@ uint32_t *task_get_event_bitmap(task_id_t tskid);
  */
 uint32_t task_wait_event(int timeout_us);
 
+/**
+ * Wait for the next event, with a timeout which may be extended.
+ *
+ * Like task_wait_event(), but the timer may fire up to slack_us late, so
+ * that it can share a wakeup with other tasks' timers.  Use this for periodic
+ * work which doesn't need an exact period.
+ *
+ * @param timeout_us	If > 0, sets a timer to produce the TASK_EVENT_TIMER
+ *			event after at least the specified micro-second
+ *			duration.
+ * @param slack_us	How much later than timeout_us the timer may fire.
+ *
+ * @return The bitmap of received events.
+ */
+uint32_t task_wait_event_slack(int timeout_us, int slack_us);
+
 /**
  * Wait for any event included in an event mask.
  *
@@ -146,6 +162,23 @@ void task_print_list(void);
 const char *task_get_name(task_id_t tskid);
 
 #ifdef CONFIG_TASK_PROFILING
+/* CPU usage of a task */
+struct task_stats {
+	uint64_t runtime;	/* Time spent running, in us */
+	uint32_t switches;	/* Number of times switched to */
+	uint32_t max_run;	/* Longest run without yielding, in us */
+};
+
+/**
+ * Get the CPU usage of a task.
+ *
+ * @param tskid		Task to get
+ * @param stats		Destination for stats
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if tskid isn't a task.
+ */
+int task_get_stats(task_id_t tskid, struct task_stats *stats);
+
 /**
  * Start tracking an interrupt.
  *
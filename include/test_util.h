@@ -79,6 +79,65 @@
 			return EC_ERROR_UNKNOWN; \
 	} while (0)
 
+/* Maximum number of timed calls in a benchmark */
+#define BENCHMARK_MAX_ITERATIONS 128
+
+/* Number of untimed calls made before the timed ones */
+#define BENCHMARK_WARMUP 3
+
+/* Results of a benchmark */
+struct benchmark_result {
+	/* Time per call, in us */
+	uint32_t min_us;
+	uint32_t median_us;
+	uint32_t max_us;
+	/* Same, in CPU cycles; all 0 if the core can't count cycles */
+	uint32_t min_cycles;
+	uint32_t median_cycles;
+	uint32_t max_cycles;
+};
+
+/**
+ * Time repeated calls to a routine.
+ *
+ * Makes BENCHMARK_WARMUP untimed calls, then times each of 'iterations'
+ * calls and prints the results on one line starting "Benchmark:", as
+ * name=value pairs.  run_host_test and 'make benchmarks' collect these
+ * lines.  Time is measured in whole microseconds, so each call should do
+ * enough work to take several.
+ *
+ * @param name		Name to report the results under
+ * @param routine	Routine to time
+ * @param data		Passed to routine
+ * @param iterations	Number of timed calls; at most
+ *			BENCHMARK_MAX_ITERATIONS
+ * @param samples	Scratch space for BENCHMARK_SAMPLES(iterations)
+ *			values, so only tests which benchmark pay for it
+ * @param result	Destination for results, or NULL
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if iterations is out of range.
+ */
+int benchmark_run(const char *name, void (*routine)(void *data), void *data,
+		  int iterations, uint32_t *samples,
+		  struct benchmark_result *result);
+
+/* Number of samples benchmark_run() needs for a number of timed calls */
+#define BENCHMARK_SAMPLES(iterations) (2 * (iterations))
+
+/* Declare the samples BENCHMARK() uses, for up to 'iterations' calls */
+#define DECLARE_BENCHMARK_SAMPLES(iterations) \
+	static uint32_t benchmark_samples[BENCHMARK_SAMPLES(iterations)]
+
+/* Benchmark a routine under its own name; a failure to run fails the test */
+#define BENCHMARK(routine, data, iterations) \
+	do { \
+		BUILD_ASSERT(BENCHMARK_SAMPLES(iterations) <= \
+			     ARRAY_SIZE(benchmark_samples)); \
+		if (benchmark_run(#routine, routine, data, iterations, \
+				  benchmark_samples, NULL) != EC_SUCCESS) \
+			__test_error_count++; \
+	} while (0)
+
 /* Mutlistep test states */
 enum test_state_t {
 	TEST_STATE_STEP_1 = 0,
@@ -152,6 +211,9 @@ uint32_t prng(uint32_t seed);
 
 uint32_t prng_no_seed(void);
 
+/* Set the state of prng_no_seed(), to reproduce a run */
+void prng_set_seed(uint32_t seed);
+
 /* Number of failed tests */
 extern int __test_error_count;
 
@@ -261,4 +323,24 @@ int test_detach_i2c(int port, int slave_addr);
  */
 int test_attach_i2c(int port, int slave_addr);
 
+/* Activity of the emulated SPI flash */
+struct spi_flash_emu_stats {
+	int transactions;
+	int bytes;		/* Sent and received, including commands */
+	int reads;		/* Read Data (0x03) commands */
+	int fast_reads;		/* Fast Read (0x0B) commands */
+	int programs;
+	int erases;
+	int ignored;		/* Commands sent while the part was busy */
+};
+
+/* Erase the emulated SPI flash, clear its status registers and activity */
+void spi_flash_emu_reset(void);
+
+/* Clear the emulated SPI flash activity counts */
+void spi_flash_emu_clear_stats(void);
+
+/* Get the emulated SPI flash activity since the counts were last cleared */
+const struct spi_flash_emu_stats *spi_flash_emu_get_stats(void);
+
 #endif /* __CROS_EC_TEST_UTIL_H */
@@ -45,6 +45,34 @@ void timer_init(void);
  */
 int timer_arm(timestamp_t tstamp, task_id_t tskid);
 
+/**
+ * Launch a one-shot timer for a task, which may fire late.
+ *
+ * The timer fires no earlier than tstamp and no later than tstamp + slack_us.
+ * Within that window, it fires along with any other timer which is due, so
+ * that tasks with nearby deadlines share a single wakeup.
+ *
+ * @param tstamp	Earliest expiration timestamp for timer
+ * @param slack_us	How late the timer may fire, in microseconds
+ * @param tskid		Task to set timer for
+ *
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+int timer_arm_slack(timestamp_t tstamp, uint32_t slack_us, task_id_t tskid);
+
+/**
+ * Return the number of times a task's timer has expired.
+ */
+uint32_t timer_get_wakeups(task_id_t tskid);
+
+/**
+ * Return the number of timer events which expired at least one timer.
+ *
+ * Compared with the sum of timer_get_wakeups() for all tasks, this shows how
+ * many wakeups were shared.
+ */
+uint32_t timer_get_events(void);
+
 /**
  * Cancel a running timer for the specified task id.
  */
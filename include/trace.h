@@ -0,0 +1,52 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Event tracing for Chrome EC */
+
+#ifndef __CROS_EC_TRACE_H
+#define __CROS_EC_TRACE_H
+
+#include "common.h"
+#include "ec_commands.h"
+
+#ifdef CONFIG_TRACE
+
+/**
+ * Record a trace event.
+ *
+ * May be called from any task or interrupt.
+ *
+ * @param id		Trace point ID (enum ec_trace_id)
+ * @param type		Event type (enum ec_trace_type)
+ * @param arg		Payload
+ */
+void trace_add(uint16_t id, uint8_t type, uint32_t arg);
+
+/**
+ * Record a trace event, with interrupts already disabled.
+ *
+ * This is for the schedulers, which can't re-enable interrupts on the way
+ * out.  Parameters are the same as trace_add().
+ */
+void __trace_add(uint16_t id, uint8_t type, uint32_t arg);
+
+#define TRACE_BEGIN(id, arg) trace_add(id, EC_TRACE_BEGIN, arg)
+#define TRACE_END(id, arg) trace_add(id, EC_TRACE_END, arg)
+#define TRACE_INSTANT(id, arg) trace_add(id, EC_TRACE_INSTANT, arg)
+
+/* Record a switch to a task; for use by the scheduler only */
+#define TRACE_TASK_SWITCH(tskid) \
+	__trace_add(EC_TRACE_ID_TASK_SWITCH, EC_TRACE_INSTANT, tskid)
+
+#else
+
+#define TRACE_BEGIN(id, arg) do {} while (0)
+#define TRACE_END(id, arg) do {} while (0)
+#define TRACE_INSTANT(id, arg) do {} while (0)
+#define TRACE_TASK_SWITCH(tskid) do {} while (0)
+
+#endif  /* CONFIG_TRACE */
+
+#endif  /* __CROS_EC_TRACE_H */
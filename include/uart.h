@@ -47,6 +47,18 @@ int uart_putc(int c);
  */
 int uart_puts(const char *outstr);
 
+/**
+ * Put a block of characters to the UART.
+ *
+ * Newlines are translated to CRLF as for uart_puts(), but runs of other
+ * characters are copied into the transmit buffer in bulk.
+ *
+ * @param out		Characters to put; need not be null-terminated
+ * @param len		Number of characters
+ * @return EC_SUCCESS, or non-zero if output was truncated.
+ */
+int uart_put(const char *out, int len);
+
 /**
  * Print formatted output to the UART, like printf().
  *
@@ -0,0 +1,206 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Benchmarks of common library code, and tests of the benchmark harness.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "crc.h"
+#include "math_util.h"
+#include "printf.h"
+#include "queue.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define ITERATIONS 20
+
+DECLARE_BENCHMARK_SAMPLES(ITERATIONS);
+
+/*
+ * Repeat each benchmark's work more in the emulator, which is much faster
+ * than an EC, so the times are long enough to measure in microseconds.
+ */
+#ifdef EMU_BUILD
+#define REPEAT 100
+#else
+#define REPEAT 1
+#endif
+
+/* Input for the hashes */
+static uint8_t data[1024];
+
+static void bench_printf(void *unused)
+{
+	char buf[64];
+	int i;
+
+	for (i = 0; i < 10 * REPEAT; i++)
+		snprintf(buf, sizeof(buf), "%d %s 0x%08x %.3d %ld", i, "abc",
+			 0x1234abcd, -12345, 1234567890123ll);
+}
+
+static struct queue const bench_queue = QUEUE_NULL(64, uint32_t);
+
+static void bench_queue_units(void *unused)
+{
+	uint32_t units[16];
+	int i;
+
+	for (i = 0; i < 100 * REPEAT; i++) {
+		queue_add_units(&bench_queue, units, ARRAY_SIZE(units));
+		queue_remove_units(&bench_queue, units, ARRAY_SIZE(units));
+	}
+}
+
+static void bench_queue_unit(void *unused)
+{
+	uint32_t unit = 0;
+	int i;
+
+	for (i = 0; i < 1000 * REPEAT; i++) {
+		queue_add_unit(&bench_queue, &unit);
+		queue_remove_unit(&bench_queue, &unit);
+	}
+}
+
+static void bench_queue_units_mpsc(void *unused)
+{
+	uint32_t units[16];
+	int i;
+
+	for (i = 0; i < 100 * REPEAT; i++) {
+		queue_add_units_mpsc(&bench_queue, units, ARRAY_SIZE(units));
+		queue_remove_units(&bench_queue, units, ARRAY_SIZE(units));
+	}
+}
+
+/* Keeps the units read in place from being optimized away */
+static volatile uint32_t queue_sum;
+
+static void bench_queue_reserve(void *unused)
+{
+	struct queue_reservation r;
+	int i, j;
+
+	for (i = 0; i < 100 * REPEAT; i++) {
+		r = queue_reserve_tail(&bench_queue, 16);
+		for (j = 0; j < r.count; j++)
+			*(uint32_t *)queue_reservation_unit(&bench_queue,
+							    &r, j) = j;
+		queue_commit_tail(&bench_queue, &r);
+
+		r = queue_reserve_head(&bench_queue, 16);
+		for (j = 0; j < r.count; j++)
+			queue_sum += *(uint32_t *)queue_reservation_unit(
+				&bench_queue, &r, j);
+		queue_commit_head(&bench_queue, &r);
+	}
+}
+
+static void bench_crc32(void *unused)
+{
+	int i, j;
+
+	crc32_init();
+	for (j = 0; j < REPEAT; j++)
+		for (i = 0; i < sizeof(data); i += 4)
+			crc32_hash32(*(uint32_t *)(data + i));
+}
+
+static void bench_crc32_buf(void *unused)
+{
+	int j;
+
+	crc32_init();
+	for (j = 0; j < REPEAT; j++)
+		crc32_hash(data, sizeof(data));
+}
+
+static void bench_sha256(void *unused)
+{
+	struct sha256_ctx ctx;
+	int i;
+
+	SHA256_init(&ctx);
+	for (i = 0; i < REPEAT; i++)
+		SHA256_update(&ctx, data, sizeof(data));
+	SHA256_final(&ctx);
+}
+
+/* Keeps results from being optimized away */
+static volatile fp_t arc_cos_result;
+
+static void bench_arc_cos(void *unused)
+{
+	int i, j;
+
+	for (j = 0; j < REPEAT; j++)
+		for (i = -50; i <= 50; i++)
+			arc_cos_result = arc_cos(fp_div(INT_TO_FP(i),
+							INT_TO_FP(50)));
+}
+
+static void delay_100us(void *unused)
+{
+	udelay(100);
+}
+
+static int calls;
+
+static void count_calls(void *unused)
+{
+	calls++;
+}
+
+static int test_harness(void)
+{
+	struct benchmark_result r;
+
+	calls = 0;
+	TEST_ASSERT(benchmark_run("count", count_calls, NULL, 10,
+				  benchmark_samples, &r) == EC_SUCCESS);
+	TEST_ASSERT(calls == 10 + BENCHMARK_WARMUP);
+
+	TEST_ASSERT(benchmark_run("udelay", delay_100us, NULL, 10,
+				  benchmark_samples, &r) == EC_SUCCESS);
+	TEST_ASSERT(r.min_us >= 100);
+	TEST_ASSERT(r.min_us <= r.median_us && r.median_us <= r.max_us);
+	TEST_ASSERT(r.min_cycles <= r.median_cycles &&
+		    r.median_cycles <= r.max_cycles);
+
+	TEST_ASSERT(benchmark_run("none", count_calls, NULL, 0,
+				  benchmark_samples, &r) == EC_ERROR_INVAL);
+	TEST_ASSERT(benchmark_run("many", count_calls, NULL,
+				  BENCHMARK_MAX_ITERATIONS + 1,
+				  benchmark_samples, &r) == EC_ERROR_INVAL);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = prng_no_seed();
+
+	test_reset();
+
+	RUN_TEST(test_harness);
+
+	BENCHMARK(bench_printf, NULL, ITERATIONS);
+	BENCHMARK(bench_queue_units, NULL, ITERATIONS);
+	BENCHMARK(bench_queue_unit, NULL, ITERATIONS);
+	BENCHMARK(bench_queue_units_mpsc, NULL, ITERATIONS);
+	BENCHMARK(bench_queue_reserve, NULL, ITERATIONS);
+	BENCHMARK(bench_crc32, NULL, ITERATIONS);
+	BENCHMARK(bench_crc32_buf, NULL, ITERATIONS);
+	BENCHMARK(bench_sha256, NULL, ITERATIONS);
+	BENCHMARK(bench_arc_cos, NULL, ITERATIONS);
+
+	test_print_result();
+}
@@ -35,13 +35,20 @@ test-list-$(BOARD_LARS_PD)=
 # Emulator tests
 test-list-host=mutex pingpong utils kb_scan kb_mkbp lid_sw power_button hooks
 test-list-host+=thermal flash queue kb_8042 extpwr_gpio console_edit system
-test-list-host+=sbs_charging host_command
+test-list-host+=console_tokens timer_slack sched_bench task_stats trace
+test-list-host+=benchmark
+test-list-host+=sbs_charging host_command queue_mpsc sha256 vboot_hash rsa
+test-list-host+=crc32 spi_flash
 test-list-host+=bklight_lid bklight_passthru interrupt timer_dos button
 test-list-host+=math_util motion_lid sbs_charging_v2 battery_get_params_smart
 test-list-host+=lightbar inductive_charging usb_pd fan charge_manager
 test-list-host+=charge_manager_drp_charging charge_ramp
 
+# Emulator tests which print benchmark results, for 'make benchmarks'
+bench-list-host=benchmark sched_bench spi_flash
+
 battery_get_params_smart-y=battery_get_params_smart.o
+benchmark-y=benchmark.o
 bklight_lid-y=bklight_lid.o
 bklight_passthru-y=bklight_passthru.o
 button-y=button.o
@@ -49,6 +56,8 @@ charge_manager-y=charge_manager.o
 charge_manager_drp_charging-y=charge_manager.o
 charge_ramp-y+=charge_ramp.o
 console_edit-y=console_edit.o
+console_tokens-y=console_tokens.o
+crc32-y=crc32.o
 extpwr_gpio-y=extpwr_gpio.o
 flash-y=flash.o
 hooks-y=hooks.o
@@ -59,6 +68,8 @@ interrupt-scale=10
 kb_8042-y=kb_8042.o
 kb_mkbp-y=kb_mkbp.o
 kb_scan-y=kb_scan.o
+# Takes longer than run_host_tests' default timeout alongside other tests
+kb_scan-timeout=30
 lid_sw-y=lid_sw.o
 math_util-y=math_util.o
 motion_lid-y=motion_lid.o
@@ -67,15 +78,25 @@ pingpong-y=pingpong.o
 power_button-y=power_button.o
 powerdemo-y=powerdemo.o
 queue-y=queue.o
+queue_mpsc-y=queue_mpsc.o
+queue_mpsc-scale=10
+rsa-y=rsa.o
 sbs_charging-y=sbs_charging.o
 sbs_charging_v2-y=sbs_charging_v2.o
+sched_bench-y=sched_bench.o
+sha256-y=sha256.o
+spi_flash-y=spi_flash.o
 stress-y=stress.o
 system-y=system.o
+task_stats-y=task_stats.o
 thermal-y=thermal.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
+timer_slack-y=timer_slack.o
+trace-y=trace.o
 usb_pd-y=usb_pd.o
 utils-y=utils.o
+vboot_hash-y=vboot_hash.o
 battery_get_params_smart-y=battery_get_params_smart.o
 lightbar-y=lightbar.o
 fan-y=fan.o
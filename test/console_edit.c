@@ -7,12 +7,14 @@
 
 #include "common.h"
 #include "console.h"
+#include "ec_commands.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
 
 static int cmd_1_call_cnt;
 static int cmd_2_call_cnt;
+static int cmd_tab_call_cnt;
 
 static int command_test_1(int argc, char **argv)
 {
@@ -28,6 +30,13 @@ static int command_test_2(int argc, char **argv)
 }
 DECLARE_CONSOLE_COMMAND(test2, command_test_2, NULL, NULL, NULL);
 
+static int command_tab_test(int argc, char **argv)
+{
+	cmd_tab_call_cnt++;
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(tabtest, command_tab_test, NULL, NULL, NULL);
+
 /*****************************************************************************/
 /* Test utilities */
 
@@ -273,6 +282,126 @@ static int test_output_channel(void)
 	return EC_SUCCESS;
 }
 
+static int test_prefix_lookup(void)
+{
+	cmd_1_call_cnt = 0;
+	cmd_2_call_cnt = 0;
+	cmd_tab_call_cnt = 0;
+	/* Ambiguous between test1 and test2 */
+	UART_INJECT("test\n");
+	msleep(30);
+	/* Unique prefix, exact match and case-insensitive match */
+	UART_INJECT("tabt\n");
+	UART_INJECT("test1\n");
+	UART_INJECT("TEST2\n");
+	msleep(30);
+	TEST_CHECK(cmd_1_call_cnt == 1 && cmd_2_call_cnt == 1 &&
+		   cmd_tab_call_cnt == 1);
+}
+
+static int test_tab_complete_unique(void)
+{
+	cmd_tab_call_cnt = 0;
+	test_capture_console(1);
+	UART_INJECT("tab\t");
+	msleep(30);
+	test_capture_console(0);
+	TEST_ASSERT(compare_multiline_string(test_get_captured_console(),
+					     "tabtest ") == 0);
+	UART_INJECT("\n");
+	msleep(30);
+	TEST_CHECK(cmd_tab_call_cnt == 1);
+}
+
+static int test_tab_complete_common_prefix(void)
+{
+	cmd_1_call_cnt = 0;
+	UART_INJECT("tes\t1\n");
+	msleep(30);
+	TEST_CHECK(cmd_1_call_cnt == 1);
+}
+
+static int test_tab_complete_list(void)
+{
+	const char *exp_output = "test\n"
+				 "test1 test2 \n"
+				 "> test";
+
+	cmd_2_call_cnt = 0;
+	test_capture_console(1);
+	UART_INJECT("test\t");
+	msleep(30);
+	test_capture_console(0);
+	TEST_ASSERT(compare_multiline_string(test_get_captured_console(),
+					     exp_output) == 0);
+	UART_INJECT("2\n");
+	msleep(30);
+	TEST_CHECK(cmd_2_call_cnt == 1);
+}
+
+static char seq_resp[256];
+
+static int read_seq(uint32_t seq, struct ec_response_console_read_seq **r)
+{
+	struct ec_params_console_read_seq p = { .seq = seq };
+
+	*r = (struct ec_response_console_read_seq *)seq_resp;
+	memset(seq_resp, 0, sizeof(seq_resp));
+	return test_send_host_command(EC_CMD_CONSOLE_READ_SEQ, 0,
+				      &p, sizeof(p),
+				      seq_resp, sizeof(seq_resp));
+}
+
+static int test_console_read_seq(void)
+{
+	struct ec_response_console_read_seq *r;
+	uint32_t seq = 0;
+	int i;
+
+	/* Host command debug output would land in the buffer too */
+	UART_INJECT("hcdebug off\n");
+	msleep(30);
+
+	/* Catch up with everything printed so far */
+	cflush();
+	do {
+		TEST_ASSERT(read_seq(seq, &r) == EC_RES_SUCCESS);
+		seq = r->next_seq;
+	} while (r->next_seq != r->seq);
+
+	cputs(CC_COMMAND, "hello\n");
+	cflush();
+	TEST_ASSERT(read_seq(seq, &r) == EC_RES_SUCCESS);
+	TEST_ASSERT(r->seq == seq);
+	TEST_ASSERT(r->next_seq == seq + 7);
+	TEST_ASSERT(r->lost == 0);
+	TEST_ASSERT_ARRAY_EQ((char *)(r + 1), "hello\r\n", 7);
+	seq = r->next_seq;
+
+	/* Overrun the buffer; the oldest output is reported as lost */
+	for (i = 0; i < CONFIG_UART_TX_BUF_SIZE / 8; i++) {
+		cputs(CC_COMMAND, "0123456789abcdef");
+		cflush();
+	}
+	TEST_ASSERT(read_seq(seq, &r) == EC_RES_SUCCESS);
+	TEST_ASSERT(r->lost == CONFIG_UART_TX_BUF_SIZE + 1);
+	TEST_ASSERT(r->seq == seq + r->lost);
+	TEST_ASSERT(r->next_seq - r->seq ==
+		    sizeof(seq_resp) - sizeof(*r));
+	TEST_ASSERT(((char *)(r + 1))[0] ==
+		    "0123456789abcdef"[(r->seq - seq) % 16]);
+
+	/* A sequence number from the future starts at the oldest data */
+	TEST_ASSERT(read_seq(seq + 0x80000000, &r) == EC_RES_SUCCESS);
+	TEST_ASSERT(r->lost == 0);
+	TEST_ASSERT(r->seq == seq + CONFIG_UART_TX_BUF_SIZE + 1);
+
+	UART_INJECT("hcdebug normal\n");
+	msleep(30);
+
+	return EC_SUCCESS;
+}
+
 void run_test(void)
 {
 	test_reset();
@@ -290,6 +419,11 @@ void run_test(void)
 	RUN_TEST(test_history_stash);
 	RUN_TEST(test_history_list);
 	RUN_TEST(test_output_channel);
+	RUN_TEST(test_prefix_lookup);
+	RUN_TEST(test_tab_complete_unique);
+	RUN_TEST(test_tab_complete_common_prefix);
+	RUN_TEST(test_tab_complete_list);
+	RUN_TEST(test_console_read_seq);
 
 	test_print_result();
 }
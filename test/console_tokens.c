@@ -0,0 +1,135 @@
+/* Copyright (c) 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test tokenized console logging.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "test_util.h"
+#include "util.h"
+
+static uint8_t resp[CONFIG_CONSOLE_TOKENIZED_BUF_SIZE + 64];
+
+/* Drain the log; returns the number of records read */
+static int read_tokens(uint32_t *dropped)
+{
+	struct ec_response_console_read_tokens *r = (void *)resp;
+	struct ec_console_token *t;
+	uint8_t *p = resp + sizeof(*r);
+	int count = 0;
+
+	memset(resp, 0, sizeof(resp));
+	TEST_ASSERT(test_send_host_command(EC_CMD_CONSOLE_READ_TOKENS, 0,
+					   NULL, 0, resp, sizeof(resp)) ==
+		    EC_RES_SUCCESS);
+	*dropped = r->dropped;
+
+	for (t = (void *)p; t->format; t = (void *)p) {
+		p += sizeof(*t) + t->size;
+		count++;
+	}
+	return count;
+}
+
+static int test_encoding(void)
+{
+	static const char fmt[] = "a %d b %s c %lx d %.2h e %T";
+	const uint8_t hex[2] = {0x12, 0x34};
+	struct ec_console_token *t;
+	uint32_t dropped;
+	uint8_t *args;
+
+	read_tokens(&dropped);
+
+	TEST_ASSERT(ctprints(CC_COMMAND, fmt, -5, "hello",
+			     0x1122334455667788ULL, hex) == EC_SUCCESS);
+	TEST_ASSERT(read_tokens(&dropped) == 1);
+	TEST_ASSERT(dropped == 0);
+
+	t = (void *)(resp + sizeof(struct ec_response_console_read_tokens));
+	TEST_ASSERT(t->format == (uint32_t)(uintptr_t)fmt);
+	TEST_ASSERT(t->channel == CC_COMMAND);
+	TEST_ASSERT(t->size == 4 + 1 + 5 + 8 + 2);
+
+	args = (uint8_t *)(t + 1);
+	TEST_ASSERT(*(int32_t *)args == -5);
+	TEST_ASSERT(args[4] == 5);
+	TEST_ASSERT(!memcmp(args + 5, "hello", 5));
+	TEST_ASSERT(*(uint64_t *)(args + 10) == 0x1122334455667788ULL);
+	TEST_ASSERT(!memcmp(args + 18, hex, 2));
+
+	return EC_SUCCESS;
+}
+
+static int test_truncated(void)
+{
+	struct ec_console_token *t;
+	uint32_t dropped;
+	int i;
+
+	read_tokens(&dropped);
+
+	/* 17 four-byte arguments don't fit in EC_CONSOLE_TOKEN_MAX_ARGS */
+	TEST_ASSERT(ctprints(CC_COMMAND, "%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d%d",
+			     1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+			     16, 17) == EC_ERROR_OVERFLOW);
+	TEST_ASSERT(read_tokens(&dropped) == 1);
+
+	t = (void *)(resp + sizeof(struct ec_response_console_read_tokens));
+	TEST_ASSERT(t->channel == (CC_COMMAND | EC_CONSOLE_TOKEN_TRUNCATED));
+	TEST_ASSERT(t->size == EC_CONSOLE_TOKEN_MAX_ARGS);
+	for (i = 0; i < 16; i++)
+		TEST_ASSERT(((int32_t *)(t + 1))[i] == i + 1);
+
+	/* Strings are cut to 32 characters */
+	TEST_ASSERT(ctprints(CC_COMMAND, "%s",
+			     "0123456789abcdef0123456789abcdefXYZ") ==
+		    EC_ERROR_OVERFLOW);
+	TEST_ASSERT(read_tokens(&dropped) == 1);
+	TEST_ASSERT(t->channel == (CC_COMMAND | EC_CONSOLE_TOKEN_TRUNCATED));
+	TEST_ASSERT(t->size == 1 + 32);
+	TEST_ASSERT(((uint8_t *)(t + 1))[0] == 32);
+
+	return EC_SUCCESS;
+}
+
+static int test_overwrite(void)
+{
+	const int record = sizeof(struct ec_console_token) + 4;
+	const int fit = CONFIG_CONSOLE_TOKENIZED_BUF_SIZE / record;
+	uint32_t dropped;
+	int i;
+
+	read_tokens(&dropped);
+
+	for (i = 0; i < fit + 10; i++)
+		ctprints(CC_COMMAND, "%d", i);
+
+	TEST_ASSERT(read_tokens(&dropped) == fit);
+	TEST_ASSERT(dropped == 10);
+
+	/* The oldest records are the ones thrown away */
+	TEST_ASSERT(*(int32_t *)(resp +
+				 sizeof(struct ec_response_console_read_tokens) +
+				 sizeof(struct ec_console_token)) == 10);
+
+	/* Reading resets the drop count */
+	TEST_ASSERT(read_tokens(&dropped) == 0);
+	TEST_ASSERT(dropped == 0);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_encoding);
+	RUN_TEST(test_truncated);
+	RUN_TEST(test_overwrite);
+
+	test_print_result();
+}
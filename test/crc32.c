@@ -0,0 +1,145 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for CRC-32, checked against a bit-at-a-time reference.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "crc.h"
+#include "test_util.h"
+#include "util.h"
+
+/* Word aligned, so both the aligned and unaligned paths can be tried */
+static uint32_t data_words[256 / 4 + 1];
+
+/* Bit-at-a-time CRC-32, with the same constants as crc32_*() */
+static uint32_t reference_crc32(const uint8_t *p, int size)
+{
+	uint32_t crc = 0xffffffff;
+	int i;
+
+	while (size--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+	}
+
+	return crc ^ 0xffffffff;
+}
+
+static void fill_data(void)
+{
+	uint8_t *data = (uint8_t *)data_words;
+	int i;
+
+	for (i = 0; i < sizeof(data_words); i++)
+		data[i] = prng_no_seed();
+}
+
+static int test_check_value(void)
+{
+	/* The standard check value for this CRC */
+	crc32_init();
+	crc32_hash("123456789", 9);
+	TEST_ASSERT(crc32_result() == 0xcbf43926);
+
+	crc32_init();
+	TEST_ASSERT(crc32_result() == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_words(void)
+{
+	const uint8_t *data = (const uint8_t *)data_words;
+	int len, i;
+
+	fill_data();
+	for (len = 0; len <= 256; len += 4) {
+		crc32_init();
+		for (i = 0; i < len / 4; i++)
+			crc32_hash32(data_words[i]);
+		TEST_ASSERT(crc32_result() == reference_crc32(data, len));
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_half_words(void)
+{
+	const uint8_t *data = (const uint8_t *)data_words;
+	const uint16_t *half_words = (const uint16_t *)data_words;
+	int len, i;
+
+	fill_data();
+	for (len = 0; len <= 256; len += 2) {
+		crc32_init();
+		for (i = 0; i < len / 2; i++)
+			crc32_hash16(half_words[i]);
+		TEST_ASSERT(crc32_result() == reference_crc32(data, len));
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_pd_message(void)
+{
+	/* A USB PD message is a 16-bit header and some 32-bit objects */
+	uint8_t msg[2 + 7 * 4];
+	uint16_t header = 0x1161;
+	int i;
+
+	fill_data();
+	memcpy(msg, &header, sizeof(header));
+	memcpy(msg + 2, data_words, 7 * 4);
+
+	crc32_init();
+	crc32_hash16(header);
+	for (i = 0; i < 7; i++)
+		crc32_hash32(data_words[i]);
+	TEST_ASSERT(crc32_result() == reference_crc32(msg, sizeof(msg)));
+
+	return EC_SUCCESS;
+}
+
+static int test_buffers(void)
+{
+	const uint8_t *data = (const uint8_t *)data_words;
+	int offset, len, split;
+
+	fill_data();
+	for (offset = 0; offset < 4; offset++) {
+		for (len = 0; len <= 67; len++) {
+			uint32_t expected = reference_crc32(data + offset, len);
+
+			crc32_init();
+			crc32_hash(data + offset, len);
+			TEST_ASSERT(crc32_result() == expected);
+
+			/* In two pieces, so words straddle the split */
+			for (split = 0; split <= len; split += 5) {
+				crc32_init();
+				crc32_hash(data + offset, split);
+				crc32_hash(data + offset + split, len - split);
+				TEST_ASSERT(crc32_result() == expected);
+			}
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_check_value);
+	RUN_TEST(test_words);
+	RUN_TEST(test_half_words);
+	RUN_TEST(test_pd_message);
+	RUN_TEST(test_buffers);
+
+	test_print_result();
+}
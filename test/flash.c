@@ -11,6 +11,7 @@
 #include "gpio.h"
 #include "hooks.h"
 #include "host_command.h"
+#include "sha256.h"
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
@@ -334,6 +335,56 @@ static int test_overwrite_other(void)
 	return EC_SUCCESS;
 }
 
+static int blank_check(int offset, int size, uint8_t *erased)
+{
+	struct ec_params_flash_blank_check params;
+
+	params.offset = offset;
+	params.size = size;
+
+	return test_send_host_command(EC_CMD_FLASH_BLANK_CHECK,
+				      EC_VER_FLASH_BLANK_CHECK, &params,
+				      sizeof(params), erased, 1);
+}
+
+static int test_blank_check(void)
+{
+	int offset = CONFIG_RW_STORAGE_OFF + CONFIG_RW_SIZE -
+		     4 * CONFIG_FLASH_ERASE_SIZE;
+	uint8_t erased;
+
+#ifdef EMU_BUILD
+	mock_is_running_img = 0;
+#endif
+
+	/* Erase two of four blocks, then write to one of them */
+	VERIFY_ERASE(offset, 4 * CONFIG_FLASH_ERASE_SIZE);
+	VERIFY_WRITE(offset, strlen(testdata), testdata);
+	VERIFY_WRITE(offset + 3 * CONFIG_FLASH_ERASE_SIZE, strlen(testdata),
+		     testdata);
+	VERIFY_ERASE(offset, 2 * CONFIG_FLASH_ERASE_SIZE);
+	VERIFY_WRITE(offset + CONFIG_FLASH_ERASE_SIZE, strlen(testdata),
+		     testdata);
+
+	TEST_ASSERT(blank_check(offset, 4 * CONFIG_FLASH_ERASE_SIZE,
+				&erased) == EC_RES_SUCCESS);
+	TEST_ASSERT(erased == 0x05);
+	TEST_ASSERT(flash_is_erased(offset, CONFIG_FLASH_ERASE_SIZE));
+	TEST_ASSERT(!flash_is_erased(offset, 2 * CONFIG_FLASH_ERASE_SIZE));
+
+	/* Range must be whole blocks and not too big, and the bitmap must fit */
+	TEST_ASSERT(blank_check(offset + 4, CONFIG_FLASH_ERASE_SIZE,
+				&erased) == EC_RES_INVALID_PARAM);
+	TEST_ASSERT(blank_check(0, EC_FLASH_BLANK_CHECK_MAX_SIZE +
+				CONFIG_FLASH_ERASE_SIZE, &erased) ==
+		    EC_RES_INVALID_PARAM);
+	TEST_ASSERT(blank_check(offset - 8 * CONFIG_FLASH_ERASE_SIZE,
+				12 * CONFIG_FLASH_ERASE_SIZE, &erased) !=
+		    EC_RES_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
 static int test_op_failure(void)
 {
 	mock_flash_op_fail = EC_ERROR_UNKNOWN;
@@ -373,6 +424,71 @@ static int test_region_info(void)
 	return EC_SUCCESS;
 }
 
+static int test_hash(void)
+{
+	uint8_t buf[sizeof(struct ec_params_flash_hash) +
+		    2 * sizeof(struct ec_flash_hash_block)];
+	struct ec_params_flash_hash *p = (struct ec_params_flash_hash *)buf;
+	uint8_t digests[2 * SHA256_DIGEST_SIZE];
+	struct sha256_ctx ctx;
+	uint8_t *want;
+
+	p->hash_type = EC_FLASH_HASH_TYPE_SHA256;
+	p->block_count = 2;
+	p->reserved = 0;
+	p->block[0].offset = 0;
+	p->block[0].size = 1024;
+	p->block[1].offset = 100;
+	p->block[1].size = 7;
+
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_HASH,
+					   EC_VER_FLASH_HASH, p, sizeof(buf),
+					   digests, sizeof(digests)) ==
+		    EC_RES_SUCCESS);
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (const uint8_t *)CONFIG_MAPPED_STORAGE_BASE, 1024);
+	want = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(digests, want, SHA256_DIGEST_SIZE);
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (const uint8_t *)CONFIG_MAPPED_STORAGE_BASE + 100,
+		      7);
+	want = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(digests + SHA256_DIGEST_SIZE, want,
+			     SHA256_DIGEST_SIZE);
+
+	/* Blocks must be within flash, and hashes of a known type */
+	p->block[1].offset = CONFIG_FLASH_SIZE - 4;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_HASH,
+					   EC_VER_FLASH_HASH, p, sizeof(buf),
+					   digests, sizeof(digests)) ==
+		    EC_RES_INVALID_PARAM);
+	p->block[1].offset = 100;
+
+	/* Blocks may only add up to so much */
+	p->block[0].size = EC_FLASH_HASH_MAX_SIZE;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_HASH,
+					   EC_VER_FLASH_HASH, p, sizeof(buf),
+					   digests, sizeof(digests)) ==
+		    EC_RES_INVALID_PARAM);
+	p->block[1].size = 0;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_HASH,
+					   EC_VER_FLASH_HASH, p, sizeof(buf),
+					   digests, sizeof(digests)) ==
+		    EC_RES_SUCCESS);
+	p->block[0].size = 1024;
+	p->block[1].size = 7;
+
+	p->hash_type = 1;
+	TEST_ASSERT(test_send_host_command(EC_CMD_FLASH_HASH,
+					   EC_VER_FLASH_HASH, p, sizeof(buf),
+					   digests, sizeof(digests)) ==
+		    EC_RES_INVALID_PARAM);
+
+	return EC_SUCCESS;
+}
+
 static int test_write_protect(void)
 {
 	/* Test we can control write protect GPIO */
@@ -448,9 +564,11 @@ static void run_test_step1(void)
 	RUN_TEST(test_is_erased);
 	RUN_TEST(test_overwrite_current);
 	RUN_TEST(test_overwrite_other);
+	RUN_TEST(test_blank_check);
 	RUN_TEST(test_op_failure);
 	RUN_TEST(test_flash_info);
 	RUN_TEST(test_region_info);
+	RUN_TEST(test_hash);
 	RUN_TEST(test_write_protect);
 
 	if (test_get_error_count())
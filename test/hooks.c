@@ -51,12 +51,47 @@ static void second_hook(void)
 }
 DECLARE_HOOK(HOOK_SECOND, second_hook, HOOK_PRIO_DEFAULT);
 
+/* Declared out of priority order; should be called as a, b, c, d */
+static char order_seen[5];
+static int order_count;
+
+static void order_hook(char c)
+{
+	if (order_count < sizeof(order_seen) - 1)
+		order_seen[order_count++] = c;
+}
+
+static void order_d_hook(void) { order_hook('d'); }
+DECLARE_HOOK(HOOK_BATTERY_SOC_CHANGE, order_d_hook, HOOK_PRIO_LAST);
+static void order_b_hook(void) { order_hook('b'); }
+DECLARE_HOOK(HOOK_BATTERY_SOC_CHANGE, order_b_hook, HOOK_PRIO_DEFAULT);
+static void order_a_hook(void) { order_hook('a'); }
+DECLARE_HOOK(HOOK_BATTERY_SOC_CHANGE, order_a_hook, HOOK_PRIO_FIRST);
+static void order_c_hook(void) { order_hook('c'); }
+DECLARE_HOOK(HOOK_BATTERY_SOC_CHANGE, order_c_hook, HOOK_PRIO_DEFAULT);
+
 static void deferred_func(void)
 {
 	deferred_call_count++;
 }
 DECLARE_DEFERRED(deferred_func);
 
+static char deferred_seen[5];
+static int deferred_seen_count;
+
+static void deferred_seen_add(char c)
+{
+	if (deferred_seen_count < sizeof(deferred_seen) - 1)
+		deferred_seen[deferred_seen_count++] = c;
+}
+
+static void deferred_a(void) { deferred_seen_add('a'); }
+DECLARE_DEFERRED(deferred_a);
+static void deferred_b(void) { deferred_seen_add('b'); }
+DECLARE_DEFERRED(deferred_b);
+static void deferred_c(void) { deferred_seen_add('c'); }
+DECLARE_DEFERRED(deferred_c);
+
 static void non_deferred_func(void)
 {
 	deferred_call_count++;
@@ -101,6 +136,21 @@ static int test_priority(void)
 	return EC_SUCCESS;
 }
 
+static int test_sorted_order(void)
+{
+	int i;
+
+	/* Same order every time, and equal priorities keep link order */
+	for (i = 0; i < 2; i++) {
+		order_count = 0;
+		hook_notify(HOOK_BATTERY_SOC_CHANGE);
+		TEST_ASSERT(order_count == 4);
+		TEST_ASSERT_ARRAY_EQ(order_seen, "abcd", 4);
+	}
+
+	return EC_SUCCESS;
+}
+
 static int test_deferred(void)
 {
 	deferred_call_count = 0;
@@ -130,6 +180,37 @@ static int test_deferred(void)
 	return EC_SUCCESS;
 }
 
+static int test_deferred_order(void)
+{
+	deferred_seen_count = 0;
+
+	/* Called in deadline order, not the order they were set */
+	hook_call_deferred_data(&deferred_c_data, 30 * MSEC);
+	hook_call_deferred(deferred_b, 20 * MSEC);
+	hook_call_deferred_data(&deferred_a_data, 10 * MSEC);
+	usleep(50 * MSEC);
+	TEST_ASSERT(deferred_seen_count == 3);
+	TEST_ASSERT_ARRAY_EQ(deferred_seen, "abc", 3);
+
+	/* Moving and cancelling pending calls */
+	deferred_seen_count = 0;
+	hook_call_deferred_data(&deferred_a_data, 10 * MSEC);
+	hook_call_deferred_data(&deferred_b_data, 20 * MSEC);
+	hook_call_deferred_data(&deferred_c_data, 30 * MSEC);
+	hook_call_deferred_data(&deferred_a_data, 40 * MSEC);
+	hook_call_deferred_data(&deferred_b_data, -1);
+	usleep(60 * MSEC);
+	TEST_ASSERT(deferred_seen_count == 2);
+	TEST_ASSERT_ARRAY_EQ(deferred_seen, "ca", 2);
+
+	/* Only registered routines have handles */
+	TEST_ASSERT(hook_call_deferred_data(
+			(const struct deferred_data *)&deferred_seen, 0) ==
+		    EC_ERROR_INVAL);
+
+	return EC_SUCCESS;
+}
+
 void run_test(void)
 {
 	test_reset();
@@ -137,7 +218,9 @@ void run_test(void)
 	RUN_TEST(test_init_hook);
 	RUN_TEST(test_ticks);
 	RUN_TEST(test_priority);
+	RUN_TEST(test_sorted_order);
 	RUN_TEST(test_deferred);
+	RUN_TEST(test_deferred_order);
 
 	test_print_result();
 }
@@ -300,6 +300,124 @@ static int test_queue8_chunks_advance(void)
 	return EC_SUCCESS;
 }
 
+static int test_queue8_reserve(void)
+{
+	static uint8_t const data[5] = {1, 2, 3, 4, 5};
+	struct queue_reservation a, b;
+	uint8_t buf[5];
+
+	queue_init(&test_queue8);
+
+	/* Two producers reserve space, the second one finishes first */
+	a = queue_reserve_tail(&test_queue8, 3);
+	b = queue_reserve_tail(&test_queue8, 2);
+	TEST_ASSERT(a.count == 3);
+	TEST_ASSERT(b.count == 2);
+	TEST_ASSERT(b.start == a.start + 3);
+
+	/* Reserved units can't be read yet */
+	TEST_ASSERT(queue_is_empty(&test_queue8));
+
+	TEST_ASSERT(queue_reservation_write(&test_queue8, &b, 0,
+					    data + 3, 2) == 2);
+	queue_commit_tail(&test_queue8, &b);
+
+	/* b can't be seen until a, which comes before it, is committed */
+	TEST_ASSERT(queue_is_empty(&test_queue8));
+
+	TEST_ASSERT(queue_reservation_write(&test_queue8, &a, 0,
+					    data, 3) == 3);
+	queue_commit_tail(&test_queue8, &a);
+
+	TEST_ASSERT(queue_count(&test_queue8) == 5);
+	TEST_ASSERT(queue_remove_units(&test_queue8, buf, 5) == 5);
+	TEST_ASSERT_ARRAY_EQ(buf, data, 5);
+
+	return EC_SUCCESS;
+}
+
+static int test_queue8_reserve_full(void)
+{
+	struct queue_reservation a, b;
+	char dummy = 1;
+
+	queue_init(&test_queue8);
+
+	/* Only the free space can be reserved */
+	a = queue_reserve_tail(&test_queue8, 6);
+	b = queue_reserve_tail(&test_queue8, 6);
+	TEST_ASSERT(a.count == 6);
+	TEST_ASSERT(b.count == 2);
+	TEST_ASSERT(queue_reserve_tail(&test_queue8, 1).count == 0);
+	TEST_ASSERT(queue_add_unit_mpsc(&test_queue8, &dummy) == 0);
+
+	/* Writes past the end of a reservation are cut short */
+	TEST_ASSERT(queue_reservation_write(&test_queue8, &b, 1,
+					    "abc", 3) == 1);
+	TEST_ASSERT(queue_reservation_write(&test_queue8, &b, 2,
+					    "abc", 3) == 0);
+
+	queue_commit_tail(&test_queue8, &a);
+	queue_commit_tail(&test_queue8, &b);
+	TEST_ASSERT(queue_is_full(&test_queue8));
+
+	return EC_SUCCESS;
+}
+
+static int test_queue8_reserve_wrapped(void)
+{
+	static uint8_t const data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+	struct queue_reservation r;
+	uint8_t buf[8];
+	int i;
+
+	queue_init(&test_queue8);
+
+	/* Move near the end of the queue */
+	TEST_ASSERT(queue_add_units_mpsc(&test_queue8, data, 6) == 6);
+	TEST_ASSERT(queue_advance_head(&test_queue8, 6) == 6);
+
+	/* Fill the queue in place, wrapping around the end of the buffer */
+	r = queue_reserve_tail(&test_queue8, 8);
+	TEST_ASSERT(r.count == 8);
+	for (i = 0; i < 8; i++)
+		*(uint8_t *)queue_reservation_unit(&test_queue8, &r, i) =
+			data[i];
+	queue_commit_tail(&test_queue8, &r);
+	TEST_ASSERT(queue_is_full(&test_queue8));
+
+	/* Read it back the same way, without removing anything at first */
+	r = queue_reserve_head(&test_queue8, 10);
+	TEST_ASSERT(r.count == 8);
+	TEST_ASSERT(queue_reservation_read(&test_queue8, &r, 1, buf, 8) == 7);
+	TEST_ASSERT_ARRAY_EQ(buf, data + 1, 7);
+	TEST_ASSERT(queue_is_full(&test_queue8));
+
+	TEST_ASSERT(queue_commit_head(&test_queue8, &r) == 8);
+	TEST_ASSERT(queue_is_empty(&test_queue8));
+
+	return EC_SUCCESS;
+}
+
+static int test_queue2_add_mpsc(void)
+{
+	int16_t units[3] = {-1, 2, -3};
+	int16_t buf[3];
+
+	queue_init(&test_queue2);
+
+	TEST_ASSERT(queue_add_unit_mpsc(&test_queue2, units) == 1);
+	TEST_ASSERT(queue_add_units_mpsc(&test_queue2, units + 1, 2) == 1);
+	TEST_ASSERT(queue_add_unit_mpsc(&test_queue2, units) == 0);
+
+	TEST_ASSERT(queue_remove_unit(&test_queue2, buf) == 1);
+	TEST_ASSERT(queue_add_units_mpsc(&test_queue2, units + 2, 1) == 1);
+	TEST_ASSERT(queue_remove_units(&test_queue2, buf + 1, 3) == 2);
+	TEST_ASSERT(buf[0] == -1 && buf[1] == 2 && buf[2] == -3);
+
+	return EC_SUCCESS;
+}
+
 void run_test(void)
 {
 	test_reset();
@@ -316,6 +434,10 @@ void run_test(void)
 	RUN_TEST(test_queue8_chunks_full);
 	RUN_TEST(test_queue8_chunks_empty);
 	RUN_TEST(test_queue8_chunks_advance);
+	RUN_TEST(test_queue8_reserve);
+	RUN_TEST(test_queue8_reserve_full);
+	RUN_TEST(test_queue8_reserve_wrapped);
+	RUN_TEST(test_queue2_add_mpsc);
 
 	test_print_result();
 }
@@ -0,0 +1,189 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Stress test for multi-producer queue access.
+ *
+ * Two tasks and an interrupt handler add numbered units to one queue while
+ * the test task drains it.  The task producers sometimes sleep while holding
+ * a reservation, so others reserve and commit around them.  Each producer's
+ * units must come out complete and in order, with none lost.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "queue.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define PRODUCER_ISR 2
+#define PRODUCERS 3
+
+#define TEST_TIME (500 * MSEC)
+
+/* A unit holds its producer in the top byte and a sequence number below */
+#define UNIT(p, seq) (((p) << 24) | ((seq) & 0xffffff))
+
+static struct queue const test_queue = QUEUE_NULL(32, uint32_t);
+
+static volatile int running;
+
+/* Units added and found by each producer */
+static uint32_t sent[PRODUCERS];
+static uint32_t received[PRODUCERS];
+
+/* Reservations made while an earlier one was still being filled */
+static int overlaps;
+
+/* Reservations that found the queue full */
+static int full;
+
+/* Interrupts that added to the queue */
+static int isr_count;
+
+static void produce(int p, int max_units)
+{
+	struct queue_reservation r;
+	int i;
+
+	r = queue_reserve_tail(&test_queue, 1 + prng_no_seed() % max_units);
+	if (!r.count) {
+		full++;
+		return;
+	}
+
+	if (r.start != test_queue.state->tail)
+		overlaps++;
+
+	for (i = 0; i < r.count; i++) {
+		*(uint32_t *)queue_reservation_unit(&test_queue, &r, i) =
+			UNIT(p, sent[p] + i);
+
+		/* Tasks give the others a chance to get in */
+		if (p != PRODUCER_ISR && !(prng_no_seed() % 8))
+			usleep(1 + prng_no_seed() % 200);
+	}
+	sent[p] += r.count;
+
+	queue_commit_tail(&test_queue, &r);
+}
+
+static void producer(int p)
+{
+	while (1) {
+		task_wait_event(-1);
+		while (running) {
+			produce(p, 4);
+			usleep(1 + prng_no_seed() % 300);
+		}
+	}
+}
+
+int producer_a(void *data)
+{
+	producer(0);
+	return EC_SUCCESS;
+}
+
+int producer_b(void *data)
+{
+	producer(1);
+	return EC_SUCCESS;
+}
+
+static void producer_isr(void)
+{
+	if (!running)
+		return;
+
+	produce(PRODUCER_ISR, 2);
+	isr_count++;
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(50 + prng_no_seed() % 500);
+		task_trigger_test_interrupt(producer_isr);
+	}
+}
+
+/* Drain the queue, checking each unit; return non-zero on a bad unit */
+static int consume(void)
+{
+	struct queue_reservation r;
+	uint32_t units[8];
+	uint32_t p;
+	int i;
+
+	while (1) {
+		r = queue_reserve_head(&test_queue, ARRAY_SIZE(units));
+		if (!r.count)
+			return 0;
+
+		queue_reservation_read(&test_queue, &r, 0, units, r.count);
+		for (i = 0; i < r.count; i++) {
+			p = units[i] >> 24;
+			if (p >= PRODUCERS ||
+			    units[i] != UNIT(p, received[p])) {
+				ccprintf("Bad unit 0x%08x\n", units[i]);
+				return 1;
+			}
+			received[p]++;
+		}
+
+		queue_commit_head(&test_queue, &r);
+	}
+}
+
+static int test_stress(void)
+{
+	timestamp_t deadline;
+	int p;
+
+	queue_init(&test_queue);
+
+	/* Let the producers start up and block */
+	task_wake(TASK_ID_PRODUCER_A);
+	task_wake(TASK_ID_PRODUCER_B);
+	msleep(10);
+
+	running = 1;
+	task_wake(TASK_ID_PRODUCER_A);
+	task_wake(TASK_ID_PRODUCER_B);
+
+	deadline.val = get_time().val + TEST_TIME;
+	while (!timestamp_expired(deadline, NULL)) {
+		TEST_ASSERT(!consume());
+		usleep(1 + prng_no_seed() % 1000);
+	}
+
+	/* Stop the producers, wait for them to commit and drain the rest */
+	running = 0;
+	msleep(10);
+	TEST_ASSERT(!consume());
+
+	for (p = 0; p < PRODUCERS; p++) {
+		ccprintf("Producer %d: sent %d received %d\n", p, sent[p],
+			 received[p]);
+		TEST_ASSERT(sent[p] > 0);
+		TEST_ASSERT(received[p] == sent[p]);
+	}
+	ccprintf("%d interrupts, %d overlapping reservations, %d full\n",
+		 isr_count, overlaps, full);
+	TEST_ASSERT(isr_count > 0);
+	TEST_ASSERT(overlaps > 0);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_stress);
+
+	test_print_result();
+}
@@ -0,0 +1,108 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Known-answer tests and a benchmark for RSA signature verification.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "rsa.h"
+#include "test_util.h"
+#include "util.h"
+
+#include "rsa2048-F4.h"
+
+#define ITERATIONS 20
+
+DECLARE_BENCHMARK_SAMPLES(ITERATIONS);
+
+static uint32_t workbuf[3 * RSANUMWORDS];
+
+static int verify(const uint8_t *sig, const uint8_t *digest)
+{
+	return rsa_verify(&rsa_key, sig, digest, workbuf);
+}
+
+static int test_good_signatures(void)
+{
+	TEST_ASSERT(verify(sig1, digest1));
+	TEST_ASSERT(verify(sig2, digest2));
+
+	return EC_SUCCESS;
+}
+
+static int test_wrong_digest(void)
+{
+	uint8_t digest[sizeof(digest1)];
+
+	TEST_ASSERT(!verify(sig1, digest2));
+	TEST_ASSERT(!verify(sig2, digest1));
+
+	memcpy(digest, digest1, sizeof(digest));
+	digest[sizeof(digest) - 1] ^= 0x01;
+	TEST_ASSERT(!verify(sig1, digest));
+
+	return EC_SUCCESS;
+}
+
+static int test_corrupt_signature(void)
+{
+	/* Bits in the first, last and some middle bytes */
+	static const int bytes[] = {0, 1, 100, RSANUMBYTES - 1};
+	uint8_t sig[RSANUMBYTES];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(bytes); i++) {
+		memcpy(sig, sig1, sizeof(sig));
+		sig[bytes[i]] ^= 0x10;
+		TEST_ASSERT(!verify(sig, digest1));
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_bad_padding(void)
+{
+	/* A good signature, but the padding is for a SHA-1 digest */
+	TEST_ASSERT(!verify(sig_sha1, digest1));
+
+	return EC_SUCCESS;
+}
+
+static int test_out_of_range(void)
+{
+	uint8_t sig[RSANUMBYTES];
+
+	/* Signatures not less than the modulus */
+	memset(sig, 0xff, sizeof(sig));
+	TEST_ASSERT(!verify(sig, digest1));
+	memcpy(sig, sig1, sizeof(sig));
+	memset(sig, 0xff, 4);
+	TEST_ASSERT(!verify(sig, digest1));
+
+	memset(sig, 0, sizeof(sig));
+	TEST_ASSERT(!verify(sig, digest1));
+
+	return EC_SUCCESS;
+}
+
+static void bench_rsa_verify(void *unused)
+{
+	verify(sig1, digest1);
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_good_signatures);
+	RUN_TEST(test_wrong_digest);
+	RUN_TEST(test_corrupt_signature);
+	RUN_TEST(test_bad_padding);
+	RUN_TEST(test_out_of_range);
+
+	BENCHMARK(bench_rsa_verify, NULL, ITERATIONS);
+
+	test_print_result();
+}
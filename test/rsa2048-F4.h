@@ -0,0 +1,176 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * 2048-bit RSA test key (public exponent 65537) and signatures made with it
+ * by openssl.
+ */
+
+#ifndef __CROS_EC_TEST_RSA2048_F4_H
+#define __CROS_EC_TEST_RSA2048_F4_H
+
+static const struct rsa_public_key rsa_key = {
+	.n = {
+		0xbc450be3, 0xab6a6e7f, 0x5195d781, 0x231e6140,
+		0x8bbb9dd0, 0x8023ec08, 0x561af550, 0x865614c4,
+		0xd9004482, 0x3f89b0a1, 0xd7a237ad, 0x9568b72a,
+		0x496be9f8, 0xf19ba50b, 0x65d2bf6f, 0x7b352de3,
+		0xaa2b646e, 0x205566f2, 0x9c030c6e, 0xe16f2f71,
+		0xc7406294, 0x890d00c3, 0x8f76e8a4, 0x28ba6883,
+		0x124edf99, 0x03a53dea, 0x6f03afa1, 0x7ca2bf1a,
+		0x9ae2a47e, 0xf47ff2d5, 0x14795560, 0x9ff58c03,
+		0xcc1a6cd0, 0x3bb1fba3, 0x6452a3f7, 0xf196b806,
+		0x267f9d05, 0x31a00331, 0x35ae6e4a, 0x3243d22d,
+		0x4ea850b0, 0xebd4b34f, 0x04340642, 0x850ae639,
+		0xa42e6c43, 0xac978173, 0x5677cc77, 0x86190fec,
+		0x36a393ee, 0x9f29fa79, 0x7599eb0c, 0x1fdd1a92,
+		0xdcb9f7d5, 0x08aa286c, 0x00973599, 0x7ce7cf1b,
+		0xf9e771ba, 0xc25399cc, 0xb07ac9a6, 0x6c2c1b94,
+		0x5253b5f4, 0xfa153399, 0x30c19d63, 0xb12c6a61,
+	},
+	.rr = {
+		0xb65b5abf, 0x218a6453, 0x03129f1a, 0x44566fa7,
+		0x5825780a, 0x7fcee683, 0x707c73da, 0x7cb1774b,
+		0xa6935629, 0x043db91b, 0x3c105589, 0x6823381e,
+		0x8ae58a88, 0x5c8c0f46, 0x7ed372b6, 0x5d3d6766,
+		0xb3fbe1a0, 0xa028930d, 0x5491b92a, 0x69e1bef8,
+		0xed0f76b0, 0x5cc15df2, 0x01fde88e, 0x48b639b8,
+		0x55410d78, 0x250dda47, 0xcaf22041, 0xdc15f064,
+		0x2d44e3f1, 0xa1b0ff35, 0x7c7a0204, 0x280d976e,
+		0x28f92aee, 0xf8b611f1, 0xc37f5a2c, 0x8a34d44a,
+		0xbbd646a2, 0xdcc553e8, 0x37270998, 0x6e2b1403,
+		0xd5008279, 0xf38d65ac, 0x31358f21, 0xeec54c75,
+		0x1734b44b, 0x92a8e8b6, 0xf41ece69, 0xd97e3152,
+		0x961c6536, 0xb105c088, 0x44f5afbc, 0x6cddd60f,
+		0xf67f128c, 0x377b6763, 0x3a54c8ca, 0xdcff73e7,
+		0x399bc5e5, 0x36a55b28, 0xb07641e0, 0x8c691355,
+		0x63ae0dfa, 0xa6032a85, 0x35e34090, 0x5e2850e9,
+	},
+	.n0inv = 0x80536e35,
+};
+
+/* SHA-256 of "The quick brown fox jumps over the lazy dog" */
+static const uint8_t digest1[] = {
+	0xd7, 0xa8, 0xfb, 0xb3, 0x07, 0xd7, 0x80, 0x94,
+	0x69, 0xca, 0x9a, 0xbc, 0xb0, 0x08, 0x2e, 0x4f,
+	0x8d, 0x56, 0x51, 0xe4, 0x6d, 0x3c, 0xdb, 0x76,
+	0x2d, 0x02, 0xd0, 0xbf, 0x37, 0xc9, 0xe5, 0x92,
+};
+
+/* SHA-256 of 1000 random bytes */
+static const uint8_t digest2[] = {
+	0x53, 0xc2, 0x74, 0x7e, 0x28, 0x99, 0x31, 0x9d,
+	0x7b, 0xe2, 0x6b, 0x49, 0x57, 0xea, 0x0d, 0x40,
+	0x78, 0x0d, 0x80, 0xfc, 0xce, 0xfa, 0xb8, 0xd7,
+	0x8a, 0xa2, 0x3c, 0x42, 0xeb, 0x41, 0x53, 0xce,
+};
+
+/* SHA256WithRSA signature of digest1 */
+static const uint8_t sig1[] = {
+	0x44, 0x7d, 0x88, 0x93, 0xfd, 0x63, 0x37, 0x09,
+	0x86, 0xc9, 0xac, 0x5a, 0x2e, 0x62, 0x7d, 0x9c,
+	0x98, 0x25, 0x59, 0xd5, 0xc0, 0x67, 0xe7, 0xd3,
+	0x6b, 0x5e, 0x60, 0x59, 0x80, 0xbb, 0xd3, 0x4c,
+	0x83, 0x6b, 0xf8, 0x78, 0x26, 0xf3, 0xf3, 0xad,
+	0x55, 0xcb, 0x10, 0x61, 0x35, 0xd5, 0x54, 0x97,
+	0x00, 0x4c, 0xf3, 0x95, 0xe2, 0xf5, 0x74, 0x96,
+	0xbf, 0xb2, 0x87, 0xa6, 0x81, 0x1b, 0x7a, 0x96,
+	0xbf, 0xa6, 0x36, 0x1c, 0xa2, 0xbc, 0x3e, 0xf6,
+	0x6e, 0xe6, 0x4b, 0xe0, 0x06, 0x6d, 0xe1, 0x29,
+	0xda, 0x67, 0x28, 0xd7, 0x14, 0xb7, 0xab, 0x0c,
+	0xc7, 0x8a, 0x37, 0xd6, 0xe7, 0xf5, 0x8f, 0x38,
+	0x7d, 0xec, 0x72, 0xd3, 0x61, 0x67, 0xad, 0x72,
+	0xf1, 0x29, 0xe6, 0xa4, 0xab, 0xde, 0x69, 0x69,
+	0x12, 0x29, 0xf8, 0x12, 0x7b, 0x05, 0x5b, 0x23,
+	0x3a, 0xda, 0x5e, 0x47, 0xfc, 0x8d, 0x47, 0x6d,
+	0x16, 0xb4, 0x55, 0x89, 0xf2, 0x12, 0xd7, 0xf7,
+	0xf0, 0xef, 0xa6, 0xe5, 0x69, 0x90, 0xab, 0x25,
+	0x66, 0x9b, 0x4f, 0x6d, 0x04, 0xb8, 0x9b, 0x61,
+	0x0b, 0x87, 0xf8, 0x5b, 0xaa, 0x17, 0x77, 0x08,
+	0xd8, 0x02, 0x0f, 0xc0, 0xbd, 0x2b, 0xd7, 0xb0,
+	0x1b, 0xb1, 0x86, 0xae, 0x8a, 0x12, 0x56, 0xe1,
+	0xa0, 0xa7, 0x7e, 0xc1, 0x41, 0x3a, 0xa9, 0xaf,
+	0x55, 0x32, 0x98, 0x94, 0x75, 0x02, 0xcc, 0x28,
+	0xe1, 0x44, 0xf3, 0x37, 0xf4, 0x85, 0xbb, 0x9c,
+	0xb9, 0xaa, 0x08, 0x59, 0x26, 0x5e, 0x4d, 0x9e,
+	0xa6, 0xa8, 0xa4, 0x70, 0x6a, 0xfa, 0x2b, 0xd8,
+	0x52, 0x55, 0x96, 0xc0, 0xfe, 0x45, 0x0e, 0xfc,
+	0x41, 0xbb, 0x95, 0xb6, 0xd7, 0xa1, 0x14, 0xb0,
+	0x63, 0x02, 0x32, 0x61, 0x33, 0x42, 0xa9, 0xd4,
+	0x93, 0x8c, 0x82, 0x70, 0x55, 0x0d, 0xc0, 0x10,
+	0xa0, 0x59, 0x60, 0x60, 0xf2, 0xfa, 0xcc, 0x36,
+};
+
+/* SHA256WithRSA signature of digest2 */
+static const uint8_t sig2[] = {
+	0x65, 0xec, 0xaa, 0x0a, 0x5a, 0xba, 0xbd, 0xc0,
+	0x98, 0x0f, 0x32, 0xe0, 0x3e, 0x21, 0x0a, 0xd4,
+	0x87, 0xa3, 0xbb, 0xc4, 0x15, 0x40, 0xfc, 0x4b,
+	0xba, 0xcd, 0x86, 0x84, 0xfa, 0xdd, 0x4c, 0x7d,
+	0xfe, 0x1c, 0x95, 0xc5, 0xe8, 0x91, 0xbc, 0x42,
+	0x88, 0xc0, 0x9e, 0x7f, 0x94, 0x7d, 0xa2, 0x1f,
+	0x4e, 0x07, 0x46, 0xfe, 0xee, 0x36, 0x17, 0x49,
+	0x21, 0xcc, 0xf2, 0x6a, 0x34, 0x09, 0x12, 0x97,
+	0x50, 0x87, 0xa8, 0xfa, 0xc4, 0x2b, 0x93, 0x0a,
+	0x13, 0xcb, 0x5f, 0x2f, 0xcc, 0x8f, 0x6e, 0xe1,
+	0xaa, 0xbd, 0xe8, 0x21, 0x06, 0x57, 0x84, 0x1d,
+	0x4d, 0x86, 0xda, 0xbb, 0xe3, 0x55, 0x6d, 0xd2,
+	0xbe, 0x4d, 0x02, 0x0a, 0x3a, 0x4b, 0x55, 0x5c,
+	0x38, 0x20, 0x7e, 0x86, 0x38, 0x30, 0xc7, 0x34,
+	0x51, 0x69, 0xeb, 0xf8, 0x2b, 0x45, 0x9a, 0xf6,
+	0x58, 0x93, 0x28, 0x46, 0x9b, 0x09, 0x5b, 0x1f,
+	0x70, 0x62, 0x4a, 0xe1, 0x2f, 0x11, 0xe5, 0xfd,
+	0xf2, 0x12, 0x79, 0xe8, 0x07, 0xfd, 0xf3, 0xe1,
+	0xef, 0x10, 0x65, 0x63, 0x00, 0xf4, 0x9e, 0x50,
+	0x3c, 0x0d, 0x98, 0x25, 0xd8, 0xe0, 0x4e, 0xbe,
+	0x50, 0x25, 0x08, 0x33, 0x33, 0xbb, 0xe2, 0xd1,
+	0xf7, 0x0e, 0xe2, 0x22, 0xa0, 0xc4, 0xfa, 0x1d,
+	0x52, 0xad, 0x86, 0xe3, 0xb7, 0x96, 0x8b, 0x0e,
+	0x5d, 0xd7, 0xec, 0xf7, 0xe7, 0x18, 0x38, 0x67,
+	0xc3, 0xa7, 0x71, 0x4b, 0x35, 0xd5, 0x50, 0x33,
+	0xc3, 0x97, 0xa2, 0x85, 0x29, 0xdd, 0x6b, 0xbe,
+	0x24, 0x51, 0xd1, 0x9d, 0x2e, 0x07, 0x30, 0xc8,
+	0x9a, 0x50, 0x25, 0xc1, 0x29, 0x8a, 0xfd, 0x98,
+	0xd9, 0x03, 0x45, 0x9a, 0xc3, 0xfc, 0xe2, 0xfa,
+	0xc4, 0x29, 0x4a, 0x6c, 0x69, 0xdd, 0xd1, 0x22,
+	0x63, 0x9e, 0xba, 0x13, 0xd2, 0x86, 0xe4, 0x73,
+	0xb8, 0xe4, 0x99, 0x4b, 0x09, 0xde, 0x95, 0x8c,
+};
+
+/* SHA1WithRSA signature of the same text as digest1 */
+static const uint8_t sig_sha1[] = {
+	0x80, 0x5a, 0xf9, 0x5d, 0xf9, 0xb0, 0xdd, 0x59,
+	0xa1, 0x79, 0x6d, 0xab, 0x89, 0xc3, 0x50, 0xb1,
+	0x1c, 0x4b, 0xc1, 0xfa, 0x3d, 0x42, 0x66, 0xcc,
+	0xcb, 0xd4, 0x0d, 0x33, 0x6e, 0xd3, 0x9b, 0x57,
+	0x75, 0x74, 0x27, 0x9e, 0xbe, 0x41, 0xb2, 0x3d,
+	0x90, 0xfa, 0xd4, 0x08, 0xac, 0x77, 0x07, 0xbc,
+	0xd7, 0x40, 0x84, 0x09, 0x74, 0x27, 0xea, 0xd7,
+	0xeb, 0xf0, 0x60, 0xa2, 0xdf, 0x76, 0x44, 0x76,
+	0x10, 0xcb, 0x39, 0xda, 0x62, 0x08, 0x74, 0xce,
+	0xbd, 0xaa, 0xf3, 0x91, 0x65, 0x88, 0x09, 0x3c,
+	0x89, 0xb9, 0xea, 0x1f, 0x9f, 0x0b, 0xab, 0x37,
+	0x70, 0xd3, 0x1f, 0xc0, 0x66, 0x94, 0x50, 0x0e,
+	0x07, 0x20, 0x92, 0x91, 0x67, 0xbe, 0xfa, 0x6a,
+	0xaa, 0x15, 0x47, 0xec, 0xd6, 0x1b, 0xed, 0x75,
+	0xb9, 0xaf, 0x0c, 0xfe, 0x13, 0xe3, 0x6c, 0x7a,
+	0x59, 0xaf, 0x5a, 0xd1, 0xb7, 0x28, 0x42, 0x0e,
+	0xf6, 0xbd, 0xcc, 0x79, 0x0a, 0x12, 0x33, 0xcd,
+	0x31, 0xaa, 0xfa, 0x33, 0x08, 0x13, 0x62, 0xe5,
+	0x71, 0x8f, 0x1b, 0x2f, 0xe0, 0x8f, 0xce, 0xf0,
+	0x9f, 0x4c, 0xd1, 0xa3, 0x02, 0x38, 0xb4, 0xda,
+	0x3c, 0xac, 0xe7, 0xf8, 0x77, 0x0a, 0x5f, 0xbf,
+	0xb3, 0xb1, 0x51, 0xb8, 0x9d, 0x47, 0x2f, 0x31,
+	0x3b, 0xb8, 0x37, 0x50, 0xb6, 0x46, 0xe6, 0x82,
+	0xc6, 0x68, 0x77, 0x88, 0x01, 0xe3, 0xc2, 0xc5,
+	0xf5, 0x8d, 0x6d, 0x9c, 0x6b, 0xc2, 0x00, 0xa5,
+	0x5c, 0x79, 0x99, 0x3b, 0x2a, 0xcc, 0xd8, 0xda,
+	0xe1, 0x40, 0xe9, 0xcf, 0xa7, 0x76, 0x20, 0xe3,
+	0xfc, 0xd7, 0xc5, 0xe5, 0xa7, 0x84, 0xe8, 0xc0,
+	0x4a, 0x71, 0x6f, 0x92, 0x5e, 0x24, 0xed, 0xf7,
+	0x4e, 0x5e, 0x4e, 0x5e, 0xb8, 0x1f, 0xc1, 0x02,
+	0xdf, 0x61, 0x21, 0xba, 0x72, 0x2f, 0x70, 0xfe,
+	0x2e, 0x86, 0x24, 0xf9, 0x69, 0x2e, 0x02, 0x04,
+};
+
+#endif /* __CROS_EC_TEST_RSA2048_F4_H */
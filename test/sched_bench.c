@@ -0,0 +1,75 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Context switch benchmark.  Two tasks wake each other in turn, and the
+ * rate of switches between them is reported.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define ROUNDS 20000
+
+static int rounds_a;
+static int rounds_b;
+
+int task_ping(void *data)
+{
+	while (1) {
+		task_wait_event(-1);
+		rounds_a++;
+		task_set_event(TASK_ID_PONG, TASK_EVENT_WAKE, 0);
+	}
+
+	return EC_SUCCESS;
+}
+
+int task_pong(void *data)
+{
+	while (1) {
+		task_wait_event(-1);
+		rounds_b++;
+		if (rounds_b < ROUNDS)
+			task_set_event(TASK_ID_PING, TASK_EVENT_WAKE, 0);
+		else
+			task_wake(TASK_ID_TEST_RUNNER);
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_switch_rate(void)
+{
+	timestamp_t start;
+	uint64_t elapsed;
+
+	start = get_time();
+	task_wake(TASK_ID_PING);
+	task_wait_event_mask(TASK_EVENT_WAKE, -1);
+	elapsed = get_time().val - start.val;
+
+	TEST_ASSERT(rounds_a == ROUNDS);
+	TEST_ASSERT(rounds_b == ROUNDS);
+
+	/* Each round switches to ping and then to pong */
+	ccprintf("Benchmark: context_switch count=%d total_us=%ld "
+		 "per_second=%ld\n", 2 * ROUNDS, elapsed,
+		 elapsed ? 2ull * ROUNDS * SECOND / elapsed : 0);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_switch_rate);
+
+	test_print_result();
+}
@@ -0,0 +1,136 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for SHA-256.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "util.h"
+
+/* FIPS 180-2 examples */
+static const uint8_t digest_empty[SHA256_DIGEST_SIZE] = {
+	0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+	0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+	0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+	0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55,
+};
+
+static const uint8_t digest_abc[SHA256_DIGEST_SIZE] = {
+	0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+	0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+	0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+	0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad,
+};
+
+static const uint8_t digest_two_blocks[SHA256_DIGEST_SIZE] = {
+	0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+	0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+	0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+	0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1,
+};
+
+static const uint8_t digest_million_a[SHA256_DIGEST_SIZE] = {
+	0xcd, 0xc7, 0x6e, 0x5c, 0x99, 0x14, 0xfb, 0x92,
+	0x81, 0xa1, 0xc7, 0xe2, 0x84, 0xd7, 0x3e, 0x67,
+	0xf1, 0x80, 0x9a, 0x48, 0xa4, 0x97, 0x20, 0x0e,
+	0x04, 0x6d, 0x39, 0xcc, 0xc7, 0x11, 0x2c, 0xd0,
+};
+
+/* Word aligned, so both the aligned and unaligned paths can be tried */
+static uint32_t data_words[1024 / 4 + 1];
+
+static uint8_t *hash(const void *data, int len)
+{
+	static struct sha256_ctx ctx;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, data, len);
+	return SHA256_final(&ctx);
+}
+
+static int test_fips_examples(void)
+{
+	const char *two_blocks =
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+
+	uint8_t *digest;
+
+	digest = hash("", 0);
+	TEST_ASSERT_ARRAY_EQ(digest, digest_empty, SHA256_DIGEST_SIZE);
+	digest = hash("abc", 3);
+	TEST_ASSERT_ARRAY_EQ(digest, digest_abc, SHA256_DIGEST_SIZE);
+	digest = hash(two_blocks, strlen(two_blocks));
+	TEST_ASSERT_ARRAY_EQ(digest, digest_two_blocks, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_million_a(void)
+{
+	struct sha256_ctx ctx;
+	uint8_t *a = (uint8_t *)data_words;
+	uint8_t *digest;
+	int i;
+
+	memset(a, 'a', 1000);
+
+	SHA256_init(&ctx);
+	for (i = 0; i < 1000; i++)
+		SHA256_update(&ctx, a, 1000);
+	digest = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(digest, digest_million_a, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_chunks(void)
+{
+	/* Chunk sizes which hit partial, whole and straddled blocks */
+	static const int chunks[] = {1, 63, 64, 65, 3, 128, 200, 0, 7};
+	uint8_t expected[SHA256_DIGEST_SIZE];
+	struct sha256_ctx ctx;
+	uint8_t *data = (uint8_t *)data_words;
+	uint8_t *digest;
+	int len, offset, i, pos;
+
+	for (i = 0; i < sizeof(data_words); i++)
+		data[i] = prng_no_seed();
+
+	for (offset = 0; offset < 4; offset++) {
+		for (len = 0; len <= 1024; len += 61) {
+			memcpy(expected, hash(data, len), sizeof(expected));
+
+			/* Same data at another alignment, in pieces */
+			memmove(data + offset, data, len);
+			SHA256_init(&ctx);
+			for (pos = 0, i = 0; pos < len; i++) {
+				int n = MIN(chunks[i % ARRAY_SIZE(chunks)],
+					    len - pos);
+
+				SHA256_update(&ctx, data + offset + pos, n);
+				pos += n;
+			}
+			digest = SHA256_final(&ctx);
+			TEST_ASSERT_ARRAY_EQ(digest, expected,
+					     SHA256_DIGEST_SIZE);
+			memmove(data, data + offset, len);
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_fips_examples);
+	RUN_TEST(test_million_a);
+	RUN_TEST(test_chunks);
+
+	test_print_result();
+}
@@ -0,0 +1,168 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests and benchmarks for the SPI flash driver, on the emulated SPI flash.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "gpio.h"
+#include "spi.h"
+#include "spi_flash.h"
+#include "test_util.h"
+#include "util.h"
+
+#define ITERATIONS 10
+
+DECLARE_BENCHMARK_SAMPLES(ITERATIONS);
+
+/* Size of the benchmark reads */
+#define BENCH_READ_SIZE 0x8000
+
+/* The emulated SPI master has no chip select GPIO */
+const struct spi_device_t spi_devices[] = {
+	{ CONFIG_SPI_FLASH_PORT, 0, GPIO_COUNT },
+};
+const unsigned int spi_devices_used = ARRAY_SIZE(spi_devices);
+
+static uint8_t data[BENCH_READ_SIZE];
+static uint8_t readback[BENCH_READ_SIZE];
+
+static int test_read_write(void)
+{
+	const struct spi_flash_emu_stats *stats = spi_flash_emu_get_stats();
+	/* Starts part way into a page, and ends part way into another */
+	const int offset = 0x10000 + 37;
+	const int size = 3000;
+	int i;
+
+	for (i = 0; i < size; i++)
+		data[i] = prng_no_seed();
+
+	spi_flash_emu_clear_stats();
+	TEST_ASSERT(spi_flash_erase(0x10000, 0x1000) == EC_SUCCESS);
+	TEST_ASSERT(stats->erases == 1);
+
+	TEST_ASSERT(spi_flash_write(offset, size, data) == EC_SUCCESS);
+	TEST_ASSERT(stats->programs ==
+		    (offset + size - 1) / SPI_FLASH_MAX_WRITE_SIZE -
+		    offset / SPI_FLASH_MAX_WRITE_SIZE + 1);
+
+	TEST_ASSERT(spi_flash_read(readback, offset, size) == EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(readback, data, size);
+
+	/* Bytes around the data stay erased */
+	TEST_ASSERT(spi_flash_read(readback, offset - 1, 1) == EC_SUCCESS);
+	TEST_ASSERT(readback[0] == 0xff);
+	TEST_ASSERT(spi_flash_read(readback, offset + size, 1) == EC_SUCCESS);
+	TEST_ASSERT(readback[0] == 0xff);
+
+	/* The driver waited for each program and erase to finish */
+	TEST_ASSERT(stats->ignored == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_read_chunks(void)
+{
+	const struct spi_flash_emu_stats *stats = spi_flash_emu_get_stats();
+	const int size = 2 * CONFIG_SPI_FLASH_READ_CHUNK_SIZE + 1;
+
+	spi_flash_emu_clear_stats();
+	TEST_ASSERT(spi_flash_read(readback, 0, size) == EC_SUCCESS);
+	TEST_ASSERT(stats->transactions == 3);
+	TEST_ASSERT(stats->fast_reads == 3);
+	TEST_ASSERT(stats->reads == 0);
+
+	/* Nothing to read */
+	TEST_ASSERT(spi_flash_read(readback, 0, 0) == EC_SUCCESS);
+	TEST_ASSERT(stats->transactions == 3);
+
+	/* Past the end of the part */
+	TEST_ASSERT(spi_flash_read(readback, CONFIG_FLASH_SIZE - 1, 2) ==
+		    EC_ERROR_INVAL);
+	TEST_ASSERT(stats->transactions == 3);
+
+	return EC_SUCCESS;
+}
+
+static int test_erase(void)
+{
+	const struct spi_flash_emu_stats *stats = spi_flash_emu_get_stats();
+	int i;
+
+	memset(data, 0, SPI_FLASH_MAX_WRITE_SIZE);
+	for (i = 0; i < 0x9000; i += 0x1000)
+		TEST_ASSERT(spi_flash_write(0x8000 + i, SPI_FLASH_MAX_WRITE_SIZE,
+					    data) == EC_SUCCESS);
+
+	/* One 32 KB block, then one 4 KB sector */
+	spi_flash_emu_clear_stats();
+	TEST_ASSERT(spi_flash_erase(0x8000, 0x9000) == EC_SUCCESS);
+	TEST_ASSERT(stats->erases == 2);
+	for (i = 0; i < 0x9000; i += 0x1000) {
+		TEST_ASSERT(spi_flash_read(readback, 0x8000 + i,
+					   SPI_FLASH_MAX_WRITE_SIZE) ==
+			    EC_SUCCESS);
+		TEST_ASSERT_MEMSET(readback, 0xff, SPI_FLASH_MAX_WRITE_SIZE);
+	}
+
+	TEST_ASSERT(spi_flash_erase(0x8000, 0x800) == EC_ERROR_INVAL);
+	TEST_ASSERT(stats->ignored == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_jedec_id(void)
+{
+	uint32_t id = spi_flash_get_jedec_id();
+
+	TEST_ASSERT(((uint8_t *)&id)[0] == 0xef);
+	TEST_ASSERT(SPI_FLASH_SIZE(((uint8_t *)&id)[2]) == CONFIG_FLASH_SIZE);
+
+	return EC_SUCCESS;
+}
+
+/* Reads as the driver used to: Read Data, a flash page per transaction */
+static void bench_read_data_pages(void *unused)
+{
+	uint8_t cmd[4] = {SPI_FLASH_READ};
+	int offset;
+
+	for (offset = 0; offset < BENCH_READ_SIZE;
+	     offset += SPI_FLASH_MAX_READ_SIZE) {
+		cmd[1] = offset >> 16;
+		cmd[2] = offset >> 8;
+		cmd[3] = offset;
+		spi_transaction(SPI_FLASH_DEVICE, cmd, sizeof(cmd),
+				readback + offset, SPI_FLASH_MAX_READ_SIZE);
+	}
+}
+
+static void bench_spi_flash_read(void *unused)
+{
+	spi_flash_read(readback, 0, BENCH_READ_SIZE);
+}
+
+static void bench_spi_flash_write(void *unused)
+{
+	spi_flash_erase(0, 0x1000);
+	spi_flash_write(0, 0x1000, data);
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_read_write);
+	RUN_TEST(test_read_chunks);
+	RUN_TEST(test_erase);
+	RUN_TEST(test_jedec_id);
+
+	BENCHMARK(bench_read_data_pages, NULL, ITERATIONS);
+	BENCHMARK(bench_spi_flash_read, NULL, ITERATIONS);
+	BENCHMARK(bench_spi_flash_write, NULL, ITERATIONS);
+
+	test_print_result();
+}
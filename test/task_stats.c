@@ -0,0 +1,114 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for per-task CPU accounting.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* How long the busy task runs each time it is woken */
+#define BUSY_TIME (5 * MSEC)
+
+int task_busy(void *data)
+{
+	while (1) {
+		task_wait_event(-1);
+		udelay(BUSY_TIME);
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_busy_task(void)
+{
+	struct task_stats before, after;
+	int i;
+
+	/* Let the busy task start up and block */
+	task_wake(TASK_ID_BUSY);
+	msleep(20);
+
+	TEST_ASSERT(task_get_stats(TASK_ID_BUSY, &before) == EC_SUCCESS);
+
+	for (i = 0; i < 3; i++) {
+		task_wake(TASK_ID_BUSY);
+		msleep(20);
+	}
+
+	TEST_ASSERT(task_get_stats(TASK_ID_BUSY, &after) == EC_SUCCESS);
+	TEST_ASSERT(after.switches >= before.switches + 3);
+	TEST_ASSERT(after.runtime >= before.runtime + 3 * BUSY_TIME);
+	TEST_ASSERT(after.max_run >= BUSY_TIME);
+	TEST_ASSERT(after.max_run <= after.runtime);
+
+	TEST_ASSERT(task_get_stats(TASK_ID_COUNT, &after) == EC_ERROR_INVAL);
+
+	return EC_SUCCESS;
+}
+
+static int test_host_command(void)
+{
+	struct ec_params_task_stats p;
+	uint8_t buf[sizeof(struct ec_response_task_stats) +
+		    2 * sizeof(struct ec_task_stats)];
+	struct ec_response_task_stats *r = (struct ec_response_task_stats *)buf;
+	struct ec_task_stats *stats = (struct ec_task_stats *)(r + 1);
+	char name[EC_TASK_NAME_SIZE];
+	int seen = 0;
+	int i;
+
+	/* The response only has room for two tasks, so it must be paged */
+	p.first = 0;
+	do {
+		TEST_ASSERT(test_send_host_command(EC_CMD_TASK_STATS, 0,
+						   &p, sizeof(p),
+						   buf, sizeof(buf)) ==
+			    EC_RES_SUCCESS);
+		TEST_ASSERT(r->task_count == TASK_ID_COUNT);
+		TEST_ASSERT(r->count >= 1 && r->count <= 2);
+
+		for (i = 0; i < r->count; i++) {
+			memset(name, 0, sizeof(name));
+			strzcpy(name, task_get_name(p.first + i),
+				sizeof(name));
+			TEST_ASSERT(!memcmp(stats[i].name, name,
+					    sizeof(name)));
+			TEST_ASSERT(stats[i].max_run <= stats[i].runtime);
+			if (p.first + i == TASK_ID_BUSY)
+				TEST_ASSERT(stats[i].switches > 0);
+		}
+		seen += r->count;
+		p.first += r->count;
+	} while (p.first < r->task_count);
+	TEST_ASSERT(seen == TASK_ID_COUNT);
+
+	/* Asking for tasks past the end returns none */
+	p.first = TASK_ID_COUNT;
+	TEST_ASSERT(test_send_host_command(EC_CMD_TASK_STATS, 0, &p, sizeof(p),
+					   buf, sizeof(buf)) == EC_RES_SUCCESS);
+	TEST_ASSERT(r->count == 0);
+
+	p.first = TASK_ID_COUNT + 1;
+	TEST_ASSERT(test_send_host_command(EC_CMD_TASK_STATS, 0, &p, sizeof(p),
+					   buf, sizeof(buf)) ==
+		    EC_RES_INVALID_PARAM);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_busy_task);
+	RUN_TEST(test_host_command);
+
+	test_print_result();
+}
@@ -16,6 +16,12 @@
 /* Don't compile PD logging unless specifically testing for it */
 #undef CONFIG_USB_PD_LOGGING
 
+#ifdef TEST_BENCHMARK
+#define CONFIG_MATH_UTIL
+#define CONFIG_SHA256
+#define CONFIG_SW_CRC
+#endif
+
 #ifdef TEST_BKLIGHT_LID
 #define CONFIG_BACKLIGHT_LID
 #endif
@@ -25,6 +31,18 @@
 #define CONFIG_BACKLIGHT_REQ_GPIO GPIO_PCH_BKLTEN
 #endif
 
+#ifdef TEST_CONSOLE_TOKENS
+#define CONFIG_CONSOLE_TOKENIZED
+#endif
+
+#ifdef TEST_CRC32
+#define CONFIG_SW_CRC
+#endif
+
+#ifdef TEST_HOOKS
+#define CONFIG_HOOK_DEBUG
+#endif
+
 #ifdef TEST_KB_8042
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #endif
@@ -48,6 +66,10 @@
 #define CONFIG_LID_ANGLE_SENSOR_LID 1
 #endif
 
+#ifdef TEST_RSA
+#define CONFIG_RSA
+#endif
+
 #ifdef TEST_SBS_CHARGING
 #define CONFIG_BATTERY_MOCK
 #define CONFIG_BATTERY_SMART
@@ -81,6 +103,11 @@ int board_discharge_on_ac(int enabled);
 #define I2C_PORT_CHARGER 0
 #endif
 
+#ifdef TEST_SHA256
+#define CONFIG_SHA256
+#define CONFIG_SHA256_UNROLL
+#endif
+
 #ifdef TEST_THERMAL
 #define CONFIG_CHIPSET_CAN_THROTTLE
 #define CONFIG_FANS 1
@@ -92,6 +119,27 @@ int board_discharge_on_ac(int enabled);
 int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
+#ifdef TEST_TRACE
+#define CONFIG_TRACE
+#endif
+
+#ifdef TEST_FLASH
+#define CONFIG_FLASH_HASH
+#define CONFIG_SHA256
+#endif
+
+#ifdef TEST_SPI_FLASH
+#define CONFIG_SPI_FLASH
+#define CONFIG_SPI_FLASH_FAST_READ
+#define CONFIG_SPI_FLASH_PORT 0
+#define CONFIG_SPI_FLASH_W25X40
+#define CONFIG_SPI_MASTER
+#endif
+
+#ifdef TEST_VBOOT_HASH
+#define CONFIG_VBOOT_HASH
+#endif
+
 #ifdef TEST_FAN
 #define CONFIG_FANS 1
 #endif
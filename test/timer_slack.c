@@ -0,0 +1,106 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for timer slack and wakeup coalescing.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Timeout and slack for the slack task */
+static int slack_timeout;
+static int slack_slack;
+
+/* When the slack task last woke up */
+static timestamp_t slack_wake;
+
+int task_slack(void *data)
+{
+	while (1) {
+		task_wait_event(-1);
+		task_wait_event_slack(slack_timeout, slack_slack);
+		slack_wake = get_time();
+	}
+
+	return EC_SUCCESS;
+}
+
+/* Start the slack task waiting, and return when it started */
+static timestamp_t start_slack(int timeout_us, int slack_us)
+{
+	timestamp_t start;
+
+	slack_timeout = timeout_us;
+	slack_slack = slack_us;
+	slack_wake.val = 0;
+	start = get_time();
+	task_wake(TASK_ID_SLACK);
+	return start;
+}
+
+static int test_window(void)
+{
+	uint32_t wakeups = timer_get_wakeups(TASK_ID_SLACK);
+	timestamp_t start = start_slack(20 * MSEC, 30 * MSEC);
+
+	usleep(200 * MSEC);
+
+	TEST_ASSERT(slack_wake.val);
+	TEST_ASSERT(slack_wake.val - start.val >= 20 * MSEC);
+	/* No later than the end of the window, give or take scheduling */
+	TEST_ASSERT(slack_wake.val - start.val <= (20 + 30 + 5) * MSEC);
+	TEST_ASSERT(timer_get_wakeups(TASK_ID_SLACK) == wakeups + 1);
+
+	return EC_SUCCESS;
+}
+
+static int test_coalesce(void)
+{
+	timestamp_t start = start_slack(100 * MSEC, 100 * MSEC);
+	timestamp_t now;
+
+	/*
+	 * Our timer expires inside the slack task's window, so the slack
+	 * task should wake up along with us instead of 50ms earlier.
+	 */
+	usleep(150 * MSEC);
+	now = get_time();
+	msleep(1);
+
+	TEST_ASSERT(slack_wake.val);
+	TEST_ASSERT(slack_wake.val - start.val >= 100 * MSEC);
+	TEST_ASSERT(slack_wake.val + 10 * MSEC > now.val);
+
+	return EC_SUCCESS;
+}
+
+static int test_no_overlap(void)
+{
+	timestamp_t start = start_slack(10 * MSEC, 10 * MSEC);
+
+	/* Windows don't overlap, so the slack task can't wait for us */
+	usleep(100 * MSEC);
+
+	TEST_ASSERT(slack_wake.val);
+	TEST_ASSERT(slack_wake.val - start.val >= 10 * MSEC);
+	TEST_ASSERT(slack_wake.val - start.val < 90 * MSEC);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_window);
+	RUN_TEST(test_coalesce);
+	RUN_TEST(test_no_overlap);
+
+	test_print_result();
+}
@@ -0,0 +1,208 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for event tracing.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "trace.h"
+#include "util.h"
+
+#define BUF_EVENTS CONFIG_TRACE_BUF_EVENTS
+
+/* Events read by the last drain() */
+static struct ec_trace_event events[BUF_EVENTS];
+static int event_count;
+static uint32_t dropped;
+
+/*
+ * Read the whole trace buffer.  Uses a small response buffer, so reading
+ * takes several host commands.
+ */
+static int drain(void)
+{
+	uint8_t buf[sizeof(struct ec_response_trace_read) +
+		    16 * sizeof(struct ec_trace_event)];
+	struct ec_response_trace_read *r = (struct ec_response_trace_read *)buf;
+	struct ec_trace_event *e = (struct ec_trace_event *)(r + 1);
+	int size;
+
+	event_count = 0;
+	dropped = 0;
+	while (1) {
+		/*
+		 * The response size isn't returned to tests, so fill the
+		 * buffer with an impossible event type to find the end.
+		 */
+		memset(buf, 0xff, sizeof(buf));
+		if (test_send_host_command(EC_CMD_TRACE_READ, 0, NULL, 0,
+					   buf, sizeof(buf)) != EC_RES_SUCCESS)
+			return EC_ERROR_UNKNOWN;
+		dropped += r->dropped;
+
+		for (size = 0; size < 16 && e[size].type != 0xff; size++) {
+			if (event_count < BUF_EVENTS)
+				events[event_count++] = e[size];
+		}
+		if (!size)
+			return EC_SUCCESS;
+	}
+}
+
+/* Find an event at or after index 'from'; returns its index, or -1 */
+static int find(int from, uint16_t id, uint8_t type, uint32_t arg)
+{
+	int i;
+
+	for (i = from; i < event_count; i++) {
+		if (events[i].id == id &&
+		    (events[i].type & ~EC_TRACE_FLAG_ISR) == type &&
+		    events[i].arg == arg)
+			return i;
+	}
+	return -1;
+}
+
+static int deferred_calls;
+
+static void deferred_func(void)
+{
+	deferred_calls++;
+}
+DECLARE_DEFERRED(deferred_func);
+
+static int test_user_events(void)
+{
+	int i, j, k;
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+
+	TRACE_BEGIN(EC_TRACE_ID_USER + 1, 5);
+	TRACE_INSTANT(EC_TRACE_ID_USER + 2, 6);
+	TRACE_END(EC_TRACE_ID_USER + 1, 7);
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	i = find(0, EC_TRACE_ID_USER + 1, EC_TRACE_BEGIN, 5);
+	TEST_ASSERT(i >= 0);
+	j = find(i, EC_TRACE_ID_USER + 2, EC_TRACE_INSTANT, 6);
+	TEST_ASSERT(j > i);
+	k = find(j, EC_TRACE_ID_USER + 1, EC_TRACE_END, 7);
+	TEST_ASSERT(k > j);
+	TEST_ASSERT(events[i].task == task_get_current());
+	TEST_ASSERT(!(events[i].type & EC_TRACE_FLAG_ISR));
+	TEST_ASSERT(events[k].timestamp - events[i].timestamp < SECOND);
+	TEST_ASSERT(events[j].timestamp - events[i].timestamp <=
+		    events[k].timestamp - events[i].timestamp);
+
+	/* The buffer is empty after a drain */
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	TEST_ASSERT(event_count == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_deferred(void)
+{
+	uint32_t routine = (uint32_t)(uintptr_t)deferred_func;
+	int i, j;
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	deferred_calls = 0;
+	hook_call_deferred(deferred_func, 0);
+	msleep(50);
+	TEST_ASSERT(deferred_calls == 1);
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	i = find(0, EC_TRACE_ID_DEFERRED, EC_TRACE_BEGIN, routine);
+	TEST_ASSERT(i >= 0);
+	j = find(i, EC_TRACE_ID_DEFERRED, EC_TRACE_END, routine);
+	TEST_ASSERT(j > i);
+	TEST_ASSERT(events[i].task == TASK_ID_HOOKS);
+
+	/* The hook task was switched to before it ran the call */
+	j = find(0, EC_TRACE_ID_TASK_SWITCH, EC_TRACE_INSTANT, TASK_ID_HOOKS);
+	TEST_ASSERT(j >= 0 && j < i);
+
+	return EC_SUCCESS;
+}
+
+static int test_host_command(void)
+{
+	struct ec_params_hello p = { .in_data = 1 };
+	struct ec_response_hello r;
+	int i, j;
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	TEST_ASSERT(test_send_host_command(EC_CMD_HELLO, 0, &p, sizeof(p),
+					   &r, sizeof(r)) == EC_RES_SUCCESS);
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	i = find(0, EC_TRACE_ID_HOST_CMD, EC_TRACE_BEGIN, EC_CMD_HELLO);
+	TEST_ASSERT(i >= 0);
+	j = find(i, EC_TRACE_ID_HOST_CMD, EC_TRACE_END, EC_RES_SUCCESS);
+	TEST_ASSERT(j > i);
+
+	/* Reading the trace doesn't add to it */
+	TEST_ASSERT(find(0, EC_TRACE_ID_HOST_CMD, EC_TRACE_BEGIN,
+			 EC_CMD_TRACE_READ) < 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_overflow(void)
+{
+	int i;
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+
+	for (i = 0; i < BUF_EVENTS + 10; i++)
+		TRACE_INSTANT(EC_TRACE_ID_USER, i);
+
+	/* The oldest events were dropped, and the newest kept */
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	TEST_ASSERT(dropped >= 10);
+	TEST_ASSERT(event_count == BUF_EVENTS);
+	TEST_ASSERT(find(0, EC_TRACE_ID_USER, EC_TRACE_INSTANT, 9) < 0);
+	TEST_ASSERT(find(0, EC_TRACE_ID_USER, EC_TRACE_INSTANT,
+			 BUF_EVENTS + 9) >= 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_console(void)
+{
+	TEST_ASSERT(drain() == EC_SUCCESS);
+
+	UART_INJECT("trace off\n");
+	msleep(30);
+	TRACE_INSTANT(EC_TRACE_ID_USER, 1);
+	UART_INJECT("trace on\n");
+	msleep(30);
+	TRACE_INSTANT(EC_TRACE_ID_USER, 2);
+
+	TEST_ASSERT(drain() == EC_SUCCESS);
+	TEST_ASSERT(find(0, EC_TRACE_ID_USER, EC_TRACE_INSTANT, 1) < 0);
+	TEST_ASSERT(find(0, EC_TRACE_ID_USER, EC_TRACE_INSTANT, 2) >= 0);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_user_events);
+	RUN_TEST(test_deferred);
+	RUN_TEST(test_host_command);
+	RUN_TEST(test_overflow);
+	RUN_TEST(test_console);
+
+	test_print_result();
+}
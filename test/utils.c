@@ -7,10 +7,12 @@
 
 #include "common.h"
 #include "console.h"
+#include "printf.h"
 #include "shared_mem.h"
 #include "system.h"
 #include "test_util.h"
 #include "timer.h"
+#include "uart.h"
 #include "util.h"
 
 static int test_isalpha(void)
@@ -275,6 +277,45 @@ static int test_atoi(void)
 		   (atoi("\t111") == 111));
 }
 
+static int test_snprintf(void)
+{
+	char buf[32];
+
+	TEST_ASSERT(snprintf(buf, sizeof(buf), "ab%dcd%%ef", 12) ==
+		    EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(buf, "ab12cd%ef", 10);
+	snprintf(buf, sizeof(buf), "[%5s|%-4d|%04x]", "xy", 7, 0xa);
+	TEST_ASSERT_ARRAY_EQ(buf, "[   xy|7   |000a]", 18);
+	snprintf(buf, sizeof(buf), "%.3s%.3d", "abcdef", 1234);
+	TEST_ASSERT_ARRAY_EQ(buf, "abc1.234", 9);
+
+	/* Truncation in a literal run and in a field */
+	TEST_ASSERT(snprintf(buf, 6, "abcdefgh") == EC_ERROR_OVERFLOW);
+	TEST_ASSERT_ARRAY_EQ(buf, "abcde", 6);
+	TEST_ASSERT(snprintf(buf, 6, "ab%s", "cdefgh") == EC_ERROR_OVERFLOW);
+	TEST_ASSERT_ARRAY_EQ(buf, "abcde", 6);
+
+	return EC_SUCCESS;
+}
+
+static int test_uart_put(void)
+{
+	const char *out;
+
+	cflush();
+	test_capture_console(1);
+	uart_put("ab\ncd\n\nef", 6);
+	uart_puts("gh\n");
+	uart_printf("i%dj\nk\n", 5);
+	cflush();
+	test_capture_console(0);
+
+	out = test_get_captured_console();
+	TEST_ASSERT_ARRAY_EQ(out, "ab\r\ncd\r\ngh\r\ni5j\r\nk\r\n", 20);
+
+	return EC_SUCCESS;
+}
+
 static int test_uint64divmod_0(void)
 {
 	uint64_t n = 8567106442584750ULL;
@@ -458,6 +499,8 @@ void run_test(void)
 	RUN_TEST(test_strcasecmp);
 	RUN_TEST(test_strncasecmp);
 	RUN_TEST(test_atoi);
+	RUN_TEST(test_snprintf);
+	RUN_TEST(test_uart_put);
 	RUN_TEST(test_uint64divmod_0);
 	RUN_TEST(test_uint64divmod_1);
 	RUN_TEST(test_uint64divmod_2);
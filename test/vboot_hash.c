@@ -0,0 +1,190 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Tests for vboot hashing and its result cache.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "flash.h"
+#include "sha256.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+#include "vboot_hash.h"
+
+/* Region to hash; several chunks long */
+#define HASH_OFFSET 0x18000
+#define HASH_SIZE 0x4000
+
+static uint8_t data[HASH_SIZE];
+static uint8_t expected[SHA256_DIGEST_SIZE];
+static struct ec_response_vboot_hash response;
+
+static int send_hash_command(int cmd, int nonce_size)
+{
+	struct ec_params_vboot_hash params;
+
+	memset(&params, 0, sizeof(params));
+	params.cmd = cmd;
+	params.hash_type = EC_VBOOT_HASH_TYPE_SHA256;
+	params.nonce_size = nonce_size;
+	params.offset = HASH_OFFSET;
+	params.size = HASH_SIZE;
+	memset(params.nonce_data, 0xa5, nonce_size);
+
+	memset(&response, 0, sizeof(response));
+	return test_send_host_command(EC_CMD_VBOOT_HASH, 0, &params,
+				      sizeof(params), &response,
+				      sizeof(response));
+}
+
+/* Wait for a hash to finish, and return its status */
+static int wait_for_hash(void)
+{
+	while (vboot_hash_in_progress())
+		msleep(1);
+
+	send_hash_command(EC_VBOOT_HASH_GET, 0);
+	return response.status;
+}
+
+/* Hash the test region directly, with an optional nonce */
+static void compute_expected(int nonce_size)
+{
+	struct sha256_ctx ctx;
+	uint8_t nonce[64];
+
+	memset(nonce, 0xa5, sizeof(nonce));
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, nonce, nonce_size);
+	SHA256_update(&ctx, (const uint8_t *)__host_flash + HASH_OFFSET,
+		      HASH_SIZE);
+	memcpy(expected, SHA256_final(&ctx), sizeof(expected));
+}
+
+static int fill_region(void)
+{
+	int i;
+
+	for (i = 0; i < HASH_SIZE; i++)
+		data[i] = prng_no_seed();
+
+	if (flash_erase(HASH_OFFSET, HASH_SIZE) != EC_SUCCESS ||
+	    flash_write(HASH_OFFSET, HASH_SIZE, (const char *)data) !=
+	    EC_SUCCESS)
+		return EC_ERROR_UNKNOWN;
+
+	return EC_SUCCESS;
+}
+
+static int test_hash(void)
+{
+	/* Let the hash started at init finish */
+	wait_for_hash();
+
+	TEST_ASSERT(fill_region() == EC_SUCCESS);
+	compute_expected(0);
+
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_START, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_BUSY);
+	TEST_ASSERT(wait_for_hash() == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT(response.offset == HASH_OFFSET);
+	TEST_ASSERT(response.size == HASH_SIZE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_cached(void)
+{
+	uint32_t generation = flash_get_generation();
+
+	/* Flash hasn't changed, so the hash is done as soon as it starts */
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_START, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_RECALC, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	TEST_ASSERT(flash_get_generation() == generation);
+
+	return EC_SUCCESS;
+}
+
+static int test_nonce(void)
+{
+	/* Hashes with a nonce are always computed... */
+	compute_expected(16);
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_START, 16) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_BUSY);
+	TEST_ASSERT(wait_for_hash() == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	/* ...and don't displace the cached hash without one */
+	compute_expected(0);
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_START, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_write_invalidates(void)
+{
+	uint32_t generation = flash_get_generation();
+	const uint32_t zero = 0;
+
+	TEST_ASSERT(flash_write(HASH_OFFSET + 0x100, sizeof(zero),
+				(const char *)&zero) == EC_SUCCESS);
+	TEST_ASSERT(flash_get_generation() != generation);
+	compute_expected(0);
+
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_START, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_BUSY);
+	TEST_ASSERT(wait_for_hash() == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	/* Erasing also changes the generation */
+	generation = flash_get_generation();
+	TEST_ASSERT(flash_erase(HASH_OFFSET, CONFIG_FLASH_ERASE_SIZE) ==
+		    EC_SUCCESS);
+	TEST_ASSERT(flash_get_generation() != generation);
+	compute_expected(0);
+
+	TEST_ASSERT(send_hash_command(EC_VBOOT_HASH_RECALC, 0) ==
+		    EC_RES_SUCCESS);
+	TEST_ASSERT(response.status == EC_VBOOT_HASH_STATUS_DONE);
+	TEST_ASSERT_ARRAY_EQ(response.hash_digest, expected,
+			     SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+void run_test(void)
+{
+	test_reset();
+
+	RUN_TEST(test_hash);
+	RUN_TEST(test_cached);
+	RUN_TEST(test_nonce);
+	RUN_TEST(test_write_invalidates);
+
+	test_print_result();
+}
@@ -15,7 +15,10 @@ endif
 comm-objs=$(util-lock-objs:%=lock/%) comm-host.o comm-dev.o
 comm-objs+=comm-lpc.o comm-i2c.o misc_util.o
 
-ectool-objs=ectool.o ectool_keyscan.o ec_flash.o $(comm-objs)
+ectool-objs=ectool.o ectool_keyscan.o ectool_watch.o ec_flash.o $(comm-objs)
+ectool-objs+=../common/sha256.o
 ec_sb_firmware_update-objs=ec_sb_firmware_update.o $(comm-objs) misc_util.o
 ec_sb_firmware_update-objs+=powerd_lock.o
 lbplay-objs=lbplay.o $(comm-objs)
+# iteflash against a simulated FTDI and ITE chip; see iteflash-sim
+iteflash_sim-objs=iteflash.o
@@ -32,18 +32,23 @@ int comm_init_i2c(void) __attribute__((weak));
 static int fake_readmem(int offset, int bytes, void *dest)
 {
 	struct ec_params_read_memmap p;
-	int c;
+	int c, rv;
 	char *buf;
 
 	p.offset = offset;
 
 	if (bytes) {
-		p.size = bytes;
-		c = ec_command(EC_CMD_READ_MEMMAP, 0, &p, sizeof(p),
-			       dest, p.size);
-		if (c < 0)
-			return c;
-		return p.size;
+		/* Split reads larger than the protocol allows */
+		for (buf = dest, c = 0; c < bytes; c += p.size) {
+			p.offset = offset + c;
+			p.size = bytes - c < ec_max_insize ?
+				 bytes - c : ec_max_insize;
+			rv = ec_command(EC_CMD_READ_MEMMAP, 0, &p, sizeof(p),
+					buf + c, p.size);
+			if (rv < 0)
+				return rv;
+		}
+		return bytes;
 	}
 
 	p.size = EC_MEMMAP_TEXT_MAX;
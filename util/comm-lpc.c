@@ -228,7 +228,7 @@ static int ec_readmem_lpc(int offset, int bytes, void *dest)
 	char *s = dest;
 	int cnt = 0;
 
-	if (offset >= EC_MEMMAP_SIZE - bytes)
+	if (offset >= EC_MEMMAP_SIZE || offset + bytes > EC_MEMMAP_SIZE)
 		return -1;
 
 	if (bytes) {				/* fixed length */
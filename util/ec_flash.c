@@ -10,7 +10,19 @@
 #include <string.h>
 
 #include "comm-host.h"
+#include "ec_flash.h"
 #include "misc_util.h"
+#include "sha256.h"
+
+/* Size of blocks the EC hashes for ec_flash_verify() */
+#define VERIFY_BLOCK_SIZE 4096
+
+/* What ec_flash_write_delta() has to do to each erase block */
+enum block_state {
+	BLOCK_SAME,     /* Already holds the new data */
+	BLOCK_ERASED,   /* Needs writing; only the EC can say a block is */
+	BLOCK_CHANGED,  /* Needs erasing and writing */
+};
 
 int ec_flash_read(uint8_t *buf, int offset, int size)
 {
@@ -34,7 +46,83 @@ int ec_flash_read(uint8_t *buf, int offset, int size)
 	return 0;
 }
 
-int ec_flash_verify(const uint8_t *buf, int offset, int size)
+/* Return non-zero if the EC can hash blocks of flash for us */
+static int hash_supported(void)
+{
+	return ec_cmd_version_supported(EC_CMD_FLASH_HASH, EC_VER_FLASH_HASH);
+}
+
+/* Compute the SHA-256 digest of a buffer */
+static void hash_buf(const uint8_t *buf, int size, uint8_t *digest)
+{
+	struct sha256_ctx ctx;
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, buf, size);
+	memcpy(digest, SHA256_final(&ctx), SHA256_DIGEST_SIZE);
+}
+
+/**
+ * Get SHA-256 digests of blocks of EC flash, computed by the EC.
+ *
+ * @param offset	Offset in EC flash of the first block
+ * @param size		Total size of the blocks; the last block is short if
+ *			this isn't a multiple of block_size
+ * @param block_size	Size of each block, at most EC_FLASH_HASH_MAX_SIZE
+ * @param digests	Destination for one digest per block
+ *
+ * @return 0 if success, negative if error.
+ */
+static int hash_blocks(int offset, int size, int block_size, uint8_t *digests)
+{
+	struct ec_params_flash_hash *p =
+		(struct ec_params_flash_hash *)ec_outbuf;
+	int per_command = MIN(EC_FLASH_HASH_MAX_BLOCKS,
+			      ec_max_insize / SHA256_DIGEST_SIZE);
+	int pos, i, bytes;
+	int rv;
+
+	per_command = MIN(per_command, (int)((ec_max_outsize - sizeof(*p)) /
+					     sizeof(p->block[0])));
+
+	for (pos = 0; pos < size; ) {
+		p->hash_type = EC_FLASH_HASH_TYPE_SHA256;
+		p->reserved = 0;
+		for (i = 0, bytes = 0; i < per_command && pos < size &&
+			     bytes + block_size <= EC_FLASH_HASH_MAX_SIZE; i++) {
+			p->block[i].offset = offset + pos;
+			p->block[i].size = MIN(size - pos, block_size);
+			pos += p->block[i].size;
+			bytes += p->block[i].size;
+		}
+		p->block_count = i;
+
+		rv = ec_command(EC_CMD_FLASH_HASH, EC_VER_FLASH_HASH,
+				p, sizeof(*p) + i * sizeof(p->block[0]),
+				digests, i * SHA256_DIGEST_SIZE);
+		if (rv < 0) {
+			fprintf(stderr, "Hash error at offset %d\n",
+				p->block[0].offset);
+			return rv;
+		}
+		digests += i * SHA256_DIGEST_SIZE;
+	}
+
+	return 0;
+}
+
+/**
+ * Read back part of a region of EC flash and compare it with a buffer.
+ *
+ * @param buf		Expected contents of the region
+ * @param offset	Offset in EC flash of the region
+ * @param pos		Offset in the region of the part to compare
+ * @param size		Size of the part to compare
+ *
+ * @return 0 if the flash matches, negative if not or if error.
+ */
+static int read_and_compare(const uint8_t *buf, int offset, int pos,
+			    int size)
 {
 	uint8_t *rbuf = malloc(size);
 	int rv;
@@ -45,17 +133,17 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size)
 		return -1;
 	}
 
-	rv = ec_flash_read(rbuf, offset, size);
+	rv = ec_flash_read(rbuf, offset + pos, size);
 	if (rv < 0) {
 		free(rbuf);
 		return rv;
 	}
 
 	for (i = 0; i < size; i++) {
-		if (buf[i] != rbuf[i]) {
+		if (buf[pos + i] != rbuf[i]) {
 			fprintf(stderr, "Mismatch at offset 0x%x: "
 				"want 0x%02x, got 0x%02x\n",
-				i, buf[i], rbuf[i]);
+				pos + i, buf[pos + i], rbuf[i]);
 			free(rbuf);
 			return -1;
 		}
@@ -65,48 +153,108 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size)
 	return 0;
 }
 
-int ec_flash_write(const uint8_t *buf, int offset, int size)
+int ec_flash_verify(const uint8_t *buf, int offset, int size)
 {
-	struct ec_params_flash_write *p =
-		(struct ec_params_flash_write *)ec_outbuf;
-	struct ec_response_flash_info info;
-	int pdata_max_size = (int)(ec_max_outsize - sizeof(*p));
-	int step;
+	int count = (size + VERIFY_BLOCK_SIZE - 1) / VERIFY_BLOCK_SIZE;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint8_t *digests;
+	int pos, i;
+	int rv;
+
+	if (!hash_supported())
+		return read_and_compare(buf, offset, 0, size);
+
+	digests = malloc(count * SHA256_DIGEST_SIZE);
+	if (!digests) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		return -1;
+	}
+
+	rv = hash_blocks(offset, size, VERIFY_BLOCK_SIZE, digests);
+
+	/* Only read back blocks which don't match, to find out where */
+	for (i = 0, pos = 0; rv == 0 && i < count; i++) {
+		int n = MIN(size - pos, VERIFY_BLOCK_SIZE);
+
+		hash_buf(buf + pos, n, digest);
+		if (memcmp(digest, digests + i * SHA256_DIGEST_SIZE,
+			   SHA256_DIGEST_SIZE)) {
+			rv = read_and_compare(buf, offset, pos, n);
+			if (rv == 0) {
+				fprintf(stderr, "Hash mismatch at offset "
+					"0x%x, but data matches\n", pos);
+				rv = -1;
+			}
+		}
+		pos += n;
+	}
+
+	free(digests);
+	return rv;
+}
+
+/**
+ * Get the flash layout and the parameters of the largest write the EC takes.
+ *
+ * @param info		Destination for the flash layout
+ * @param step		Destination for the write size, a multiple of the
+ *			write block size
+ * @param version	Destination for the write command version to use
+ *
+ * @return 0 if success, negative if error.
+ */
+static int get_write_params(struct ec_response_flash_info *info, int *step,
+			    int *version)
+{
+	int pdata_max_size = (int)(ec_max_outsize -
+				   sizeof(struct ec_params_flash_write));
 	int rv;
-	int i;
 
 	/*
 	 * Determine whether we can use version 1 of the command with more
 	 * data, or only version 0.
 	 */
-	if (!ec_cmd_version_supported(EC_CMD_FLASH_WRITE, EC_VER_FLASH_WRITE))
+	*version = EC_VER_FLASH_WRITE;
+	if (!ec_cmd_version_supported(EC_CMD_FLASH_WRITE, EC_VER_FLASH_WRITE)) {
+		*version = 0;
 		pdata_max_size = EC_FLASH_WRITE_VER0_SIZE;
+	}
 
 	/*
 	 * Determine step size.  This must be a multiple of the write block
 	 * size, and must also fit into the host parameter buffer.
 	 */
-	rv = ec_command(EC_CMD_FLASH_INFO, 0, NULL, 0, &info, sizeof(info));
+	rv = ec_command(EC_CMD_FLASH_INFO, 0, NULL, 0, info, sizeof(*info));
 	if (rv < 0)
 		return rv;
 
-	step = (pdata_max_size / info.write_block_size) * info.write_block_size;
+	*step = (pdata_max_size / info->write_block_size) *
+		info->write_block_size;
 
-	if (!step) {
+	if (!*step) {
 		fprintf(stderr, "Write block size %d > max param size %d\n",
-			info.write_block_size, pdata_max_size);
+			info->write_block_size, pdata_max_size);
 		return -1;
 	}
 
-	/* Write data in chunks */
-	printf("Write size %d...\n", step);
+	return 0;
+}
+
+/* Write data in chunks of up to 'step' bytes */
+static int write_chunks(const uint8_t *buf, int offset, int size, int step,
+			int version)
+{
+	struct ec_params_flash_write *p =
+		(struct ec_params_flash_write *)ec_outbuf;
+	int rv;
+	int i;
 
 	for (i = 0; i < size; i += step) {
 		p->offset = offset + i;
 		p->size = MIN(size - i, step);
 		memcpy(p + 1, buf + i, p->size);
-		rv = ec_command(EC_CMD_FLASH_WRITE, 0, p, sizeof(*p) + p->size,
-				NULL, 0);
+		rv = ec_command(EC_CMD_FLASH_WRITE, version,
+				p, sizeof(*p) + p->size, NULL, 0);
 		if (rv < 0) {
 			fprintf(stderr, "Write error at offset %d\n", i);
 			return rv;
@@ -116,7 +264,24 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 	return 0;
 }
 
-int ec_flash_erase(int offset, int size)
+int ec_flash_write(const uint8_t *buf, int offset, int size)
+{
+	struct ec_response_flash_info info;
+	int step, version;
+	int rv;
+
+	rv = get_write_params(&info, &step, &version);
+	if (rv < 0)
+		return rv;
+
+	/* Write data in chunks */
+	printf("Write size %d...\n", step);
+
+	return write_chunks(buf, offset, size, step, version);
+}
+
+/* Erase a range of EC flash with a single command */
+static int erase_range(int offset, int size)
 {
 	struct ec_params_flash_erase p;
 
@@ -125,3 +290,301 @@ int ec_flash_erase(int offset, int size)
 
 	return ec_command(EC_CMD_FLASH_ERASE, 0, &p, sizeof(p), NULL, 0);
 }
+
+/**
+ * Ask the EC which blocks of a run are erased, so they needn't be again.
+ *
+ * What erased flash reads as depends on the chip, so the host doesn't guess
+ * from the contents.  If the EC can't tell us, every block stays
+ * BLOCK_CHANGED and is erased before it's written.
+ *
+ * @param state		enum block_state of each block in the run; erased
+ *			blocks are set to BLOCK_ERASED
+ * @param offset	Offset in EC flash of the run
+ * @param count		Number of blocks in the run
+ * @param block_size	Erase block size
+ *
+ * @return 0 if success, negative if error.
+ */
+static int find_erased(uint8_t *state, int offset, int count, int block_size)
+{
+	struct ec_params_flash_blank_check p;
+	const uint8_t *erased = ec_inbuf;
+	int per_command, pos, n, i;
+	int rv;
+
+	if (!ec_cmd_version_supported(EC_CMD_FLASH_BLANK_CHECK,
+				      EC_VER_FLASH_BLANK_CHECK))
+		return 0;
+
+	/* Check as many blocks as the EC allows at a time */
+	per_command = MIN(ec_max_insize * 8,
+			  EC_FLASH_BLANK_CHECK_MAX_SIZE / block_size);
+	if (!per_command)
+		return 0;
+
+	for (pos = 0; pos < count; pos += n) {
+		n = MIN(count - pos, per_command);
+		p.offset = offset + pos * block_size;
+		p.size = n * block_size;
+		rv = ec_command(EC_CMD_FLASH_BLANK_CHECK,
+				EC_VER_FLASH_BLANK_CHECK, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0) {
+			fprintf(stderr, "Blank check error at offset %d\n",
+				p.offset);
+			return rv;
+		}
+
+		for (i = 0; i < n; i++)
+			if (erased[i / 8] & (1 << (i % 8)))
+				state[pos + i] = BLOCK_ERASED;
+	}
+
+	return 0;
+}
+
+/**
+ * Find what has to be done to each erase block for ec_flash_write_delta().
+ *
+ * If the EC can hash flash, only partial blocks at the ends are read back;
+ * the rest are compared by digest.  Otherwise all blocks are read back.
+ *
+ * @param buf		New data
+ * @param offset	Offset in EC flash of new data
+ * @param size		Size of new data
+ * @param image		Destination for the blocks' new contents, 'len'
+ *			bytes
+ * @param start		Offset in EC flash of first block
+ * @param len		Size of the blocks
+ * @param block_size	Erase block size
+ * @param state		Destination for an enum block_state per block
+ *
+ * @return 0 if success, negative if error.
+ */
+static int get_block_states(const uint8_t *buf, int offset, int size,
+			    uint8_t *image, int start, int len,
+			    int block_size, uint8_t *state)
+{
+	int count = len / block_size;
+	int last = len - block_size;
+	/* Erase blocks may be too big to hash in one go */
+	int hash_size = MIN(block_size, EC_FLASH_HASH_MAX_SIZE);
+	int per_block = block_size / hash_size;
+	uint8_t digest[SHA256_DIGEST_SIZE];
+	uint8_t *digests = NULL;
+	uint8_t *old = NULL;
+	int i, rv;
+
+	if (!hash_supported()) {
+		old = malloc(len);
+		if (!old) {
+			fprintf(stderr, "Unable to allocate buffer.\n");
+			return -1;
+		}
+
+		rv = ec_flash_read(old, start, len);
+		if (rv < 0)
+			goto out;
+
+		memcpy(image, old, len);
+		memcpy(image + offset - start, buf, size);
+
+		for (i = 0; i < count; i++) {
+			if (!memcmp(image + i * block_size,
+				    old + i * block_size, block_size))
+				state[i] = BLOCK_SAME;
+			else
+				state[i] = BLOCK_CHANGED;
+		}
+		goto out;
+	}
+
+	/* Keep what's around the new data in partial blocks at the ends */
+	if (offset != start) {
+		rv = ec_flash_read(image, start, block_size);
+		if (rv < 0)
+			return rv;
+	}
+	if (offset + size != start + len && (last || offset == start)) {
+		rv = ec_flash_read(image + last, start + last, block_size);
+		if (rv < 0)
+			return rv;
+	}
+	memcpy(image + offset - start, buf, size);
+
+	digests = malloc(count * per_block * SHA256_DIGEST_SIZE);
+	if (!digests) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		rv = -1;
+		goto out;
+	}
+
+	rv = hash_blocks(start, len, hash_size, digests);
+	if (rv < 0)
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		int j;
+
+		state[i] = BLOCK_SAME;
+		for (j = i * per_block; j < (i + 1) * per_block; j++) {
+			hash_buf(image + j * hash_size, hash_size, digest);
+			if (memcmp(digests + j * SHA256_DIGEST_SIZE, digest,
+				   SHA256_DIGEST_SIZE))
+				state[i] = BLOCK_CHANGED;
+		}
+	}
+
+out:
+	free(digests);
+	free(old);
+	return rv;
+}
+
+/**
+ * Erase the blocks of a run which are not already erased.
+ *
+ * @param state		enum block_state of each block in the run
+ * @param offset	Offset in EC flash of the run
+ * @param count		Number of blocks in the run
+ * @param block_size	Erase block size
+ *
+ * @return 0 if success, negative if error.
+ */
+static int erase_run(const uint8_t *state, int offset, int count,
+		     int block_size)
+{
+	int start, end;
+	int rv;
+
+	for (start = 0; start < count; start = end) {
+		if (state[start] != BLOCK_CHANGED) {
+			end = start + 1;
+			continue;
+		}
+
+		/* Erase neighbouring blocks which need it in one command */
+		for (end = start; end < count; end++)
+			if (state[end] != BLOCK_CHANGED)
+				break;
+
+		rv = erase_range(offset + start * block_size,
+				    (end - start) * block_size);
+		if (rv < 0) {
+			fprintf(stderr, "Erase error at offset %d\n",
+				offset + start * block_size);
+			return rv;
+		}
+	}
+
+	return 0;
+}
+
+int ec_flash_write_delta(const uint8_t *buf, int offset, int size)
+{
+	struct ec_response_flash_info info;
+	int step, version, block_size;
+	int start, len, count, i, end;
+	int changed = 0;
+	uint8_t *image = NULL, *state = NULL;
+	int rv;
+
+	rv = get_write_params(&info, &step, &version);
+	if (rv < 0)
+		return rv;
+
+	/* Work in whole erase blocks, keeping what's around the region */
+	block_size = info.erase_block_size;
+	start = offset - offset % block_size;
+	len = offset + size - start + block_size - 1;
+	len -= len % block_size;
+	count = len / block_size;
+
+	image = malloc(len);
+	state = malloc(count);
+	if (!image || !state) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		rv = -1;
+		goto out;
+	}
+
+	rv = get_block_states(buf, offset, size, image, start, len,
+			      block_size, state);
+	if (rv < 0)
+		goto out;
+
+	for (i = 0; i < count; i = end) {
+		if (state[i] == BLOCK_SAME) {
+			end = i + 1;
+			continue;
+		}
+
+		/* Rewrite neighbouring blocks which differ together */
+		for (end = i; end < count; end++) {
+			if (state[end] == BLOCK_SAME)
+				break;
+			changed++;
+		}
+
+		rv = find_erased(state + i, start + i * block_size, end - i,
+				 block_size);
+		if (rv < 0)
+			goto out;
+
+		rv = erase_run(state + i, start + i * block_size, end - i,
+			       block_size);
+		if (rv < 0)
+			goto out;
+
+		rv = write_chunks(image + i * block_size,
+				  start + i * block_size,
+				  (end - i) * block_size, step, version);
+		if (rv < 0)
+			goto out;
+	}
+
+	printf("%d of %d blocks changed.\n", changed, count);
+
+out:
+	free(image);
+	free(state);
+	return rv;
+}
+
+int ec_flash_erase(int offset, int size)
+{
+	struct ec_response_flash_info info;
+	int block_size, count;
+	uint8_t *state;
+	int rv;
+
+	if (!ec_cmd_version_supported(EC_CMD_FLASH_BLANK_CHECK,
+				      EC_VER_FLASH_BLANK_CHECK))
+		return erase_range(offset, size);
+
+	rv = ec_command(EC_CMD_FLASH_INFO, 0, NULL, 0, &info, sizeof(info));
+	if (rv < 0)
+		return rv;
+
+	/* Let the EC reject a range which isn't whole blocks */
+	block_size = info.erase_block_size;
+	if (offset % block_size || size % block_size)
+		return erase_range(offset, size);
+
+	count = size / block_size;
+	state = malloc(count);
+	if (!state) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		return -1;
+	}
+
+	/* Only erase runs of blocks which aren't erased already */
+	memset(state, BLOCK_CHANGED, count);
+	rv = find_erased(state, offset, count, block_size);
+	if (rv == 0)
+		rv = erase_run(state, offset, count, block_size);
+
+	free(state);
+	return rv;
+}
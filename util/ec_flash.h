@@ -20,6 +20,9 @@ int ec_flash_read(uint8_t *buf, int offset, int size);
 /**
  * Verify EC flash memory
  *
+ * If the EC supports EC_CMD_FLASH_HASH, compares digests of blocks and only
+ * reads back blocks which differ; otherwise reads back the whole region.
+ *
  * @param buf		Source buffer to verify against EC flash
  * @param offset	Offset in EC flash to check
  * @param size		Number of bytes to check
@@ -39,9 +42,30 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size);
  */
 int ec_flash_write(const uint8_t *buf, int offset, int size);
 
+/**
+ * Write EC flash memory, erasing and rewriting only blocks which change
+ *
+ * Compares the erase blocks the region covers with the source, by digest if
+ * the EC supports EC_CMD_FLASH_HASH or else by reading them back.  Blocks
+ * which already hold the right data are left alone; the rest are erased,
+ * unless already erased, and written.  Unlike ec_flash_write(), the region
+ * need not be erased first, and need not be aligned to erase blocks; data
+ * around it in the same blocks is kept.
+ *
+ * @param buf		Source buffer
+ * @param offset	Offset in EC flash to write
+ * @param size		Number of bytes to write
+ *
+ * @return 0 if success, negative if error.
+ */
+int ec_flash_write_delta(const uint8_t *buf, int offset, int size);
+
 /**
  * Erase EC flash memory
  *
+ * If the EC supports EC_CMD_FLASH_BLANK_CHECK, erase blocks which are
+ * already erased are skipped.
+ *
  * @param offset	Offset in EC flash to erase
  * @param size		Number of bytes to erase
  *
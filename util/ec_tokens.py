@@ -0,0 +1,256 @@
+#!/usr/bin/env python
+# Copyright 2015 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Decode the EC tokenized console log.
+
+The EC stores ctprints() messages as the address of the format string, a
+timestamp and the raw arguments (struct ec_console_token in ec_commands.h).
+This looks the format strings up in the EC's ELF images and formats the
+arguments the same way the EC's vfnprintf() would have.
+
+  Example:
+    ectool consoletokens /tmp/tokens.bin
+    util/ec_tokens.py -e build/samus/RO/ec.RO.elf \\
+        -e build/samus/RW/ec.RW.elf /tmp/tokens.bin
+"""
+
+from __future__ import print_function
+import optparse
+import struct
+import sys
+
+# struct ec_console_token: format, timestamp, channel, size
+TOKEN_HEADER = struct.Struct('<IIBB')
+TOKEN_TRUNCATED = 0x80
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class ElfStrings(object):
+  """Reads null-terminated strings from the loadable sections of ELF files."""
+
+  def __init__(self):
+    self.sections = []
+
+  def add_file(self, path):
+    """Adds the allocated sections of an ELF file to the lookup table."""
+    with open(path, 'rb') as f:
+      data = f.read()
+    if data[:4] != b'\x7fELF':
+      raise ValueError('%s is not an ELF file' % path)
+    is_64 = data[4:5] == b'\x02'
+    if is_64:
+      shoff, = struct.unpack_from('<Q', data, 0x28)
+      shentsize, shnum = struct.unpack_from('<HH', data, 0x3a)
+      fmt = '<IIQQQQ'
+    else:
+      shoff, = struct.unpack_from('<I', data, 0x20)
+      shentsize, shnum = struct.unpack_from('<HH', data, 0x2e)
+      fmt = '<IIIIII'
+    for i in range(shnum):
+      _, sh_type, flags, addr, offset, size = struct.unpack_from(
+          fmt, data, shoff + i * shentsize)
+      if flags & SHF_ALLOC and sh_type != SHT_NOBITS and size:
+        self.sections.append((addr, data[offset:offset + size]))
+
+  def lookup(self, addr):
+    """Returns the string at an address, or None if it is not mapped."""
+    for base, contents in self.sections:
+      if base <= addr < base + len(contents):
+        start = addr - base
+        end = contents.find(b'\0', start)
+        if end < 0:
+          end = len(contents)
+        return contents[start:end].decode('latin-1')
+    return None
+
+
+class Args(object):
+  """Consumes packed arguments in the order pack_args() stored them."""
+
+  def __init__(self, data):
+    self.data = data
+    self.pos = 0
+
+  def take(self, size):
+    if self.pos + size > len(self.data):
+      raise IndexError('out of arguments')
+    chunk = self.data[self.pos:self.pos + size]
+    self.pos += size
+    return chunk
+
+  def u32(self):
+    return struct.unpack('<I', self.take(4))[0]
+
+  def u64(self):
+    return struct.unpack('<Q', self.take(8))[0]
+
+  def string(self):
+    size = struct.unpack('<B', self.take(1))[0]
+    return self.take(size).decode('latin-1')
+
+
+def format_int(v, conv, is_64, precision):
+  """Formats an integer like vfnprintf(), including fixed-point precision."""
+  bits = 64 if is_64 else 32
+  negative = False
+  if conv == 'd' and v >= 1 << (bits - 1):
+    v = (1 << bits) - v
+    negative = True
+  base = {'x': 16, 'X': 16, 'p': 16, 'b': 2}.get(conv, 10)
+
+  out = ''
+  for _ in range(precision):
+    out = str(v % 10) + out
+    v //= 10
+  if precision:
+    out = '.' + out
+  if not v:
+    out = '0' + out
+  while v:
+    digit = v % base
+    v //= base
+    if digit < 10:
+      out = chr(ord('0') + digit) + out
+    elif conv == 'X':
+      out = chr(ord('A') + digit - 10) + out
+    else:
+      out = chr(ord('a') + digit - 10) + out
+  if negative:
+    out = '-' + out
+  return out
+
+
+def format_token(fmt, args, timestamp):
+  """Formats a message the way the EC's vfnprintf() would have."""
+  out = []
+  i = 0
+  while i < len(fmt):
+    c = fmt[i]
+    i += 1
+    if c != '%':
+      out.append(c)
+      continue
+    c = fmt[i] if i < len(fmt) else ''
+    i += 1
+    if c in ('%', ''):
+      out.append('%')
+      continue
+    if c == 'c':
+      out.append(chr(args.u32() & 0xff))
+      continue
+
+    left = c == '-'
+    if left:
+      c = fmt[i]
+      i += 1
+    padzero = c == '0'
+    if padzero:
+      c = fmt[i]
+      i += 1
+    width = 0
+    if c == '*':
+      width = struct.unpack('<i', args.take(4))[0]
+      c = fmt[i]
+      i += 1
+    else:
+      while c.isdigit():
+        width = width * 10 + int(c)
+        c = fmt[i]
+        i += 1
+    precision = 0
+    if c == '.':
+      c = fmt[i]
+      i += 1
+      if c == '*':
+        precision = struct.unpack('<i', args.take(4))[0]
+        c = fmt[i]
+        i += 1
+      else:
+        while c.isdigit():
+          precision = precision * 10 + int(c)
+          c = fmt[i]
+          i += 1
+
+    if c == 's':
+      s = args.string()
+    elif c == 'h':
+      out.append(''.join('%02x' % b for b in bytearray(args.take(precision))))
+      continue
+    else:
+      is_64 = c == 'l'
+      if is_64:
+        c = fmt[i]
+        i += 1
+      if c == 'T':
+        s = format_int(timestamp, 'u', True, 6)
+      elif c in 'duxXpb':
+        v = args.u64() if is_64 else args.u32()
+        s = format_int(v, c, is_64, precision)
+      else:
+        out.append('ERROR')
+        break
+      precision = 0
+
+    if precision > 0 and width > precision:
+      width = precision
+    if not precision:
+      precision = max(len(s), width)
+    pad = ' ' * (width - len(s)) if width > len(s) else ''
+    if padzero and not left:
+      pad = pad.replace(' ', '0')
+    s = s[:precision]
+    out.append(s + pad if left else pad + s)
+  return ''.join(out)
+
+
+def decode(data, strings, output):
+  """Decodes a stream of token records to text."""
+  pos = 0
+  while pos + TOKEN_HEADER.size <= len(data):
+    addr, timestamp, channel, size = TOKEN_HEADER.unpack_from(data, pos)
+    pos += TOKEN_HEADER.size
+    args = Args(data[pos:pos + size])
+    pos += size
+
+    fmt = strings.lookup(addr)
+    if fmt is None:
+      text = '<unknown format 0x%08x>' % addr
+    else:
+      try:
+        text = format_token(fmt, args, timestamp)
+      except IndexError:
+        text = fmt + ' <missing args>'
+    if channel & TOKEN_TRUNCATED:
+      text += ' <truncated>'
+    output.write('[%d.%06d %d] %s\n' % (timestamp // 1000000,
+                                        timestamp % 1000000,
+                                        channel & ~TOKEN_TRUNCATED, text))
+
+
+def main(argv):
+  parser = optparse.OptionParser(
+      usage='%prog -e ELF [-e ELF ...] [TOKEN_FILE]')
+  parser.add_option('-e', '--elf', action='append', default=[],
+                    help='EC image to look format strings up in (RO and RW)')
+  options, args = parser.parse_args(argv)
+  if not options.elf or len(args) > 1:
+    parser.error('need at least one ELF file and at most one token file')
+
+  strings = ElfStrings()
+  for path in options.elf:
+    strings.add_file(path)
+
+  if args:
+    with open(args[0], 'rb') as f:
+      data = f.read()
+  else:
+    data = getattr(sys.stdin, 'buffer', sys.stdin).read()
+
+  decode(data, strings, sys.stdout)
+
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
@@ -0,0 +1,219 @@
+#!/usr/bin/env python
+# Copyright 2015 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+"""Convert the EC event trace to Chrome trace-event JSON.
+
+The EC records trace points as fixed-size binary events (struct
+ec_trace_event in ec_commands.h).  This turns them into the JSON format read
+by chrome://tracing and Perfetto, with one row per task plus a CPU row
+showing which task was running.
+
+  Example:
+    ectool trace /tmp/trace.bin
+    util/ec_trace.py -e build/samus/RW/ec.RW.elf \\
+        -t HOOKS,USB_CHG,CHARGER,HOSTCMD,CONSOLE /tmp/trace.bin > trace.json
+"""
+
+from __future__ import print_function
+import json
+import optparse
+import struct
+import sys
+
+# struct ec_trace_event: timestamp, id, type, task, arg
+TRACE_EVENT = struct.Struct('<IHBBI')
+
+# enum ec_trace_type
+TRACE_BEGIN = 0
+TRACE_END = 1
+TRACE_INSTANT = 2
+TRACE_FLAG_ISR = 0x80
+
+# enum ec_trace_id
+ID_TASK_SWITCH = 0
+ID_HOOK = 1
+ID_DEFERRED = 2
+ID_HOST_CMD = 3
+ID_I2C_XFER = 4
+ID_LIGHTBAR_SEQ = 5
+ID_LIGHTBAR_FRAME = 6
+ID_USER = 0x8000
+
+# enum hook_type, in order
+HOOK_NAMES = [
+    'INIT', 'PRE_FREQ_CHANGE', 'FREQ_CHANGE', 'SYSJUMP', 'CHIPSET_PRE_INIT',
+    'CHIPSET_STARTUP', 'CHIPSET_RESUME', 'CHIPSET_SUSPEND',
+    'CHIPSET_SHUTDOWN', 'AC_CHANGE', 'LID_CHANGE', 'POWER_BUTTON_CHANGE',
+    'CHARGE_STATE_CHANGE', 'BATTERY_SOC_CHANGE', 'TICK', 'SECOND',
+]
+
+PID = 1
+TID_CPU = 1000
+TID_ISR = 1001
+
+SHT_SYMTAB = 2
+STT_FUNC = 2
+
+
+class ElfSymbols(object):
+  """Looks up function names by address in the symbol tables of ELF files."""
+
+  def __init__(self):
+    self.symbols = {}
+
+  def add_file(self, path):
+    """Adds the function symbols of an ELF file."""
+    with open(path, 'rb') as f:
+      data = f.read()
+    if data[:4] != b'\x7fELF':
+      raise ValueError('%s is not an ELF file' % path)
+    is_64 = data[4:5] == b'\x02'
+    if is_64:
+      shoff, = struct.unpack_from('<Q', data, 0x28)
+      shentsize, shnum = struct.unpack_from('<HH', data, 0x3a)
+      shdr = '<IIQQQQII'
+      sym = struct.Struct('<IBBHQQ')
+    else:
+      shoff, = struct.unpack_from('<I', data, 0x20)
+      shentsize, shnum = struct.unpack_from('<HH', data, 0x2e)
+      shdr = '<IIIIIIII'
+      sym = struct.Struct('<IIIBBH')
+    sections = [struct.unpack_from(shdr, data, shoff + i * shentsize)
+                for i in range(shnum)]
+    for _, sh_type, _, _, offset, size, link, _ in sections:
+      if sh_type != SHT_SYMTAB:
+        continue
+      stroff = sections[link][4]
+      for pos in range(offset, offset + size, sym.size):
+        if is_64:
+          name, info, _, _, value, _ = sym.unpack_from(data, pos)
+        else:
+          name, value, _, info, _, _ = sym.unpack_from(data, pos)
+        if info & 0xf != STT_FUNC:
+          continue
+        end = data.find(b'\0', stroff + name)
+        # Thumb function addresses have the low bit set
+        self.symbols[value & ~1] = data[stroff + name:end].decode('latin-1')
+
+  def lookup(self, addr):
+    """Returns the function at an address, or the address in hex."""
+    return self.symbols.get(addr & ~1, '0x%08x' % addr)
+
+
+def event_name(trace_id, arg, symbols):
+  """Returns a readable name for a begin or instant event."""
+  if trace_id == ID_HOOK:
+    if arg < len(HOOK_NAMES):
+      return 'hook ' + HOOK_NAMES[arg]
+    return 'hook %d' % arg
+  if trace_id == ID_DEFERRED:
+    return 'deferred ' + symbols.lookup(arg)
+  if trace_id == ID_HOST_CMD:
+    return 'host cmd 0x%02x' % arg
+  if trace_id == ID_I2C_XFER:
+    return 'i2c %d:0x%02x' % (arg >> 8, arg & 0xff)
+  if trace_id == ID_LIGHTBAR_SEQ:
+    return 'lightbar seq %d' % arg
+  if trace_id == ID_LIGHTBAR_FRAME:
+    return 'lightbar frame'
+  if trace_id >= ID_USER:
+    return 'user %d' % (trace_id - ID_USER)
+  return 'id %d' % trace_id
+
+
+def task_name(task_names, task):
+  if task < len(task_names):
+    return task_names[task]
+  return 'task %d' % task
+
+
+def convert(data, task_names, symbols):
+  """Converts a stream of trace events to a list of Chrome trace events."""
+  out = []
+  tasks = set()
+  running = None
+  base = 0
+  last = None
+
+  for pos in range(0, len(data) - TRACE_EVENT.size + 1, TRACE_EVENT.size):
+    timestamp, trace_id, trace_type, task, arg = TRACE_EVENT.unpack_from(
+        data, pos)
+
+    # Timestamps are the low 32 bits of the EC time; undo the wraps
+    if last is not None and timestamp < last and last - timestamp > 1 << 31:
+      base += 1 << 32
+    last = timestamp
+    ts = base + timestamp
+
+    if trace_id == ID_TASK_SWITCH:
+      if running is not None:
+        out.append({'ph': 'E', 'ts': ts, 'pid': PID, 'tid': TID_CPU})
+      tasks.add(arg)
+      running = arg
+      out.append({'name': task_name(task_names, arg), 'ph': 'B', 'ts': ts,
+                  'pid': PID, 'tid': TID_CPU})
+      continue
+
+    if trace_type & TRACE_FLAG_ISR:
+      tid = TID_ISR
+    else:
+      tid = task
+      tasks.add(task)
+    kind = trace_type & ~TRACE_FLAG_ISR
+
+    event = {'ts': ts, 'pid': PID, 'tid': tid, 'args': {'arg': arg}}
+    if kind == TRACE_END:
+      event['ph'] = 'E'
+    else:
+      event['name'] = event_name(trace_id, arg, symbols)
+      if kind == TRACE_INSTANT:
+        event['ph'] = 'i'
+        event['s'] = 't'
+      else:
+        event['ph'] = 'B'
+    out.append(event)
+
+  # Close the span of the task left running
+  if running is not None:
+    out.append({'ph': 'E', 'ts': base + last, 'pid': PID, 'tid': TID_CPU})
+
+  for tid, name in ([(t, task_name(task_names, t)) for t in sorted(tasks)] +
+                    [(TID_CPU, 'CPU'), (TID_ISR, 'ISR')]):
+    out.append({'name': 'thread_name', 'ph': 'M', 'pid': PID, 'tid': tid,
+                'args': {'name': name}})
+  out.append({'name': 'process_name', 'ph': 'M', 'pid': PID,
+              'args': {'name': 'EC'}})
+  return out
+
+
+def main(argv):
+  parser = optparse.OptionParser(
+      usage='%prog [-e ELF ...] [-t TASKS] [TRACE_FILE]')
+  parser.add_option('-e', '--elf', action='append', default=[],
+                    help='EC image to look deferred routine names up in')
+  parser.add_option('-t', '--tasks', default='',
+                    help='comma-separated task names, in task ID order '
+                    '(as printed by taskinfo)')
+  options, args = parser.parse_args(argv)
+  if len(args) > 1:
+    parser.error('at most one trace file')
+
+  symbols = ElfSymbols()
+  for path in options.elf:
+    symbols.add_file(path)
+  task_names = [t for t in options.tasks.split(',') if t]
+
+  if args:
+    with open(args[0], 'rb') as f:
+      data = f.read()
+  else:
+    data = getattr(sys.stdin, 'buffer', sys.stdin).read()
+
+  json.dump({'traceEvents': convert(data, task_names, symbols),
+             'displayTimeUnit': 'ms'}, sys.stdout, indent=1)
+  sys.stdout.write('\n')
+
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
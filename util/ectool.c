@@ -69,6 +69,10 @@ const char help_str[] =
 	"      Prints supported version mask for a command number\n"
 	"  console\n"
 	"      Prints the last output to the EC debug console\n"
+	"  consoletail [-f] [<seq>]\n"
+	"      Prints EC console output from byte <seq> on; -f keeps following\n"
+	"  consoletokens [<outfile>]\n"
+	"      Reads the raw tokenized console log; decode with ec_tokens.py\n"
 	"  echash [CMDS]\n"
 	"      Various EC hash commands\n"
 	"  eventclear <mask>\n"
@@ -105,8 +109,11 @@ const char help_str[] =
 	"      Prints or sets EC flash protection state\n"
 	"  flashread <offset> <size> <outfile>\n"
 	"      Reads from EC flash to a file\n"
-	"  flashwrite <offset> <infile>\n"
-	"      Writes to EC flash from a file\n"
+	"  flashverify <offset> <infile>\n"
+	"      Checks EC flash holds the contents of a file\n"
+	"  flashwrite [-d] <offset> <infile>\n"
+	"      Writes to EC flash from a file; -d only erases and rewrites\n"
+	"      blocks which change\n"
 	"  forcelidopen <enable>\n"
 	"      Forces the lid switch to open position\n"
 	"  gpioget <GPIO name>\n"
@@ -191,6 +198,8 @@ const char help_str[] =
 	"      Prints current EC switch positions\n"
 	"  temps <sensorid>\n"
 	"      Print temperature.\n"
+	"  taskstats\n"
+	"      Prints per-task CPU usage\n"
 	"  tempsinfo <sensorid>\n"
 	"      Print temperature sensor info.\n"
 	"  thermalget <platform-specific args>\n"
@@ -201,6 +210,8 @@ const char help_str[] =
 	"      Get/set TMP006 calibration\n"
 	"  tmp006raw <tmp006_index>\n"
 	"      Get raw TMP006 data\n"
+	"  trace [<file>]\n"
+	"      Read the event trace, for util/ec_trace.py\n"
 	"  usbchargemode <port> <mode>\n"
 	"      Set USB charging mode\n"
 	"  usbmux <mux>\n"
@@ -213,6 +224,8 @@ const char help_str[] =
 	"      Get USB PD power information\n"
 	"  version\n"
 	"      Prints EC version\n"
+	"  watch [<rate_hz> [<count> [csv|bin]]]\n"
+	"      Stream timestamped memory map samples at a fixed rate\n"
 	"  wireless <flags> [<mask> [<suspend_flags> <suspend_mask>]]\n"
 	"      Enable/disable WLAN/Bluetooth radio\n"
 	"";
@@ -749,12 +762,19 @@ int cmd_flash_read(int argc, char *argv[])
 int cmd_flash_write(int argc, char *argv[])
 {
 	int offset, size;
+	int delta = 0;
 	int rv;
 	char *e;
 	char *buf;
 
+	if (argc > 1 && !strcmp(argv[1], "-d")) {
+		delta = 1;
+		argc--;
+		argv++;
+	}
 	if (argc < 3) {
-		fprintf(stderr, "Usage: %s <offset> <filename>\n", argv[0]);
+		fprintf(stderr, "Usage: %s [-d] <offset> <filename>\n",
+			argv[0]);
 		return -1;
 	}
 
@@ -772,7 +792,46 @@ int cmd_flash_write(int argc, char *argv[])
 	printf("Writing to offset %d...\n", offset);
 
 	/* Write data in chunks */
-	rv = ec_flash_write(buf, offset, size);
+	if (delta)
+		rv = ec_flash_write_delta(buf, offset, size);
+	else
+		rv = ec_flash_write(buf, offset, size);
+
+	free(buf);
+
+	if (rv < 0)
+		return rv;
+
+	printf("done.\n");
+	return 0;
+}
+
+int cmd_flash_verify(int argc, char *argv[])
+{
+	int offset, size;
+	int rv;
+	char *e;
+	char *buf;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <offset> <filename>\n", argv[0]);
+		return -1;
+	}
+
+	offset = strtol(argv[1], &e, 0);
+	if ((e && *e) || offset < 0 || offset > 0x100000) {
+		fprintf(stderr, "Bad offset.\n");
+		return -1;
+	}
+
+	/* Read the input file */
+	buf = read_file(argv[2], &size);
+	if (!buf)
+		return -1;
+
+	printf("Verifying %d bytes at offset %d...\n", size, offset);
+
+	rv = ec_flash_verify(buf, offset, size);
 
 	free(buf);
 
@@ -1459,6 +1518,42 @@ int cmd_temp_sensor_info(int argc, char *argv[])
 }
 
 
+int cmd_task_stats(int argc, char *argv[])
+{
+	struct ec_params_task_stats p;
+	struct ec_response_task_stats *r =
+		(struct ec_response_task_stats *)ec_inbuf;
+	struct ec_task_stats *stats = (struct ec_task_stats *)(r + 1);
+	char name[EC_TASK_NAME_SIZE + 1];
+	int rv, i;
+
+	printf("Task Name             Switches    Runtime (s)  Max run (s)\n");
+	p.first = 0;
+	do {
+		rv = ec_command(EC_CMD_TASK_STATS, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (!r->count)
+			break;
+
+		for (i = 0; i < r->count; i++) {
+			memcpy(name, stats[i].name, EC_TASK_NAME_SIZE);
+			name[EC_TASK_NAME_SIZE] = '\0';
+			printf("%4d %-16s %10u %7u.%06u %5u.%06u\n",
+			       p.first + i, name, stats[i].switches,
+			       (unsigned)(stats[i].runtime / 1000000),
+			       (unsigned)(stats[i].runtime % 1000000),
+			       stats[i].max_run / 1000000,
+			       stats[i].max_run % 1000000);
+		}
+		p.first += r->count;
+	} while (p.first < r->task_count);
+
+	return 0;
+}
+
+
 int cmd_thermal_get_threshold_v0(int argc, char *argv[])
 {
 	struct ec_params_thermal_get_threshold p;
@@ -5841,6 +5936,148 @@ int cmd_console(int argc, char *argv[])
 	printf("\n");
 	return 0;
 }
+
+int cmd_console_tail(int argc, char *argv[])
+{
+	struct ec_params_console_read_seq p = { .seq = 0 };
+	struct ec_response_console_read_seq *r = ec_inbuf;
+	int follow = 0;
+	char *e;
+	int rv, len;
+
+	if (argc > 1 && !strcmp(argv[1], "-f")) {
+		follow = 1;
+		argc--;
+		argv++;
+	}
+	if (argc > 1) {
+		p.seq = strtoul(argv[1], &e, 0);
+		if (e && *e) {
+			fprintf(stderr, "Bad sequence number.\n");
+			return -1;
+		}
+	}
+
+	while (1) {
+		rv = ec_command(EC_CMD_CONSOLE_READ_SEQ, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < (int)sizeof(*r))
+			return rv < 0 ? rv : -1;
+
+		if (r->lost)
+			fprintf(stderr, "\n[%u bytes lost]\n", r->lost);
+		else if (r->seq != p.seq)
+			fprintf(stderr, "\n[EC console restarted]\n");
+
+		len = rv - sizeof(*r);
+		fwrite(r + 1, len, 1, stdout);
+		p.seq = r->next_seq;
+
+		/* Caught up; keep polling if following, else stop */
+		if (len < ec_max_insize - (int)sizeof(*r)) {
+			if (!follow)
+				break;
+			fflush(stdout);
+			usleep(100000);
+		}
+	}
+
+	fflush(stdout);
+	fprintf(stderr, "Next seq: %u\n", p.seq);
+	return 0;
+}
+
+int cmd_console_tokens(int argc, char *argv[])
+{
+	struct ec_response_console_read_tokens *r = ec_inbuf;
+	FILE *f = stdout;
+	uint32_t dropped = 0;
+	int total = 0;
+	int rv;
+
+	if (argc > 1) {
+		f = fopen(argv[1], "wb");
+		if (!f) {
+			perror("Unable to open output file");
+			return -1;
+		}
+	}
+
+	/* Drain the tokenized log; the caller decodes it with ec_tokens.py */
+	while (1) {
+		rv = ec_command(EC_CMD_CONSOLE_READ_TOKENS, 0,
+				NULL, 0, ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			break;
+
+		dropped += r->dropped;
+		rv -= sizeof(*r);
+		if (rv <= 0)
+			break;
+
+		fwrite(r + 1, rv, 1, f);
+		total += rv;
+	}
+
+	if (f != stdout)
+		fclose(f);
+	if (rv < 0)
+		return rv;
+
+	fprintf(stderr, "Read %d bytes of tokens, %u records dropped\n",
+		total, dropped);
+	return 0;
+}
+
+int cmd_trace(int argc, char *argv[])
+{
+	struct ec_response_trace_read *r = ec_inbuf;
+	FILE *f = stdout;
+	uint32_t dropped = 0;
+	int total = 0;
+	int rv;
+
+	if (argc > 1) {
+		f = fopen(argv[1], "wb");
+		if (!f) {
+			perror("Unable to open output file");
+			return -1;
+		}
+	}
+
+	/* Drain the trace; the caller converts it with ec_trace.py */
+	while (1) {
+		rv = ec_command(EC_CMD_TRACE_READ, 0,
+				NULL, 0, ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			break;
+
+		dropped += r->dropped;
+		rv -= sizeof(*r);
+		if (rv <= 0)
+			break;
+
+		fwrite(r + 1, rv, 1, f);
+		total += rv / sizeof(struct ec_trace_event);
+
+		/*
+		 * Each read switches to the host command task, which adds
+		 * events of its own; stop once we've caught up.
+		 */
+		if (sizeof(*r) + rv + sizeof(struct ec_trace_event) <=
+		    ec_max_insize)
+			break;
+	}
+
+	if (f != stdout)
+		fclose(f);
+	if (rv < 0)
+		return rv;
+
+	fprintf(stderr, "Read %d events, %u dropped\n", total, dropped);
+	return 0;
+}
+
 struct param_info {
 	const char *name;	/* name of this parameter */
 	const char *help;	/* help message */
@@ -6527,6 +6764,8 @@ const struct command commands[] = {
 	{"chipinfo", cmd_chipinfo},
 	{"cmdversions", cmd_cmdversions},
 	{"console", cmd_console},
+	{"consoletail", cmd_console_tail},
+	{"consoletokens", cmd_console_tokens},
 	{"echash", cmd_ec_hash},
 	{"eventclear", cmd_host_event_clear},
 	{"eventclearb", cmd_host_event_clear_b},
@@ -6543,6 +6782,7 @@ const struct command commands[] = {
 	{"flasherase", cmd_flash_erase},
 	{"flashprotect", cmd_flash_protect},
 	{"flashread", cmd_flash_read},
+	{"flashverify", cmd_flash_verify},
 	{"flashwrite", cmd_flash_write},
 	{"flashinfo", cmd_flash_info},
 	{"flashpd", cmd_flash_pd},
@@ -6589,6 +6829,7 @@ const struct command commands[] = {
 	{"sertest", cmd_serial_test},
 	{"port80flood", cmd_port_80_flood},
 	{"switches", cmd_switches},
+	{"taskstats", cmd_task_stats},
 	{"temps", cmd_temperature},
 	{"tempsinfo", cmd_temp_sensor_info},
 	{"test", cmd_test},
@@ -6596,11 +6837,13 @@ const struct command commands[] = {
 	{"thermalset", cmd_thermal_set_threshold},
 	{"tmp006cal", cmd_tmp006cal},
 	{"tmp006raw", cmd_tmp006raw},
+	{"trace", cmd_trace},
 	{"usbchargemode", cmd_usb_charge_set_mode},
 	{"usbmux", cmd_usb_mux},
 	{"usbpd", cmd_usb_pd},
 	{"usbpdpower", cmd_usb_pd_power},
 	{"version", cmd_version},
+	{"watch", cmd_watch},
 	{"wireless", cmd_wireless},
 	{NULL, NULL}
 };
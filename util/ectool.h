@@ -28,3 +28,21 @@
  * @return 0 if ok, -1 on error
  */
 int cmd_keyscan(int argc, char *argv[]);
+
+/**
+ * Sample the EC memory map at a fixed rate
+ *
+ * ectool watch [<rate_hz> [<count> [csv|bin]]]
+ *
+ * Reads the populated part of the memory map in a single transaction per
+ * tick and streams timestamped records to stdout, either as decoded CSV
+ * (temperatures, fans, switches, battery, ALS, lid angle, accelerometers
+ * and gyro) or as raw binary records. <count> of 0 samples until
+ * interrupted. A summary of dropped ticks and the achieved rate is printed
+ * to stderr on exit.
+ *
+ * @param argc	Number of arguments (excluding 'ectool')
+ * @param argv	List of arguments
+ * @return 0 if ok, -1 on error
+ */
+int cmd_watch(int argc, char *argv[]);
@@ -0,0 +1,332 @@
+/* Copyright (c) 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * High-rate sampler for the EC memory map.
+ *
+ * Each tick reads the whole populated part of the memory map with a single
+ * ec_readmem() call and either decodes it into a CSV row or dumps it as a
+ * raw binary record.  Output is block-buffered and flushed about once per
+ * second so that a sample costs one transport transaction and one sleep.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "comm-host.h"
+#include "ec_commands.h"
+#include "ectool.h"
+
+/* Everything past the gyroscope data is unused */
+#define WATCH_MEMMAP_SIZE	(EC_MEMMAP_GYRO_DATA + 3 * sizeof(int16_t))
+
+#define WATCH_DEFAULT_RATE	10	/* Hz */
+#define WATCH_MAX_RATE		10000	/* Hz */
+#define WATCH_BUSY_RETRIES	3	/* Re-reads while accel data is busy */
+#define WATCH_OUTBUF_SIZE	(64 * 1024)
+
+/* Binary output: one watch_file_header, then one watch_record per sample */
+#define WATCH_MAGIC		0x4d574345	/* "ECWM" */
+#define WATCH_VERSION		1
+
+struct watch_file_header {
+	uint32_t magic;		/* WATCH_MAGIC */
+	uint16_t version;	/* WATCH_VERSION */
+	uint16_t memmap_size;	/* Bytes of memmap in each record */
+	uint32_t rate;		/* Requested sample rate in Hz */
+} __packed;
+
+struct watch_record {
+	uint64_t time_us;	/* Microseconds since the first sample */
+	uint32_t sample;	/* Sample number, counting dropped ticks */
+	uint16_t dropped;	/* Ticks dropped before this sample; saturates */
+	uint16_t retries;	/* Re-reads due to EC_MEMMAP_ACC_STATUS busy */
+	uint8_t memmap[WATCH_MEMMAP_SIZE];
+} __packed;
+
+static volatile sig_atomic_t watch_stop;
+static char watch_outbuf[WATCH_OUTBUF_SIZE];
+
+static void watch_sigint(int sig)
+{
+	watch_stop = 1;
+}
+
+static uint64_t timespec_to_us(const struct timespec *ts)
+{
+	return (uint64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static void timespec_add_ns(struct timespec *ts, uint64_t ns)
+{
+	ns += ts->tv_nsec;
+	ts->tv_sec += ns / 1000000000;
+	ts->tv_nsec = ns % 1000000000;
+}
+
+static uint16_t mm16(const uint8_t *mm, int offset)
+{
+	return mm[offset] | (mm[offset + 1] << 8);
+}
+
+static uint32_t mm32(const uint8_t *mm, int offset)
+{
+	return mm16(mm, offset) | ((uint32_t)mm16(mm, offset + 2) << 16);
+}
+
+static void watch_print_csv_header(FILE *out)
+{
+	int i;
+
+	fprintf(out, "time_us,sample,dropped");
+	for (i = 0; i < EC_TEMP_SENSOR_ENTRIES + EC_TEMP_SENSOR_B_ENTRIES; i++)
+		fprintf(out, ",temp%d_k", i);
+	for (i = 0; i < EC_FAN_SPEED_ENTRIES; i++)
+		fprintf(out, ",fan%d_rpm", i);
+	fprintf(out, ",switches,host_events");
+	fprintf(out, ",batt_mv,batt_ma,batt_mah,batt_flag");
+	for (i = 0; i < EC_ALS_ENTRIES; i++)
+		fprintf(out, ",als%d_lux", i);
+	fprintf(out, ",acc_sample_id,lid_angle");
+	fprintf(out, ",acc0_x,acc0_y,acc0_z,acc1_x,acc1_y,acc1_z");
+	fprintf(out, ",gyro_x,gyro_y,gyro_z\n");
+}
+
+static void watch_print_temp(FILE *out, const uint8_t *mm, int offset)
+{
+	int t = mm[offset];
+
+	/* Leave the field empty for any of the special sensor values */
+	if (t >= EC_TEMP_SENSOR_NOT_CALIBRATED)
+		fputc(',', out);
+	else
+		fprintf(out, ",%d", t + EC_TEMP_SENSOR_OFFSET);
+}
+
+static void watch_print_csv(FILE *out, const struct watch_record *r)
+{
+	const uint8_t *mm = r->memmap;
+	int thermal_version = mm[EC_MEMMAP_THERMAL_VERSION];
+	int i;
+
+	fprintf(out, "%" PRIu64 ",%u,%u", r->time_us, r->sample, r->dropped);
+
+	for (i = 0; i < EC_TEMP_SENSOR_ENTRIES; i++) {
+		if (thermal_version)
+			watch_print_temp(out, mm, EC_MEMMAP_TEMP_SENSOR + i);
+		else
+			fputc(',', out);
+	}
+	for (i = 0; i < EC_TEMP_SENSOR_B_ENTRIES; i++) {
+		if (thermal_version >= 2)
+			watch_print_temp(out, mm, EC_MEMMAP_TEMP_SENSOR_B + i);
+		else
+			fputc(',', out);
+	}
+
+	for (i = 0; i < EC_FAN_SPEED_ENTRIES; i++) {
+		uint16_t rpm = mm16(mm, EC_MEMMAP_FAN + 2 * i);
+
+		if (rpm == EC_FAN_SPEED_NOT_PRESENT)
+			fputc(',', out);
+		else if (rpm == EC_FAN_SPEED_STALLED)
+			fprintf(out, ",0");
+		else
+			fprintf(out, ",%u", rpm);
+	}
+
+	fprintf(out, ",0x%02x,0x%08x", mm[EC_MEMMAP_SWITCHES],
+		mm32(mm, EC_MEMMAP_HOST_EVENTS));
+
+	if (mm[EC_MEMMAP_BATTERY_VERSION])
+		fprintf(out, ",%u,%u,%u,0x%02x",
+			mm32(mm, EC_MEMMAP_BATT_VOLT),
+			mm32(mm, EC_MEMMAP_BATT_RATE),
+			mm32(mm, EC_MEMMAP_BATT_CAP),
+			mm[EC_MEMMAP_BATT_FLAG]);
+	else
+		fprintf(out, ",,,,");
+
+	for (i = 0; i < EC_ALS_ENTRIES; i++)
+		fprintf(out, ",%u", mm16(mm, EC_MEMMAP_ALS + 2 * i));
+
+	if (mm[EC_MEMMAP_ACC_STATUS] & EC_MEMMAP_ACC_STATUS_PRESENCE_BIT) {
+		uint16_t angle = mm16(mm, EC_MEMMAP_ACC_DATA);
+
+		fprintf(out, ",%d", mm[EC_MEMMAP_ACC_STATUS] &
+			EC_MEMMAP_ACC_STATUS_SAMPLE_ID_MASK);
+		if (angle == LID_ANGLE_UNRELIABLE)
+			fputc(',', out);
+		else
+			fprintf(out, ",%u", angle);
+		/* Two accelerometers follow the lid angle, then the gyro */
+		for (i = 1; i < 7; i++)
+			fprintf(out, ",%d",
+				(int16_t)mm16(mm, EC_MEMMAP_ACC_DATA + 2 * i));
+		for (i = 0; i < 3; i++)
+			fprintf(out, ",%d",
+				(int16_t)mm16(mm, EC_MEMMAP_GYRO_DATA + 2 * i));
+	} else {
+		fprintf(out, ",,,,,,,,,,,");
+	}
+
+	fputc('\n', out);
+}
+
+/**
+ * Read one coherent snapshot of the memory map.
+ *
+ * The EC sets EC_MEMMAP_ACC_STATUS_BUSY_BIT while it updates the motion
+ * sensor data, so re-read the map a few times if we caught it mid-update.
+ *
+ * @return number of re-reads, or negative on transport error.
+ */
+static int watch_read(uint8_t *mm)
+{
+	int retries;
+	int rv;
+
+	for (retries = 0; ; retries++) {
+		rv = ec_readmem(0, WATCH_MEMMAP_SIZE, mm);
+		if (rv < 0)
+			return rv;
+		if (!(mm[EC_MEMMAP_ACC_STATUS] &
+		      EC_MEMMAP_ACC_STATUS_BUSY_BIT) ||
+		    retries == WATCH_BUSY_RETRIES)
+			return retries;
+	}
+}
+
+int cmd_watch(int argc, char *argv[])
+{
+	struct watch_record r;
+	struct timespec start, next, now;
+	uint64_t period_ns, elapsed_us = 0;
+	uint32_t rate = WATCH_DEFAULT_RATE, count = 0, samples = 0;
+	uint32_t dropped_total = 0, retries_total = 0, flush_count = 0;
+	uint32_t tick = 0, dropped = 0;
+	int binary = 0;
+	char *e;
+	int rv;
+
+	if (argc > 1) {
+		rate = strtoul(argv[1], &e, 0);
+		if ((e && *e) || !rate || rate > WATCH_MAX_RATE) {
+			fprintf(stderr, "Bad rate (1-%d Hz).\n",
+				WATCH_MAX_RATE);
+			return -1;
+		}
+	}
+	if (argc > 2) {
+		count = strtoul(argv[2], &e, 0);
+		if (e && *e) {
+			fprintf(stderr, "Bad count.\n");
+			return -1;
+		}
+	}
+	if (argc > 3) {
+		if (!strcasecmp(argv[3], "bin")) {
+			binary = 1;
+		} else if (strcasecmp(argv[3], "csv")) {
+			fprintf(stderr, "Bad format; use csv or bin.\n");
+			return -1;
+		}
+	}
+
+	/* Check the transport copes with a full-size read before starting */
+	if (watch_read(r.memmap) < 0) {
+		fprintf(stderr, "Unable to read memory map.\n");
+		return -1;
+	}
+
+	setvbuf(stdout, watch_outbuf, _IOFBF, sizeof(watch_outbuf));
+
+	if (binary) {
+		struct watch_file_header h = {
+			.magic = WATCH_MAGIC,
+			.version = WATCH_VERSION,
+			.memmap_size = WATCH_MEMMAP_SIZE,
+			.rate = rate,
+		};
+		fwrite(&h, sizeof(h), 1, stdout);
+	} else {
+		watch_print_csv_header(stdout);
+	}
+
+	signal(SIGINT, watch_sigint);
+	signal(SIGTERM, watch_sigint);
+
+	period_ns = 1000000000ULL / rate;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	next = start;
+
+	while (!watch_stop && (!count || samples < count)) {
+		/*
+		 * If we overslept past whole periods (slow transport, busy
+		 * host), skip the missed ticks rather than bursting to catch
+		 * up, and account for them in the next record.  The count
+		 * carries over if the sleep is interrupted.
+		 */
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		while (timespec_to_us(&now) >=
+		       timespec_to_us(&next) + period_ns / 1000) {
+			timespec_add_ns(&next, period_ns);
+			dropped++;
+			tick++;
+		}
+
+		rv = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				     &next, NULL);
+		if (rv == EINTR)
+			continue;
+
+		rv = watch_read(r.memmap);
+		if (rv < 0) {
+			fprintf(stderr, "Memory map read failed: %d\n", rv);
+			break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		elapsed_us = timespec_to_us(&now) - timespec_to_us(&start);
+		r.time_us = elapsed_us;
+		r.sample = tick++;
+		r.retries = rv;
+		r.dropped = dropped < 0xffff ? dropped : 0xffff;
+		dropped_total += dropped;
+		dropped = 0;
+		retries_total += rv;
+		samples++;
+
+		if (binary)
+			fwrite(&r, sizeof(r), 1, stdout);
+		else
+			watch_print_csv(stdout, &r);
+
+		/* Flush about once a second to keep syscalls off the path */
+		if (++flush_count >= rate) {
+			fflush(stdout);
+			flush_count = 0;
+		}
+
+		timespec_add_ns(&next, period_ns);
+	}
+
+	fflush(stdout);
+	signal(SIGINT, SIG_DFL);
+	signal(SIGTERM, SIG_DFL);
+
+	fprintf(stderr, "%u samples, %u dropped, %u busy retries", samples,
+		dropped_total, retries_total);
+	if (elapsed_us)
+		fprintf(stderr, ", %.1f Hz achieved (%u Hz requested)",
+			(double)samples * 1000000 / elapsed_us, rate);
+	fprintf(stderr, "\n");
+
+	return 0;
+}
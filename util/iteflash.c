@@ -57,7 +57,7 @@
 #define SPI_CMD_WORD_PROGRAM	0xAD
 
 /* Size for FTDI outgoing buffer */
-#define FTDI_CMD_BUF_SIZE (1<<12)
+#define FTDI_CMD_BUF_SIZE (1<<13)
 
 /* store custom parameters */
 const char *input_filename;
@@ -77,113 +77,256 @@ enum {
 	FLAG_ERASE          = 0x02,
 };
 
-/* number of bytes to send consecutively before checking for ACKs */
-#define TX_BUFFER_LIMIT	32
+/*
+ * MPSSE commands are queued and written to the FTDI in batches, and the
+ * replies they produce (I2C ACK bits and data bytes) are read back with a
+ * single read per batch.  Each USB round trip costs about a millisecond,
+ * which is far longer than the I2C traffic in a small transfer.
+ */
+
+/* Most reply bytes outstanding; the FTDI receive buffer is only a few KB */
+#define FTDI_REPLY_LIMIT 1024
+
+/* Most separate replies outstanding */
+#define MAX_REPLIES 64
+
+/* Longest to wait for replies which have not arrived yet */
+#define READ_TIMEOUT_MS 1000
 
-static int i2c_add_send_byte(struct ftdi_context *ftdi, uint8_t *buf,
-			     uint8_t *ptr, uint8_t *tbuf, int tcnt)
+/* Queued MPSSE commands, not yet written */
+static uint8_t cmd_buf[FTDI_CMD_BUF_SIZE];
+static int cmd_len;
+
+/*
+ * Replies owed by the FTDI, oldest first.  Each is data for the caller, or
+ * I2C ACK bits (data == NULL) which are only checked.  The first reply_sent
+ * have had their commands written.
+ */
+static struct {
+	uint8_t *data;
+	int len;
+} replies[MAX_REPLIES];
+static int reply_count;
+static int reply_sent;
+static int reply_bytes;
+
+/* Number of replies received so far; see mpsse_receive() */
+static uint32_t replies_done;
+
+static long long time_ms(void)
 {
-	int ret, i, j;
-	int tx_buffered = 0;
-	static uint8_t ack[TX_BUFFER_LIMIT];
-	uint8_t *b = ptr;
-	uint8_t failed_ack = 0;
+	struct timespec ts;
 
-	for (i = 0; i < tcnt; i++) {
-		/* WORKAROUND: force SDA before sending the next byte */
-		*b++ = SET_BITS_LOW; *b++ = SDA_BIT; *b++ = SCL_BIT | SDA_BIT;
-		/* write byte */
-		*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-		*b++ = 0x07; *b++ = *tbuf++;
-		/* prepare for ACK */
-		*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
-		/* read ACK */
-		*b++ = MPSSE_DO_READ | MPSSE_BITMODE | MPSSE_LSB;
-		*b++ = 0;
-		*b++ = SEND_IMMEDIATE;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
 
-		tx_buffered++;
+static void mpsse_reset(struct ftdi_context *ftdi)
+{
+	replies_done += reply_count;
+	cmd_len = 0;
+	reply_count = 0;
+	reply_sent = 0;
+	reply_bytes = 0;
+	ftdi_usb_purge_buffers(ftdi);
+}
 
-		/*
-		 * On the last byte, or every TX_BUFFER_LIMIT bytes, read the
-		 * ACK bits.
-		 */
-		if (i == tcnt-1 || (tx_buffered == TX_BUFFER_LIMIT)) {
-			/* write data */
-			ret = ftdi_write_data(ftdi, buf, b - buf);
-			if (ret < 0) {
-				fprintf(stderr, "failed to write byte\n");
-				return ret;
-			}
-
-			/* read ACK bits */
-			ret = ftdi_read_data(ftdi, &ack[0], tx_buffered);
-			for (j = 0; j < tx_buffered; j++) {
-				if ((ack[j] & 0x80) != 0)
-					failed_ack = ack[j];
-			}
-
-			/* check ACK bits */
-			if (ret < 0 || failed_ack) {
-				if (debug)
-					fprintf(stderr,
-						"write ACK fail: %d, 0x%02x\n",
-						ret, failed_ack);
-				return  -ENXIO;
-			}
-
-			/* reset for next set of transactions */
-			b = ptr;
-			tx_buffered = 0;
-		}
+/* Write the queued commands */
+static int mpsse_send(struct ftdi_context *ftdi)
+{
+	int ret;
+
+	if (!cmd_len)
+		return 0;
+
+	/* Have the FTDI return the replies without waiting for more */
+	cmd_buf[cmd_len++] = SEND_IMMEDIATE;
+
+	ret = ftdi_write_data(ftdi, cmd_buf, cmd_len);
+	if (ret < 0) {
+		fprintf(stderr, "failed to write MPSSE commands\n");
+		mpsse_reset(ftdi);
+		return ret;
 	}
+
+	cmd_len = 0;
+	reply_sent = reply_count;
 	return 0;
 }
 
-static int i2c_add_recv_bytes(struct ftdi_context *ftdi, uint8_t *buf,
-			     uint8_t *ptr, uint8_t *rbuf, int rcnt)
+/*
+ * Receive replies until 'mark' have been received in all.  A mark is
+ * replies_done + reply_count, taken just after mpsse_send(), so callers can
+ * queue more commands before collecting the replies to earlier ones.
+ */
+static int mpsse_receive(struct ftdi_context *ftdi, uint32_t mark)
 {
-	int ret, i;
-	uint8_t *b = ptr;
+	static uint8_t rbuf[FTDI_REPLY_LIMIT];
+	int count = mark - replies_done;
+	int len = 0, ret, i, j;
+	long long deadline;
+	uint8_t failed_ack = 0;
+	uint8_t *r;
+
+	if (count <= 0)
+		return 0;
+	if (count > reply_sent) {
+		ret = mpsse_send(ftdi);
+		if (ret < 0)
+			return ret;
+	}
 
-	for (i = 0; i < rcnt; i++) {
-		/* set SCL low */
-		*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
-		/* read the byte on the wire */
-		*b++ = MPSSE_DO_READ; *b++ = 0; *b++ = 0;
-
-		if (i == rcnt - 1) {
-			/* NACK last byte */
-			*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
-			*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-			*b++ = 0; *b++ = 0xff; *b++ = SEND_IMMEDIATE;
-		} else {
-			/* ACK all other bytes */
-			*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT | SDA_BIT;
-			*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
-			*b++ = 0; *b++ = 0; *b++ = SEND_IMMEDIATE;
+	for (i = 0; i < count; i++)
+		len += replies[i].len;
+
+	/* Reads return nothing until the FTDI's latency timer expires */
+	deadline = time_ms() + READ_TIMEOUT_MS;
+	for (i = 0; i < len; ) {
+		ret = ftdi_read_data(ftdi, rbuf + i, len - i);
+		if (ret < 0 || (!ret && time_ms() > deadline)) {
+			fprintf(stderr, "failed to read MPSSE replies\n");
+			mpsse_reset(ftdi);
+			return ret < 0 ? ret : -ETIMEDOUT;
 		}
+		i += ret;
 	}
 
-	ret = ftdi_write_data(ftdi, buf, b - buf);
-	if (ret < 0) {
-		fprintf(stderr, "failed to prepare read\n");
+	for (r = rbuf, i = 0; i < count; r += replies[i++].len) {
+		if (replies[i].data) {
+			memcpy(replies[i].data, r, replies[i].len);
+			continue;
+		}
+		for (j = 0; j < replies[i].len; j++)
+			if (r[j] & 0x80)
+				failed_ack = r[j];
+	}
+
+	memmove(replies, replies + count,
+		(reply_count - count) * sizeof(replies[0]));
+	reply_count -= count;
+	reply_sent -= count;
+	reply_bytes -= len;
+	replies_done += count;
+
+	if (failed_ack) {
+		if (debug)
+			fprintf(stderr, "write ACK fail: 0x%02x\n", failed_ack);
+		return -ENXIO;
+	}
+	return 0;
+}
+
+/* Write all queued commands and receive all replies */
+static int mpsse_flush(struct ftdi_context *ftdi)
+{
+	int ret = mpsse_send(ftdi);
+
+	if (ret < 0)
 		return ret;
+	return mpsse_receive(ftdi, replies_done + reply_count);
+}
+
+/* Make room to queue 'len' command bytes producing 'rlen' reply bytes */
+static int mpsse_reserve(struct ftdi_context *ftdi, int len, int rlen)
+{
+	if (reply_bytes + rlen > FTDI_REPLY_LIMIT || reply_count == MAX_REPLIES)
+		return mpsse_flush(ftdi);
+	/* Keep a byte for SEND_IMMEDIATE */
+	if (cmd_len + len >= FTDI_CMD_BUF_SIZE)
+		return mpsse_send(ftdi);
+	return 0;
+}
+
+/* Note a reply the queued commands will produce */
+static void mpsse_add_reply(uint8_t *data, int len)
+{
+	int last = reply_count - 1;
+
+	/* Extend the last reply if it hasn't been sent and this follows on */
+	if (reply_count > reply_sent &&
+	    (replies[last].data ? replies[last].data + replies[last].len == data
+				: !data)) {
+		replies[last].len += len;
+	} else {
+		replies[reply_count].data = data;
+		replies[reply_count].len = len;
+		reply_count++;
 	}
-	ret = ftdi_read_data(ftdi, rbuf, rcnt);
+	reply_bytes += len;
+}
+
+static int i2c_add_send_byte(struct ftdi_context *ftdi, uint8_t byte)
+{
+	int ret = mpsse_reserve(ftdi, 13, 1);
+	uint8_t *b = cmd_buf + cmd_len;
+
 	if (ret < 0)
-		fprintf(stderr, "read byte failed\n");
-	return ret;
+		return ret;
+
+	/* WORKAROUND: force SDA before sending the next byte */
+	*b++ = SET_BITS_LOW; *b++ = SDA_BIT; *b++ = SCL_BIT | SDA_BIT;
+	/* write byte */
+	*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
+	*b++ = 0x07; *b++ = byte;
+	/* prepare for ACK */
+	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
+	/* read ACK */
+	*b++ = MPSSE_DO_READ | MPSSE_BITMODE | MPSSE_LSB;
+	*b++ = 0;
+
+	cmd_len = b - cmd_buf;
+	mpsse_add_reply(NULL, 1);
+	return 0;
 }
 
-static int i2c_byte_transfer(struct ftdi_context *ftdi, uint8_t addr,
-			     uint8_t *data, int write, int numbytes)
+static int i2c_add_recv_byte(struct ftdi_context *ftdi, uint8_t *data,
+			     int last)
 {
-	int ret = 0, rets;
-	static uint8_t buf[FTDI_CMD_BUF_SIZE];
-	uint8_t *b = buf;
-	uint8_t slave_addr;
+	int ret = mpsse_reserve(ftdi, 15, 1);
+	uint8_t *b = cmd_buf + cmd_len;
+
+	if (ret < 0)
+		return ret;
 
+	/* set SCL low */
+	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
+	/* read the byte on the wire */
+	*b++ = MPSSE_DO_READ; *b++ = 0; *b++ = 0;
+
+	if (last) {
+		/* NACK last byte */
+		*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT;
+		*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
+		*b++ = 0; *b++ = 0xff;
+	} else {
+		/* ACK all other bytes */
+		*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT | SDA_BIT;
+		*b++ = MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG;
+		*b++ = 0; *b++ = 0;
+	}
+
+	cmd_len = b - cmd_buf;
+	mpsse_add_reply(data, 1);
+	return 0;
+}
+
+/*
+ * Queue an I2C transfer.  Errors are only seen when the replies are
+ * received.  In particular, the data bytes are clocked out even if the
+ * address is not ACKed, and a NACK anywhere in the transfer makes the
+ * receive fail with -ENXIO; data read after a NACK is not valid.
+ */
+static int i2c_add_transfer(struct ftdi_context *ftdi, uint8_t addr,
+			    uint8_t *data, int write, int numbytes)
+{
+	int ret, i;
+	uint8_t *b;
+
+	ret = mpsse_reserve(ftdi, 18, 0);
+	if (ret < 0)
+		return ret;
+
+	b = cmd_buf + cmd_len;
 	/* START condition */
 	/* SCL & SDA high */
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = 0;
@@ -194,25 +337,26 @@ static int i2c_byte_transfer(struct ftdi_context *ftdi, uint8_t addr,
 	/* SCL low, SDA low */
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT | SDA_BIT;
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SCL_BIT | SDA_BIT;
+	cmd_len = b - cmd_buf;
 
 	/* send address */
-	slave_addr = (addr << 1) | (write ? 0 : 1);
-	ret = i2c_add_send_byte(ftdi, buf, b, &slave_addr, 1);
-	if (ret < 0) {
-		if (debug)
-			fprintf(stderr, "address %02x failed\n", addr);
-		ret = -ENXIO;
-		goto exit_xfer;
+	ret = i2c_add_send_byte(ftdi, (addr << 1) | (write ? 0 : 1));
+
+	for (i = 0; i < numbytes && !ret; i++) {
+		if (write) /* write data */
+			ret = i2c_add_send_byte(ftdi, data[i]);
+		else /* read data */
+			ret = i2c_add_recv_byte(ftdi, data + i,
+						i == numbytes - 1);
 	}
+	if (ret < 0)
+		return ret;
 
-	b = buf;
-	if (write) /* write data */
-		ret = i2c_add_send_byte(ftdi, buf, b, data, numbytes);
-	else /* read data */
-		ret = i2c_add_recv_bytes(ftdi, buf, b, data, numbytes);
+	ret = mpsse_reserve(ftdi, 12, 0);
+	if (ret < 0)
+		return ret;
 
-exit_xfer:
-	b = buf;
+	b = cmd_buf + cmd_len;
 	/* STOP condition */
 	/* SCL high, SDA low */
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = SDA_BIT;
@@ -220,21 +364,35 @@ exit_xfer:
 	/* SCL high, SDA high */
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = 0;
 	*b++ = SET_BITS_LOW; *b++ = 0; *b++ = 0;
+	cmd_len = b - cmd_buf;
 
-	rets = ftdi_write_data(ftdi, buf, b - buf);
-	if (rets < 0)
-		fprintf(stderr, "failed to send STOP\n");
-	return ret;
+	return 0;
+}
+
+/*
+ * Do an I2C transfer now, along with anything already queued.  Unlike a
+ * transfer which stops at an address NACK, the whole transfer goes on the
+ * bus; see i2c_add_transfer().
+ */
+static int i2c_byte_transfer(struct ftdi_context *ftdi, uint8_t addr,
+			     uint8_t *data, int write, int numbytes)
+{
+	int ret = i2c_add_transfer(ftdi, addr, data, write, numbytes);
+
+	if (ret < 0)
+		return ret;
+	return mpsse_flush(ftdi);
 }
 
+/* Queue a DBGR register write; it is sent with the next batch */
 static int i2c_write_byte(struct ftdi_context *ftdi, uint8_t cmd, uint8_t data)
 {
 	int ret;
 
-	ret = i2c_byte_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
+	ret = i2c_add_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
 	if (ret < 0)
 		return -EIO;
-	ret = i2c_byte_transfer(ftdi, I2C_DATA_ADDR, &data, 1, 1);
+	ret = i2c_add_transfer(ftdi, I2C_DATA_ADDR, &data, 1, 1);
 	if (ret < 0)
 		return -EIO;
 
@@ -245,7 +403,7 @@ static int i2c_read_byte(struct ftdi_context *ftdi, uint8_t cmd, uint8_t *data)
 {
 	int ret;
 
-	ret = i2c_byte_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
+	ret = i2c_add_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
 	if (ret < 0)
 		return -EIO;
 	ret = i2c_byte_transfer(ftdi, I2C_DATA_ADDR, data, 0, 1);
@@ -293,6 +451,7 @@ static int spi_flash_follow_mode(struct ftdi_context *ftdi, char *desc)
 	ret |= i2c_write_byte(ftdi, 0x05, 0xfe);
 	ret |= i2c_write_byte(ftdi, 0x04, 0x00);
 	ret |= i2c_write_byte(ftdi, 0x08, 0x00);
+	ret |= mpsse_flush(ftdi);
 
 	ret = (ret ? -EIO : 0);
 	if (ret < 0)
@@ -309,6 +468,7 @@ static int spi_flash_follow_mode_exit(struct ftdi_context *ftdi, char *desc)
 
 	ret |= i2c_write_byte(ftdi, 0x07, 0x00);
 	ret |= i2c_write_byte(ftdi, 0x06, 0x00);
+	ret |= mpsse_flush(ftdi);
 
 	ret = (ret ? -EIO : 0);
 	if (ret < 0)
@@ -318,7 +478,11 @@ static int spi_flash_follow_mode_exit(struct ftdi_context *ftdi, char *desc)
 	return ret;
 }
 
-/* SPI Flash generic command, short version */
+/*
+ * SPI Flash generic command, short version.  Like the other SPI Flash
+ * helpers which only write, this is queued, and a failure shows when the
+ * batch is flushed.
+ */
 static int spi_flash_command_short(struct ftdi_context *ftdi,
 						uint8_t cmd,
 						char *desc)
@@ -553,6 +717,31 @@ static void draw_spinner(uint32_t remaining, uint32_t size)
 	windex %= sizeof(wheel);
 }
 
+/* Queue reading a page of flash into buffer */
+static int add_read_page(struct ftdi_context *ftdi, uint16_t page,
+			 uint8_t *buffer, int cnt)
+{
+	int res;
+	uint8_t cmd = 0x9;
+
+	/* Fast Read command */
+	if (spi_flash_command_short(ftdi, SPI_CMD_FAST_READ, "fast read") < 0)
+		return -EIO;
+	res = i2c_write_byte(ftdi, 0x08, page >> 8);
+	res += i2c_write_byte(ftdi, 0x08, page & 0xff);
+	res += i2c_write_byte(ftdi, 0x08, 0x00);
+	res += i2c_write_byte(ftdi, 0x08, 0x00);
+	if (res < 0) {
+		fprintf(stderr, "page address set failed\n");
+		return -EIO;
+	}
+
+	/* read page data */
+	res = i2c_add_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
+	res |= i2c_add_transfer(ftdi, I2C_BLOCK_ADDR, buffer, 0, cnt);
+	return res ? -EIO : 0;
+}
+
 int command_read_pages(struct ftdi_context *ftdi, uint32_t address,
 		       uint32_t size, uint8_t *buffer)
 {
@@ -560,42 +749,40 @@ int command_read_pages(struct ftdi_context *ftdi, uint32_t address,
 	uint32_t remaining = size;
 	int cnt;
 	uint16_t page;
+	uint32_t mark, next;
 
 	if (spi_flash_follow_mode(ftdi, "fast read") < 0)
 		goto failed_read;
 
+	mark = replies_done;
 	while (remaining) {
-		uint8_t cmd = 0x9;
-
 		cnt = (remaining > PAGE_SIZE) ? PAGE_SIZE : remaining;
 		page = address / PAGE_SIZE;
 
 		draw_spinner(remaining, size);
-		/* Fast Read command */
-		if (spi_flash_command_short(ftdi, SPI_CMD_FAST_READ,
-			"fast read") < 0)
-			goto failed_read;
-		res = i2c_write_byte(ftdi, 0x08, page >> 8);
-		res += i2c_write_byte(ftdi, 0x08, page & 0xff);
-		res += i2c_write_byte(ftdi, 0x08, 0x00);
-		res += i2c_write_byte(ftdi, 0x08, 0x00);
-		if (res < 0) {
-			fprintf(stderr, "page address set failed\n");
-			goto failed_read;
-		}
 
-		/* read page data */
-		res = i2c_byte_transfer(ftdi, I2C_CMD_ADDR, &cmd, 1, 1);
-		res = i2c_byte_transfer(ftdi, I2C_BLOCK_ADDR, buffer, 0, cnt);
-		if (res < 0) {
+		/*
+		 * Send the request for this page, then collect the previous
+		 * page while the FTDI works on this one.
+		 */
+		if (add_read_page(ftdi, page, buffer, cnt) < 0 ||
+		    mpsse_send(ftdi) < 0)
+			goto failed_read;
+		next = replies_done + reply_count;
+		if (mpsse_receive(ftdi, mark) < 0) {
 			fprintf(stderr, "page data read failed\n");
 			goto failed_read;
 		}
+		mark = next;
 
 		address += cnt;
 		remaining -= cnt;
 		buffer += cnt;
 	}
+	if (mpsse_receive(ftdi, mark) < 0) {
+		fprintf(stderr, "page data read failed\n");
+		goto failed_read;
+	}
 	/* No error so far */
 	res = size;
 failed_read:
@@ -605,12 +792,27 @@ failed_read:
 	return res;
 }
 
+/* Return how many bytes at the end of buf are in pages which are all 0xff */
+static uint32_t blank_tail(const uint8_t *buf, uint32_t size)
+{
+	uint32_t end = size;
+	uint32_t i;
+
+	while (end) {
+		for (i = (end - 1) / PAGE_SIZE * PAGE_SIZE; i < end; i++)
+			if (buf[i] != 0xff)
+				return size - end;
+		end = (end - 1) / PAGE_SIZE * PAGE_SIZE;
+	}
+	return size;
+}
+
 int command_write_pages(struct ftdi_context *ftdi, uint32_t address,
 			uint32_t size, uint8_t *buffer)
 {
 	int res = -EIO;
 	uint32_t remaining = size;
-	int cnt;
+	int cnt, len;
 	uint8_t page;
 	uint8_t cmd;
 
@@ -624,6 +826,11 @@ int command_write_pages(struct ftdi_context *ftdi, uint32_t address,
 
 		draw_spinner(remaining, size);
 
+		/* The flash is erased, so blank pages at the end can be left */
+		len = cnt - blank_tail(buffer, cnt);
+		if (!len)
+			goto next_block;
+
 		/* Write enable */
 		if (spi_flash_command_short(ftdi, SPI_CMD_WRITE_ENABLE,
 			"write enable for AAI write") < 0)
@@ -655,8 +862,7 @@ int command_write_pages(struct ftdi_context *ftdi, uint32_t address,
 
 		/* Write up to BLOCK_WRITE_SIZE data */
 		res = i2c_write_byte(ftdi, 0x10, 0x20);
-		res = i2c_byte_transfer(ftdi, I2C_BLOCK_ADDR, buffer, 1, cnt);
-		buffer += cnt;
+		res = i2c_byte_transfer(ftdi, I2C_BLOCK_ADDR, buffer, 1, len);
 
 		if (res < 0) {
 			fprintf(stderr, "Flash data write failed\n");
@@ -681,6 +887,8 @@ int command_write_pages(struct ftdi_context *ftdi, uint32_t address,
 		if (spi_poll_busy(ftdi, "write disable for AAI write") < 0)
 			goto failed_write;
 
+next_block:
+		buffer += cnt;
 		address += cnt;
 		remaining -= cnt;
 	}
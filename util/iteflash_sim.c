@@ -0,0 +1,431 @@
+/* Copyright 2015 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Simulated FTDI and ITE83xx DBGR interface for iteflash.
+ *
+ * Linked into iteflash in place of libftdi, to build iteflash_sim.  The
+ * MPSSE command stream iteflash writes is decoded into I2C transfers, which
+ * drive a model of the DBGR registers and of the embedded flash behind them
+ * in follow mode.  Replies are queued for ftdi_read_data() as the real FTDI
+ * would return them.
+ *
+ * The flash contents are loaded from and saved to the file named by
+ * ITEFLASH_SIM_IMAGE, if set, so iteflash can be run repeatedly against the
+ * same part.  On close, the USB and I2C traffic is printed, with an estimate
+ * of the time it would take on hardware.
+ *
+ * Build with 'make BOARD=<board> iteflash-sim'.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma GCC diagnostic ignored "-Wstrict-prototypes"
+#include <ftdi.h>
+#pragma GCC diagnostic pop
+
+/* libftdi1 made the error string and the data to write const */
+#ifdef LIBFTDI1
+#define LIBFTDI_CONST const
+#else
+#define LIBFTDI_CONST
+#endif
+
+/* Chip ID and version; the version gives a 256 kB flash */
+#define CHIP_ID		0x8380
+#define CHIP_VER	0x80
+#define FLASH_SIZE	((128 + (CHIP_VER & 0xf0)) * 1024)
+
+/* DBGR I2C addresses, as in iteflash */
+#define I2C_CMD_ADDR	0x5A
+#define I2C_DATA_ADDR	0x35
+#define I2C_BLOCK_ADDR	0x79
+
+/* I2C pins on the FTDI interface */
+#define SCL_BIT		(1 << 0)
+#define SDA_BIT		(1 << 1)
+
+/* Sector erase size */
+#define SECTOR_SIZE	1024
+
+/* Status reads which see BUSY after an erase */
+#define ERASE_BUSY_POLLS 3
+
+/* Estimates for hardware: USB round trip, and I2C bits per second */
+#define USB_ROUND_TRIP_US 1000
+#define I2C_FREQ	400000
+
+static int bitmode;
+
+/* Replies waiting to be read */
+static uint8_t *rx;
+static int rx_len, rx_size;
+
+/* I2C bus */
+static int scl = 1, sda = 1;
+static enum { I2C_IDLE, I2C_ADDR, I2C_WRITE, I2C_READ } i2c_state;
+static uint8_t i2c_addr;
+static int i2c_ack;
+
+/* DBGR registers */
+static uint8_t reg_index;
+static uint8_t block_mode;
+static int cs_low;
+
+/* Embedded flash */
+static uint8_t flash[FLASH_SIZE];
+static uint8_t spi_cmd;
+static int spi_count;		/* Bytes since the command byte */
+static uint32_t spi_addr;
+static int wel, busy_polls;
+static int aai;
+static uint32_t aai_addr;
+
+/* Traffic counts */
+static struct {
+	int writes;
+	int reads;
+	long write_bytes;
+	long i2c_bytes;
+	int i2c_transfers;
+} stats;
+
+static void reply(uint8_t byte)
+{
+	if (rx_len == rx_size) {
+		rx_size = rx_size ? rx_size * 2 : 4096;
+		rx = realloc(rx, rx_size);
+		if (!rx) {
+			perror("sim");
+			exit(1);
+		}
+	}
+	rx[rx_len++] = byte;
+}
+
+static uint8_t spi_status(void)
+{
+	if (busy_polls) {
+		busy_polls--;
+		return 0x01 | (wel << 1);
+	}
+	return wel << 1;
+}
+
+/* Byte sent to the flash with chip select low */
+static void spi_write(uint8_t byte)
+{
+	int n = spi_count++;
+
+	if (n == 0) {
+		spi_cmd = byte;
+		spi_addr = 0;
+		switch (spi_cmd) {
+		case 0x06: /* Write enable */
+			wel = 1;
+			break;
+		case 0x04: /* Write disable, also ending AAI programming */
+			wel = 0;
+			aai = 0;
+			break;
+		case 0x60: /* Chip erase */
+			if (wel) {
+				memset(flash, 0xff, sizeof(flash));
+				busy_polls = ERASE_BUSY_POLLS;
+				wel = 0;
+			}
+			break;
+		}
+		return;
+	}
+
+	/* Three address bytes; a Fast Read then has a dummy byte */
+	if (n > 3)
+		return;
+	spi_addr = (spi_addr << 8) | byte;
+	if (n != 3)
+		return;
+	spi_addr %= FLASH_SIZE;
+
+	switch (spi_cmd) {
+	case 0xD7: /* Sector erase */
+		if (wel) {
+			memset(flash + spi_addr / SECTOR_SIZE * SECTOR_SIZE,
+			       0xff, SECTOR_SIZE);
+			busy_polls = ERASE_BUSY_POLLS;
+			wel = 0;
+		}
+		break;
+	case 0xAD: /* AAI program; data comes through block writes */
+		if (wel) {
+			aai = 1;
+			aai_addr = spi_addr;
+		}
+		break;
+	}
+}
+
+/* Byte clocked out of the flash with chip select low */
+static uint8_t spi_read(void)
+{
+	switch (spi_cmd) {
+	case 0x05: /* Read status */
+		return spi_status();
+	case 0x0B: /* Fast read, once the address and dummy byte are in */
+		if (spi_count >= 5)
+			return flash[spi_addr++ % FLASH_SIZE];
+		break;
+	}
+	return 0xff;
+}
+
+static void dbgr_write(uint8_t addr, uint8_t byte)
+{
+	switch (addr) {
+	case I2C_CMD_ADDR:
+		reg_index = byte;
+		break;
+	case I2C_DATA_ADDR:
+		if (reg_index == 0x05) {
+			/* Flash chip select: 0xfd selects, 0xfe deselects */
+			cs_low = (byte == 0xfd);
+			spi_cmd = 0;
+			spi_count = 0;
+		} else if (reg_index == 0x08 && cs_low) {
+			spi_write(byte);
+		} else if (reg_index == 0x10) {
+			block_mode = byte;
+		}
+		break;
+	case I2C_BLOCK_ADDR:
+		if ((block_mode & 0x20) && aai)
+			flash[aai_addr++ % FLASH_SIZE] &= byte;
+		break;
+	}
+}
+
+static uint8_t dbgr_read(uint8_t addr)
+{
+	if (addr == I2C_DATA_ADDR) {
+		switch (reg_index) {
+		case 0x00:
+			return CHIP_ID >> 8;
+		case 0x01:
+			return CHIP_ID & 0xff;
+		case 0x02:
+			return CHIP_VER;
+		case 0x08:
+			return cs_low ? spi_read() : 0xff;
+		}
+	} else if (addr == I2C_BLOCK_ADDR && reg_index == 0x09 && cs_low) {
+		return spi_read();
+	}
+	return 0xff;
+}
+
+/* Byte written on the bus by the FTDI; sets the ACK to return */
+static void i2c_master_byte(uint8_t byte)
+{
+	stats.i2c_bytes++;
+	switch (i2c_state) {
+	case I2C_ADDR:
+		i2c_addr = byte >> 1;
+		i2c_ack = (i2c_addr == I2C_CMD_ADDR ||
+			   i2c_addr == I2C_DATA_ADDR ||
+			   i2c_addr == I2C_BLOCK_ADDR);
+		if (i2c_ack)
+			i2c_state = (byte & 1) ? I2C_READ : I2C_WRITE;
+		else
+			i2c_state = I2C_IDLE;
+		break;
+	case I2C_WRITE:
+		dbgr_write(i2c_addr, byte);
+		i2c_ack = 1;
+		break;
+	default:
+		i2c_ack = 0;
+		break;
+	}
+}
+
+static void set_lines(uint8_t value, uint8_t dir)
+{
+	/* Lines not driven are pulled up */
+	int new_scl = (dir & SCL_BIT) ? !!(value & SCL_BIT) : 1;
+	int new_sda = (dir & SDA_BIT) ? !!(value & SDA_BIT) : 1;
+
+	if (scl && new_scl && sda && !new_sda) {
+		i2c_state = I2C_ADDR;
+		stats.i2c_transfers++;
+	} else if (scl && new_scl && !sda && new_sda) {
+		i2c_state = I2C_IDLE;
+	}
+	scl = new_scl;
+	sda = new_sda;
+}
+
+/* Run MPSSE commands; returns the number of bytes used */
+static int mpsse_command(const uint8_t *b, int len)
+{
+	int n, i;
+
+	switch (b[0]) {
+	case SET_BITS_LOW:
+		if (len < 3)
+			return len;
+		set_lines(b[1], b[2]);
+		return 3;
+	case TCK_DIVISOR:
+		return len < 3 ? len : 3;
+	case EN_3_PHASE:
+	case DIS_DIV_5:
+	case SEND_IMMEDIATE:
+		return 1;
+	case MPSSE_DO_WRITE | MPSSE_BITMODE | MPSSE_WRITE_NEG:
+		if (len < 3)
+			return len;
+		/* A byte, or the ACK bit after a byte read, which we ignore */
+		if (b[1] == 7)
+			i2c_master_byte(b[2]);
+		return 3;
+	case MPSSE_DO_READ | MPSSE_BITMODE | MPSSE_LSB:
+		if (len < 2)
+			return len;
+		/* The ACK bit lands in bit 7; high means NACK */
+		reply(i2c_ack ? 0x00 : 0x80);
+		return 2;
+	case MPSSE_DO_READ:
+		if (len < 3)
+			return len;
+		n = (b[1] | (b[2] << 8)) + 1;
+		for (i = 0; i < n; i++) {
+			stats.i2c_bytes++;
+			reply(i2c_state == I2C_READ ?
+			      dbgr_read(i2c_addr) : 0xff);
+		}
+		return 3;
+	default:
+		/* Bad command: the FTDI replies 0xfa and the opcode */
+		fprintf(stderr, "sim: bad MPSSE command 0x%02x\n", b[0]);
+		reply(0xfa);
+		reply(b[0]);
+		return 1;
+	}
+}
+
+struct ftdi_context *ftdi_new(void)
+{
+	return calloc(1, sizeof(struct ftdi_context));
+}
+
+void ftdi_free(struct ftdi_context *ftdi)
+{
+	free(ftdi);
+}
+
+int ftdi_set_interface(struct ftdi_context *ftdi,
+		       enum ftdi_interface interface)
+{
+	return 0;
+}
+
+int ftdi_usb_open_desc(struct ftdi_context *ftdi, int vendor, int product,
+		       const char *description, const char *serial)
+{
+	const char *image = getenv("ITEFLASH_SIM_IMAGE");
+	FILE *f;
+
+	memset(flash, 0xff, sizeof(flash));
+	if (image) {
+		f = fopen(image, "rb");
+		if (f) {
+			if (fread(flash, 1, sizeof(flash), f) != sizeof(flash))
+				fprintf(stderr, "sim: short image %s\n", image);
+			fclose(f);
+		}
+	}
+	return 0;
+}
+
+int ftdi_usb_close(struct ftdi_context *ftdi)
+{
+	const char *image = getenv("ITEFLASH_SIM_IMAGE");
+	FILE *f;
+	long us;
+
+	if (image) {
+		f = fopen(image, "wb");
+		if (!f || fwrite(flash, sizeof(flash), 1, f) != 1)
+			fprintf(stderr, "sim: cannot save %s\n", image);
+		if (f)
+			fclose(f);
+	}
+
+	/* Each USB write and read turns the bus around; bytes take 9 bits */
+	us = (long)(stats.writes + stats.reads) * USB_ROUND_TRIP_US +
+	     stats.i2c_bytes * 9 * 1000000 / I2C_FREQ;
+	fprintf(stderr, "sim: %d USB writes (%ld bytes), %d USB reads, "
+		"%d I2C transfers (%ld bytes), about %ld ms on hardware\n",
+		stats.writes, stats.write_bytes, stats.reads,
+		stats.i2c_transfers, stats.i2c_bytes, us / 1000);
+	return 0;
+}
+
+LIBFTDI_CONST char *ftdi_get_error_string(struct ftdi_context *ftdi)
+{
+	return "simulated FTDI";
+}
+
+int ftdi_set_latency_timer(struct ftdi_context *ftdi, unsigned char latency)
+{
+	return 0;
+}
+
+int ftdi_set_bitmode(struct ftdi_context *ftdi, unsigned char bitmask,
+		     unsigned char mode)
+{
+	bitmode = mode;
+	return 0;
+}
+
+int ftdi_set_baudrate(struct ftdi_context *ftdi, int baudrate)
+{
+	return 0;
+}
+
+int ftdi_usb_purge_buffers(struct ftdi_context *ftdi)
+{
+	rx_len = 0;
+	return 0;
+}
+
+int ftdi_write_data(struct ftdi_context *ftdi,
+		    LIBFTDI_CONST unsigned char *buf, int size)
+{
+	int i;
+
+	stats.writes++;
+	stats.write_bytes += size;
+
+	/* Bit-bang output, such as the special waveform, isn't decoded */
+	if (bitmode != BITMODE_MPSSE)
+		return size;
+
+	for (i = 0; i < size; )
+		i += mpsse_command(buf + i, size - i);
+	return size;
+}
+
+int ftdi_read_data(struct ftdi_context *ftdi, unsigned char *buf, int size)
+{
+	if (size > rx_len)
+		size = rx_len;
+	memcpy(buf, rx, size);
+	memmove(rx, rx + size, rx_len - size);
+	rx_len -= size;
+	stats.reads++;
+	return size;
+}